@@ -0,0 +1,198 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the
+ * Free Software Foundation, Inc.,
+ * 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+/*
+ * Dump an OpenOCD binary event trace, as recorded by "event_trace start",
+ * in text or (with -c) CSV form, oldest record first.  The trace may be
+ * read while OpenOCD is still writing it.
+ *
+ *	cc -o evtracedump contrib/evtracedump.c
+ *	evtracedump [-c] trace.bin
+ *
+ * The layout below must match src/helper/event_trace.h; traces are in
+ * the byte order of the host that recorded them.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define EVENT_TRACE_MAGIC	"OCDEVTR"
+#define EVENT_TRACE_VERSION	1
+
+struct event_trace_record {
+	uint64_t time_us;
+	uint16_t type;
+	int16_t status;
+	uint32_t id;
+	uint32_t addr;
+	uint32_t value;
+};
+
+struct event_trace_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t record_size;
+	uint32_t capacity;
+	uint32_t reserved;
+	uint64_t head;
+	uint64_t start_us;
+};
+
+static const char *type_names[] = {
+	[1] = "dp_read",
+	[2] = "dp_write",
+	[3] = "ap_read",
+	[4] = "ap_write",
+	[5] = "dap_wait",
+	[6] = "dap_sticky",
+	[7] = "jtag_flush",
+	[8] = "dcc_handshake",
+	[9] = "target_event",
+};
+
+static const char *type_name(unsigned type)
+{
+	if (type < sizeof(type_names) / sizeof(type_names[0])
+			&& type_names[type])
+		return type_names[type];
+	return "unknown";
+}
+
+static void show_text(const struct event_trace_record *r)
+{
+	printf("%10llu.%06llu %-13s",
+			(unsigned long long)(r->time_us / 1000000),
+			(unsigned long long)(r->time_us % 1000000),
+			type_name(r->type));
+
+	switch (r->type) {
+	case 1:
+	case 2:
+		printf(" reg 0x%02x", (unsigned) r->addr);
+		if (r->type == 2)
+			printf(" = 0x%08x", (unsigned) r->value);
+		break;
+	case 3:
+	case 4:
+		printf(" ap %u reg 0x%02x", (unsigned) r->id,
+				(unsigned) r->addr);
+		if (r->type == 4)
+			printf(" = 0x%08x", (unsigned) r->value);
+		break;
+	case 5:
+		printf(" ack %d retry %u", r->status, (unsigned) r->addr);
+		break;
+	case 6:
+		printf(" ctrl/stat 0x%08x", (unsigned) r->value);
+		break;
+	case 7:
+		printf(" %u us status %d", (unsigned) r->value, r->status);
+		break;
+	case 8:
+		printf(" bit %u polls %u status %d", (unsigned) r->addr,
+				(unsigned) r->value, r->status);
+		break;
+	case 9:
+		printf(" target %u event %u", (unsigned) r->id,
+				(unsigned) r->value);
+		break;
+	default:
+		printf(" status %d id %u addr 0x%08x value 0x%08x",
+				r->status, (unsigned) r->id,
+				(unsigned) r->addr, (unsigned) r->value);
+		break;
+	}
+	printf("\n");
+}
+
+static void show_csv(const struct event_trace_record *r)
+{
+	printf("%llu,%s,%d,%u,0x%x,0x%08x\n",
+			(unsigned long long) r->time_us, type_name(r->type),
+			r->status, (unsigned) r->id,
+			(unsigned) r->addr, (unsigned) r->value);
+}
+
+int main(int argc, char **argv)
+{
+	struct event_trace_header header;
+	struct event_trace_record r;
+	int csv = 0;
+	int c;
+
+	while ((c = getopt(argc, argv, "c")) != EOF) {
+		switch (c) {
+		case 'c':
+			csv = 1;
+			break;
+		default:
+			goto usage;
+		}
+	}
+	if (optind != argc - 1)
+		goto usage;
+
+	FILE *f = fopen(argv[optind], "rb");
+	if (!f) {
+		perror(argv[optind]);
+		return 1;
+	}
+
+	if (fread(&header, sizeof(header), 1, f) != 1
+			|| memcmp(header.magic, EVENT_TRACE_MAGIC,
+				sizeof(EVENT_TRACE_MAGIC)) != 0
+			|| header.version != EVENT_TRACE_VERSION
+			|| header.record_size != sizeof(r)
+			|| header.capacity == 0) {
+		fprintf(stderr, "%s: not an event trace this tool knows\n",
+				argv[optind]);
+		return 1;
+	}
+
+	/* once the ring has wrapped, the oldest record is at head */
+	uint64_t first = 0;
+	if (header.head > header.capacity) {
+		first = header.head - header.capacity;
+		fprintf(stderr, "%llu older records were overwritten\n",
+				(unsigned long long) first);
+	}
+
+	if (csv)
+		printf("time_us,type,status,id,addr,value\n");
+
+	for (uint64_t i = first; i < header.head; i++) {
+		long offset = sizeof(header)
+				+ (long)(i % header.capacity) * sizeof(r);
+		if (fseek(f, offset, SEEK_SET) != 0
+				|| fread(&r, sizeof(r), 1, f) != 1)
+			break;
+		if (csv)
+			show_csv(&r);
+		else
+			show_text(&r);
+	}
+
+	fclose(f);
+	return 0;
+
+usage:
+	fprintf(stderr, "usage: %s [-c] tracefile\n", argv[0]);
+	return 1;
+}
@@ -0,0 +1,75 @@
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+	parameters:
+	r0 - address of block table in
+	r1 - block count
+
+	each table entry is an (address, char count) pair; the char
+	count is replaced by the crc of that block
+*/
+
+	.text
+	.syntax unified
+	.arch armv7-m
+	.thumb
+	.thumb_func
+
+	.align	2
+
+_start:
+main:
+	mov		r8, r0
+	mov		r9, r1
+	ldr		r7, CRC32XOR
+	b		nblock
+block:
+	ldr		r2, [r8], #4
+	ldr		r3, [r8]
+	mov		r0, #0xffffffff	/* crc */
+	mov		r4, #0
+	b		ncomp
+nbyte:
+	ldrb	r1, [r2, r4]
+	eor		r0, r0, r1, asl #24
+	mov		r5, #0
+loop:
+	cmp		r0, #0
+	mov		r6, r0, asl #1
+	add		r5, r5, #1
+	mov		r0, r6
+	it		lt
+	eorlt	r0, r6, r7
+	cmp		r5, #8
+	bne		loop
+
+	add		r4, r4, #1
+ncomp:
+	cmp		r4, r3
+	bne		nbyte
+	str		r0, [r8], #4
+	sub		r9, r9, #1
+nblock:
+	cmp		r9, #0
+	bne		block
+	bkpt	#0
+
+CRC32XOR:	.word	0x04c11db7
+
+	.end
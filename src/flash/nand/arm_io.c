@@ -41,7 +41,8 @@
  * @param additional Size of the additional area to be allocated in addition to
  *                   code
  * @param area Pointer to a pointer to a working area to copy code to
- * @return Success or failure of the operation
+ * @return Success, or ERROR_NAND_NO_BUFFER if the working area could not
+ *	be allocated or the code could not be copied into it
  */
 static int arm_code_to_working_area(struct target *target,
 		const uint32_t *code, unsigned code_size,
@@ -73,8 +74,25 @@ static int arm_code_to_working_area(struct target *target,
 	/* copy code to work area */
 	retval = target_write_memory(target, (*area)->address,
 			4, code_size / 4, code_buf);
+	if (retval != ERROR_OK) {
+		LOG_DEBUG("%s: can't load the copy loop", __FUNCTION__);
+		return ERROR_NAND_NO_BUFFER;
+	}
 
-	return retval;
+	return ERROR_OK;
+}
+
+/*
+ * After the copy loop failed to run, the working area holds code in an
+ * unknown state; drop it so the next transfer reloads it from scratch.
+ * Some of the data may have gone through the NAND data register, so the
+ * transfer can't be redone some other way.
+ */
+static void arm_nand_algorithm_failed(struct arm_nand_data *nand)
+{
+	target_free_working_area(nand->target, nand->copy_area);
+	nand->copy_area = NULL;
+	nand->op = ARM_NAND_NONE;
 }
 
 /**
@@ -91,7 +109,8 @@ static int arm_code_to_working_area(struct target *target,
  * @param nand Pointer to the arm_nand_data struct that defines the I/O
  * @param data Pointer to the data to be copied to flash
  * @param size Size of the data being copied
- * @return Success or failure of the operation
+ * @return Success or failure of the operation; ERROR_NAND_NO_BUFFER if
+ *	the copy loop could not be loaded, before any data was moved
  */
 int arm_nandwrite(struct arm_nand_data *nand, uint8_t *data, int size)
 {
@@ -122,6 +141,8 @@ int arm_nandwrite(struct arm_nand_data *nand, uint8_t *data, int size)
 		retval = arm_code_to_working_area(target, code, sizeof(code),
 				nand->chunk_size, &nand->copy_area);
 		if (retval != ERROR_OK) {
+			/* the area may hold neither loop now */
+			nand->op = ARM_NAND_NONE;
 			return retval;
 		}
 	}
@@ -158,8 +179,10 @@ int arm_nandwrite(struct arm_nand_data *nand, uint8_t *data, int size)
 	/* use alg to write data from work area to NAND chip */
 	retval = target_run_algorithm(target, 0, NULL, 3, reg_params,
 			nand->copy_area->address, exit_var, 1000, &algo);
-	if (retval != ERROR_OK)
+	if (retval != ERROR_OK) {
 		LOG_ERROR("error executing hosted NAND write");
+		arm_nand_algorithm_failed(nand);
+	}
 
 	destroy_reg_param(&reg_params[0]);
 	destroy_reg_param(&reg_params[1]);
@@ -175,7 +198,8 @@ int arm_nandwrite(struct arm_nand_data *nand, uint8_t *data, int size)
  * @param nand Pointer to the arm_nand_data struct that defines the I/O
  * @param data Pointer to the data buffer to store the read data
  * @param size Amount of data to be stored to the buffer.
- * @return Success or failure of the operation
+ * @return Success or failure of the operation; ERROR_NAND_NO_BUFFER if
+ *	the copy loop could not be loaded, before any data was moved
  */
 int arm_nandread(struct arm_nand_data *nand, uint8_t *data, uint32_t size)
 {
@@ -207,6 +231,8 @@ int arm_nandread(struct arm_nand_data *nand, uint8_t *data, uint32_t size)
 		retval = arm_code_to_working_area(target, code, sizeof(code),
 				nand->chunk_size, &nand->copy_area);
 		if (retval != ERROR_OK) {
+			/* the area may hold neither loop now */
+			nand->op = ARM_NAND_NONE;
 			return retval;
 		}
 	}
@@ -234,16 +260,72 @@ int arm_nandread(struct arm_nand_data *nand, uint8_t *data, uint32_t size)
 	/* use alg to write data from NAND chip to work area */
 	retval = target_run_algorithm(target, 0, NULL, 3, reg_params,
 			nand->copy_area->address, exit_var, 1000, &algo);
-	if (retval != ERROR_OK)
+	if (retval != ERROR_OK) {
 		LOG_ERROR("error executing hosted NAND read");
+		arm_nand_algorithm_failed(nand);
+	}
 
 	destroy_reg_param(&reg_params[0]);
 	destroy_reg_param(&reg_params[1]);
 	destroy_reg_param(&reg_params[2]);
 
 	/* read from work area to the host's memory */
-	retval = target_read_buffer(target, target_buf, size, data);
+	if (retval == ERROR_OK)
+		retval = target_read_buffer(target, target_buf, size, data);
 
 	return retval;
 }
 
+
+/**
+ * Moves data between the host and the data register of an 8-bit NAND
+ * device, using arm_nandread() or arm_nandwrite() a chunk at a time.
+ * Any controller with a plain memory mapped data register can use this,
+ * on a halted ARM core which runs ARM code.
+ *
+ * @param nand Pointer to the arm_nand_data struct that defines the I/O;
+ *	its chunk_size bounds each transfer
+ * @param data Pointer to the data to be written, or the buffer to read into
+ * @param size Number of bytes to move
+ * @param write True to write to the NAND device, false to read from it
+ * @return ERROR_NAND_NO_BUFFER if the target can't run the copy loops,
+ *	so the caller should move the data some other way; otherwise success
+ *	or failure of the transfer
+ */
+int arm_nand_transfer(struct arm_nand_data *nand, uint8_t *data,
+		uint32_t size, bool write)
+{
+	struct target *target = nand->target;
+	struct arm *arm = target_to_arm(target);
+	uint32_t done = 0;
+	int retval = ERROR_OK;
+
+	/* Cortex-M cores can't run ARM code */
+	if (target->state != TARGET_HALTED || !is_arm(arm)
+			|| arm->core_type == ARM_MODE_THREAD
+			|| nand->chunk_size == 0)
+		return ERROR_NAND_NO_BUFFER;
+
+	while (size > 0 && retval == ERROR_OK) {
+		uint32_t chunk = (size > nand->chunk_size)
+				? nand->chunk_size : size;
+
+		if (write)
+			retval = arm_nandwrite(nand, data, chunk);
+		else
+			retval = arm_nandread(nand, data, chunk);
+
+		/* earlier chunks went through already; they can't be redone */
+		if (retval == ERROR_NAND_NO_BUFFER && done > 0) {
+			LOG_ERROR("NAND %s failed after %u bytes",
+					write ? "write" : "read", (unsigned) done);
+			retval = ERROR_FAIL;
+		}
+
+		data += chunk;
+		done += chunk;
+		size -= chunk;
+	}
+
+	return retval;
+}
@@ -25,10 +25,14 @@
 #endif
 
 #include "imp.h"
+#include "arm_io.h"
 
 /* configured NAND devices and NAND Flash command handler */
 struct nand_device *nand_devices = NULL;
 
+/* file keeping the bad block tables found by earlier scans */
+static char *nand_bbt_cache_file = NULL;
+
 void nand_device_add(struct nand_device *c)
 {
 	if (nand_devices) {
@@ -226,12 +230,199 @@ COMMAND_HELPER(nand_command_get_device, unsigned name_index,
 	return ERROR_OK;
 }
 
+/* Reads the whole BBT cache; returns NULL if there is none yet. */
+static char *nand_bbt_cache_read(void)
+{
+	FILE *f = fopen(nand_bbt_cache_file, "r");
+	if (!f)
+		return NULL;
+
+	char *text = NULL;
+	size_t size = 0, len = 0;
+	for (;;)
+	{
+		if (len + 1 >= size)
+		{
+			size = size ? size * 2 : 4096;
+			char *grown = realloc(text, size);
+			if (!grown)
+			{
+				free(text);
+				text = NULL;
+				break;
+			}
+			text = grown;
+		}
+		size_t n = fread(text + len, 1, size - len - 1, f);
+		if (n == 0)
+		{
+			text[len] = '\0';
+			break;
+		}
+		len += n;
+	}
+	fclose(f);
+
+	return text;
+}
+
+/*
+ * Cache lines are "bank mfr_id device_id blocks bad_block...".  Returns
+ * where the bad block list starts if the line is for this very chip,
+ * else NULL.
+ */
+static char *nand_bbt_cache_match(struct nand_device *nand, char *line)
+{
+	char name[64];
+	unsigned mfr_id, device_id;
+	int blocks, n;
+
+	if (line[0] == '#'
+			|| sscanf(line, "%63s %x %x %d%n", name,
+				&mfr_id, &device_id, &blocks, &n) != 4)
+		return NULL;
+
+	if (strcmp(name, nand->name) != 0
+			|| (int) mfr_id != nand->manufacturer->id
+			|| (int) device_id != nand->device->id
+			|| blocks != nand->num_blocks)
+		return NULL;
+
+	return line + n;
+}
+
+static int nand_bbt_cache_load(struct nand_device *nand)
+{
+	char *text = nand_bbt_cache_read();
+	if (!text)
+	{
+		LOG_DEBUG("no bad block cache '%s'", nand_bbt_cache_file);
+		return ERROR_FAIL;
+	}
+
+	char *list = NULL;
+	for (char *line = text, *next; line && !list; line = next)
+	{
+		next = strchr(line, '\n');
+		if (next)
+			*next++ = '\0';
+		list = nand_bbt_cache_match(nand, line);
+	}
+
+	int retval = ERROR_FAIL;
+	if (list)
+	{
+		int i, bad = 0;
+
+		for (i = 0; i < nand->num_blocks; i++)
+		{
+			nand->blocks[i].is_bad = 0;
+			nand->blocks[i].is_cached = 1;
+		}
+
+		retval = ERROR_OK;
+		for (;;)
+		{
+			char *end;
+			unsigned long block = strtoul(list, &end, 0);
+
+			/* strtoul() skips blanks; anything else left is junk */
+			if (end == list)
+			{
+				list += strspn(list, " \t\r");
+				if (*list)
+					retval = ERROR_FAIL;
+				break;
+			}
+			if (block >= (unsigned long) nand->num_blocks)
+			{
+				retval = ERROR_FAIL;
+				break;
+			}
+			nand->blocks[block].is_bad = 1;
+			bad++;
+			list = end;
+		}
+
+		if (retval == ERROR_OK)
+			LOG_INFO("%s: %d bad blocks, from cache '%s'",
+					nand->name, bad, nand_bbt_cache_file);
+		else
+		{
+			LOG_WARNING("ignoring bad entry for %s in '%s'",
+					nand->name, nand_bbt_cache_file);
+			for (i = 0; i < nand->num_blocks; i++)
+			{
+				nand->blocks[i].is_bad = -1;
+				nand->blocks[i].is_cached = 0;
+			}
+		}
+	}
+	else
+		LOG_DEBUG("no entry for %s in bad block cache", nand->name);
+
+	free(text);
+	return retval;
+}
+
+/* Replaces this bank's entry, keeping those of other banks. */
+static void nand_bbt_cache_save(struct nand_device *nand)
+{
+	char *text = nand_bbt_cache_read();
+
+	FILE *f = fopen(nand_bbt_cache_file, "w");
+	if (!f)
+	{
+		LOG_WARNING("can't write bad block cache '%s'",
+				nand_bbt_cache_file);
+		free(text);
+		return;
+	}
+
+	fprintf(f, "# NAND bad blocks: bank mfr_id device_id blocks bad...\n");
+	for (char *line = text, *next; line && *line; line = next)
+	{
+		char name[64];
+
+		next = strchr(line, '\n');
+		if (next)
+			*next++ = '\0';
+		if (line[0] == '#' || sscanf(line, "%63s", name) != 1
+				|| strcmp(name, nand->name) == 0)
+			continue;
+		fprintf(f, "%s\n", line);
+	}
+
+	fprintf(f, "%s 0x%2.2x 0x%2.2x %d", nand->name,
+			nand->manufacturer->id, nand->device->id,
+			nand->num_blocks);
+	for (int i = 0; i < nand->num_blocks; i++)
+		if (nand->blocks[i].is_bad == 1)
+			fprintf(f, " %d", i);
+	fprintf(f, "\n");
+
+	fclose(f);
+	free(text);
+}
+
+void nand_set_bbt_cache(const char *file)
+{
+	free(nand_bbt_cache_file);
+	nand_bbt_cache_file = file ? strdup(file) : NULL;
+}
+
+const char *nand_get_bbt_cache(void)
+{
+	return nand_bbt_cache_file;
+}
+
 int nand_build_bbt(struct nand_device *nand, int first, int last)
 {
 	uint32_t page;
 	int i;
 	int pages_per_block = (nand->erase_size / nand->page_size);
 	uint8_t oob[6];
+	uint32_t oob_size = sizeof(oob);
 	int ret;
 
 	if ((first < 0) || (first >= nand->num_blocks))
@@ -240,10 +431,32 @@ int nand_build_bbt(struct nand_device *nand, int first, int last)
 	if ((last >= nand->num_blocks) || (last == -1))
 		last = nand->num_blocks - 1;
 
+	/* Raw reads fetch the OOB a byte or word at a time, so they stop
+	 * after the bytes which can hold the bad block marker.
+	 */
+	if (nand->use_raw || nand->controller->read_page == NULL)
+	{
+		if (nand->page_size == 512)
+			oob_size = 6;
+		else if (nand->device->options & NAND_BUSWIDTH_16)
+			oob_size = 2;
+		else
+			oob_size = 1;
+	}
+
 	page = first * pages_per_block;
 	for (i = first; i <= last; i++)
 	{
-		ret = nand_read_page(nand, page, NULL, 0, oob, 6);
+		if (((i - first) & 0x3f) == 0x3f)
+		{
+			keep_alive();
+			ret = command_check_interrupt();
+			if (ret != ERROR_OK)
+				return ret;
+		}
+
+		memset(oob, 0xff, sizeof(oob));
+		ret = nand_read_page(nand, page, NULL, 0, oob, oob_size);
 		if (ret != ERROR_OK)
 			return ret;
 
@@ -258,10 +471,21 @@ int nand_build_bbt(struct nand_device *nand, int first, int last)
 		{
 			nand->blocks[i].is_bad = 0;
 		}
+		nand->blocks[i].is_cached = 0;
 
 		page += pages_per_block;
 	}
 
+	/* once every block is known, later sessions can start from here */
+	if (nand_bbt_cache_file)
+	{
+		for (i = 0; i < nand->num_blocks; i++)
+			if (nand->blocks[i].is_bad == -1)
+				break;
+		if (i == nand->num_blocks)
+			nand_bbt_cache_save(nand);
+	}
+
 	return ERROR_OK;
 }
 
@@ -526,8 +750,12 @@ int nand_probe(struct nand_device *nand)
 		nand->blocks[i].offset = i * nand->erase_size;
 		nand->blocks[i].is_erased = -1;
 		nand->blocks[i].is_bad = -1;
+		nand->blocks[i].is_cached = 0;
 	}
 
+	if (nand_bbt_cache_file)
+		nand_bbt_cache_load(nand);
+
 	return ERROR_OK;
 }
 
@@ -606,6 +834,10 @@ int nand_erase(struct nand_device *nand, int first_block, int last_block)
 
 		if (status & 0x1)
 		{
+			/* a block which went bad since the cache was saved */
+			if (nand->blocks[i].is_cached)
+				nand_build_bbt(nand, i, i);
+
 			LOG_ERROR("didn't erase %sblock %d; status: 0x%2.2x",
 					(nand->blocks[i].is_bad == 1)
 						? "bad " : "",
@@ -791,11 +1023,50 @@ int nand_page_command(struct nand_device *nand, uint32_t page,
 	return ERROR_OK;
 }
 
+/* Below this, starting code on the target costs more than it saves. */
+#define NAND_DATA_IO_MIN	128
+
+int nand_set_data_register(struct nand_device *nand, uint32_t address)
+{
+	struct arm_nand_data *io = calloc(1, sizeof(*io));
+	if (NULL == io)
+		return ERROR_FAIL;
+
+	io->target = nand->target;
+	io->data = address;
+	io->op = ARM_NAND_NONE;
+
+	free(nand->data_io);
+	nand->data_io = io;
+	return ERROR_OK;
+}
+
+/*
+ * Moves data through the controller's data register with code run on
+ * the target, if the controller declared one; ERROR_NAND_NO_BUFFER means
+ * the caller must move it some other way.
+ */
+static int nand_data_io(struct nand_device *nand, uint8_t *data,
+		uint32_t size, bool write)
+{
+	struct arm_nand_data *io = nand->data_io;
+
+	if (NULL == io || nand->bus_width != 8 || size < NAND_DATA_IO_MIN)
+		return ERROR_NAND_NO_BUFFER;
+
+	/* room for a page and its OOB; the working area keeps this size */
+	if (io->chunk_size == 0)
+		io->chunk_size = nand->page_size + nand->page_size / 16;
+
+	return arm_nand_transfer(io, data, size, write);
+}
+
 int nand_read_data_page(struct nand_device *nand, uint8_t *data, uint32_t size)
 {
-	int retval = ERROR_NAND_NO_BUFFER;
+	int retval = nand_data_io(nand, data, size, false);
 
-	if (nand->controller->read_block_data != NULL)
+	if (ERROR_NAND_NO_BUFFER == retval
+			&& nand->controller->read_block_data != NULL)
 		retval = (nand->controller->read_block_data)(nand, data, size);
 
 	if (ERROR_NAND_NO_BUFFER == retval) {
@@ -822,6 +1093,24 @@ int nand_read_page_raw(struct nand_device *nand, uint32_t page,
 	if (ERROR_OK != retval)
 		return retval;
 
+	/* The OOB follows the page on the bus; when the target copies the
+	 * data, fetching both in one go saves starting the copy twice.
+	 */
+	if (data && oob && nand->data_io
+			&& data_size == (uint32_t) nand->page_size)
+	{
+		uint8_t *buffer = malloc(data_size + oob_size);
+		if (NULL != buffer)
+		{
+			retval = nand_read_data_page(nand, buffer,
+					data_size + oob_size);
+			memcpy(data, buffer, data_size);
+			memcpy(oob, buffer + data_size, oob_size);
+			free(buffer);
+			return retval;
+		}
+	}
+
 	if (data)
 		nand_read_data_page(nand, data, data_size);
 
@@ -833,9 +1122,10 @@ int nand_read_page_raw(struct nand_device *nand, uint32_t page,
 
 int nand_write_data_page(struct nand_device *nand, uint8_t *data, uint32_t size)
 {
-	int retval = ERROR_NAND_NO_BUFFER;
+	int retval = nand_data_io(nand, data, size, true);
 
-	if (nand->controller->write_block_data != NULL)
+	if (ERROR_NAND_NO_BUFFER == retval
+			&& nand->controller->write_block_data != NULL)
 		retval = (nand->controller->write_block_data)(nand, data, size);
 
 	if (ERROR_NAND_NO_BUFFER == retval) {
@@ -899,6 +1189,24 @@ int nand_write_page_raw(struct nand_device *nand, uint32_t page,
 	if (ERROR_OK != retval)
 		return retval;
 
+	/* as for reads, page and OOB can go out in one transfer */
+	if (data && oob && nand->data_io
+			&& data_size == (uint32_t) nand->page_size) {
+		uint8_t *buffer = malloc(data_size + oob_size);
+		if (NULL != buffer) {
+			memcpy(buffer, data, data_size);
+			memcpy(buffer + data_size, oob, oob_size);
+			retval = nand_write_data_page(nand, buffer,
+					data_size + oob_size);
+			free(buffer);
+			if (ERROR_OK != retval) {
+				LOG_ERROR("Unable to write data to NAND device");
+				return retval;
+			}
+			return nand_write_finish(nand);
+		}
+	}
+
 	if (data) {
 		retval = nand_write_data_page(nand, data, data_size);
 		if (ERROR_OK != retval) {
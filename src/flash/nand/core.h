@@ -43,6 +43,9 @@ struct nand_block
 
 	/** True if the block is bad. */
 	int is_bad;
+
+	/** True if is_bad came from the BBT cache, not from this chip. */
+	int is_cached;
 };
 
 struct nand_oobfree {
@@ -72,6 +75,9 @@ struct nand_device
 	int use_raw;
 	int num_blocks;
 	struct nand_block *blocks;
+	/** Copies page data through the controller's data register with
+	 * code run on the target; NULL unless the controller has one. */
+	struct arm_nand_data *data_io;
 	struct nand_device *next;
 };
 
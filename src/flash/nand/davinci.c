@@ -775,7 +775,7 @@ NAND_DEVICE_COMMAND_HANDLER(davinci_nand_device_command)
 		break;
 	}
 
-	return ERROR_OK;
+	return nand_set_data_register(nand, info->data);
 
 fail:
 	return ERROR_NAND_OPERATION_FAILED;
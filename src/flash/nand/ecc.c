@@ -2,9 +2,9 @@
  * This file contains an ECC algorithm from Toshiba that allows for detection
  * and correction of 1-bit errors in a 256 byte block of data.
  *
- * [ Extracted from the initial code found in some early Linux versions.
- *   The current Linux code is bigger while being faster, but this is of
- *   no real benefit when the bottleneck largely remains the JTAG link.  ]
+ * [ Extracted from the initial code found in some early Linux versions,
+ *   then reworked to fold the data a 64-bit word at a time; software ECC
+ *   runs over every page of a whole-chip dump or write.  ]
  *
  * Copyright (C) 2000-2004 Steven J. Hill (sjhill at realitydiluted.com)
  *                         Toshiba America Electronics Components, Inc.
@@ -65,29 +65,65 @@ static const uint8_t nand_ecc_precalc_table[] = {
 	0x00, 0x55, 0x56, 0x03, 0x59, 0x0c, 0x0f, 0x5a, 0x5a, 0x0f, 0x0c, 0x59, 0x03, 0x56, 0x55, 0x00
 };
 
+/* Parity of a 64-bit word, folded down to a byte for the table above. */
+static inline uint8_t nand_ecc_parity64(uint64_t w)
+{
+	w ^= w >> 32;
+	w ^= w >> 16;
+	w ^= w >> 8;
+	return nand_ecc_precalc_table[(uint8_t) w] & 0x40;
+}
+
 /*
  * nand_calculate_ecc - Calculate 3-byte ECC for 256-byte block
+ *
+ * Every parity bit is linear in the data, so rather than looking up each
+ * byte, the block is folded 64 bits at a time: one accumulator for all
+ * words, and one per bit of the word index.  The byte within a word is
+ * resolved from the first accumulator, whose bytes also give the column
+ * parity through the table.
  */
 int nand_calculate_ecc(struct nand_device *nand, const uint8_t *dat, uint8_t *ecc_code)
 {
-	uint8_t idx, reg1, reg2, reg3, tmp1, tmp2;
+	uint8_t reg1, reg2, reg3, tmp1, tmp2, idx;
+	uint64_t all = 0, line[5] = { 0, 0, 0, 0, 0 };
+	uint8_t lanes[8];
 	int i;
 
-	/* Initialize variables */
-	reg1 = reg2 = reg3 = 0;
+	for (i = 0; i < 32; i++) {
+		uint64_t w;
+
+		memcpy(&w, dat + 8 * i, sizeof(w));
+		all ^= w;
+		if (i & 0x01)
+			line[0] ^= w;
+		if (i & 0x02)
+			line[1] ^= w;
+		if (i & 0x04)
+			line[2] ^= w;
+		if (i & 0x08)
+			line[3] ^= w;
+		if (i & 0x10)
+			line[4] ^= w;
+	}
 
-	/* Build up column parity */
-	for (i = 0; i < 256; i++) {
-		/* Get CP0 - CP5 from table */
-		idx = nand_ecc_precalc_table[*dat++];
-		reg1 ^= (idx & 0x3f);
+	/* Byte lanes of the sum keep the low 3 bits of the byte index */
+	memcpy(lanes, &all, sizeof(lanes));
 
-		/* All bit XOR = 1 ? */
-		if (idx & 0x40) {
+	/* Line parity: byte index bits of all bytes with odd parity */
+	reg3 = 0;
+	for (i = 0; i < 8; i++)
+		if (nand_ecc_precalc_table[lanes[i]] & 0x40)
 			reg3 ^= (uint8_t) i;
-			reg2 ^= ~((uint8_t) i);
-		}
-	}
+	for (i = 0; i < 5; i++)
+		if (nand_ecc_parity64(line[i]))
+			reg3 |= 0x08 << i;
+
+	/* Column parity CP0 - CP5, and whether all bits XOR to 1 */
+	idx = nand_ecc_precalc_table[lanes[0] ^ lanes[1] ^ lanes[2] ^ lanes[3]
+			^ lanes[4] ^ lanes[5] ^ lanes[6] ^ lanes[7]];
+	reg1 = idx & 0x3f;
+	reg2 = (idx & 0x40) ? ~reg3 : reg3;
 
 	/* Create non-inverted ECC code from line parity */
 	tmp1  = (reg3 & 0x80) >> 0; /* B7 -> B7 */
@@ -98,65 +98,81 @@ static void gf_build_log_exp_table(void)
  * expects the ECC to be computed backward, i.e. from the last byte down
  * to the first one.
  */
+
+/*
+ * The eight multiples of the generator polynomial, for each value of the
+ * symbol leaving the register, packed four 16-bit lanes to a word in the
+ * same order as the register halves below: gen_hi holds the terms for
+ * r7..r4, gen_lo those for r3..r0.  Entry 0 is all zero, so a step needs
+ * neither a log lookup nor a branch.
+ */
+static uint64_t gen_hi[1024];
+static uint64_t gen_lo[1024];
+
+static void gf_build_gen_table(void)
+{
+	int i;
+
+	gf_build_log_exp_table();
+
+	for (i = 1; i < 1024; i++) {
+		uint16_t *t = gf_exp + gf_log[i];
+
+		gen_hi[i] = (uint64_t) t[0x21c] << 48 | (uint64_t) t[0x181] << 32
+			| (uint64_t) t[0x18e] << 16 | t[0x25f];
+		gen_lo[i] = (uint64_t) t[0x197] << 48 | (uint64_t) t[0x193] << 32
+			| (uint64_t) t[0x237] << 16 | t[0x024];
+	}
+}
+
 int nand_calculate_ecc_kw(struct nand_device *nand, const uint8_t *data, uint8_t *ecc)
 {
 	unsigned int r7, r6, r5, r4, r3, r2, r1, r0;
+	uint64_t hi, lo;
 	int i;
 	static int tables_initialized = 0;
 
 	if (!tables_initialized) {
-		gf_build_log_exp_table();
+		gf_build_gen_table();
 		tables_initialized = 1;
 	}
 
 	/*
-	 * Load bytes 504..511 of the data into r.
+	 * Load bytes 504..511 of the data into r, held as two words of
+	 * four 16-bit symbols: r7..r4 in hi and r3..r0 in lo, r7 and r3
+	 * in the top lanes.
 	 */
-	r0 = data[504];
-	r1 = data[505];
-	r2 = data[506];
-	r3 = data[507];
-	r4 = data[508];
-	r5 = data[509];
-	r6 = data[510];
-	r7 = data[511];
-
+	hi = (uint64_t) data[511] << 48 | (uint64_t) data[510] << 32
+		| (uint64_t) data[509] << 16 | data[508];
+	lo = (uint64_t) data[507] << 48 | (uint64_t) data[506] << 32
+		| (uint64_t) data[505] << 16 | data[504];
 
 	/*
 	 * Shift bytes 503..0 (in that order) into r0, followed
 	 * by eight zero bytes, while reducing the polynomial by the
-	 * generator polynomial in every step.
+	 * generator polynomial in every step.  Shifting both words up
+	 * one lane moves every symbol at once; the symbol falling out
+	 * of r7 then selects the multiple of the generator to add.
 	 */
 	for (i = 503; i >= -8; i--) {
-		unsigned int d;
-
-		d = 0;
-		if (i >= 0)
-			d = data[i];
-
-		if (r7) {
-			uint16_t *t = gf_exp + gf_log[r7];
-
-			r7 = r6 ^ t[0x21c];
-			r6 = r5 ^ t[0x181];
-			r5 = r4 ^ t[0x18e];
-			r4 = r3 ^ t[0x25f];
-			r3 = r2 ^ t[0x197];
-			r2 = r1 ^ t[0x193];
-			r1 = r0 ^ t[0x237];
-			r0 = d  ^ t[0x024];
-		} else {
-			r7 = r6;
-			r6 = r5;
-			r5 = r4;
-			r4 = r3;
-			r3 = r2;
-			r2 = r1;
-			r1 = r0;
-			r0 = d;
-		}
+		unsigned int d = (i >= 0) ? data[i] : 0;
+		unsigned int fb = hi >> 48;
+
+		hi = (hi << 16) | (lo >> 48);
+		lo = (lo << 16) | d;
+		hi ^= gen_hi[fb];
+		lo ^= gen_lo[fb];
 	}
 
+	r7 = (hi >> 48) & 0x3ff;
+	r6 = (hi >> 32) & 0x3ff;
+	r5 = (hi >> 16) & 0x3ff;
+	r4 = hi & 0x3ff;
+	r3 = (lo >> 48) & 0x3ff;
+	r2 = (lo >> 32) & 0x3ff;
+	r1 = (lo >> 16) & 0x3ff;
+	r0 = lo & 0x3ff;
+
 	ecc[0] = r0;
 	ecc[1] = (r0 >> 8) | (r1 << 2);
 	ecc[2] = (r1 >> 6) | (r2 << 4);
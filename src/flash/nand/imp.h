@@ -32,8 +32,27 @@ int nand_read_page(struct nand_device *nand, uint32_t page,
 		uint8_t *data, uint32_t data_size,
 		uint8_t *oob, uint32_t oob_size);
 
+/**
+ * Declare the controller's plain 8-bit data register, so raw page reads
+ * and writes can copy whole pages through it with code run on the
+ * target instead of one host access per byte.  Controller drivers call
+ * this while handling "nand device".
+ * @param nand The NAND device being created.
+ * @param address Where the data register is mapped.
+ */
+int nand_set_data_register(struct nand_device *nand, uint32_t address);
+
 int nand_probe(struct nand_device *nand);
 int nand_erase(struct nand_device *nand, int first_block, int last_block);
 int nand_build_bbt(struct nand_device *nand, int first, int last);
 
+/**
+ * Keep the bad block tables found by full scans in a file, and load
+ * them when a matching chip is probed.
+ * @param file Where the tables are kept, or NULL to stop caching.
+ */
+void nand_set_bbt_cache(const char *file);
+/// @returns The bad block cache file, or NULL if no cache is used.
+const char *nand_get_bbt_cache(void);
+
 #endif // FLASH_NAND_IMP_H
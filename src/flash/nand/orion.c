@@ -145,7 +145,7 @@ NAND_DEVICE_COMMAND_HANDLER(orion_nand_device_command)
 	hw->io.data = hw->data;
 	hw->io.op = ARM_NAND_NONE;
 
-	return ERROR_OK;
+	return nand_set_data_register(nand, hw->data);
 }
 
 static int orion_nand_init(struct nand_device *nand)
@@ -41,7 +41,7 @@ NAND_DEVICE_COMMAND_HANDLER(s3c2410_nand_device_command)
 	info->data = S3C2410_NFDATA;
 	info->nfstat = S3C2410_NFSTAT;
 
-	return ERROR_OK;
+	return nand_set_data_register(nand, info->data);
 }
 
 static int s3c2410_init(struct nand_device *nand)
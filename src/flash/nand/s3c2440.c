@@ -42,7 +42,7 @@ NAND_DEVICE_COMMAND_HANDLER(s3c2440_nand_device_command)
 	info->data = S3C2440_NFDATA;
 	info->nfstat = S3C2440_NFSTAT;
 
-	return ERROR_OK;
+	return nand_set_data_register(nand, info->data);
 }
 
 static int s3c2440_init(struct nand_device *nand)
@@ -38,7 +38,7 @@ NAND_DEVICE_COMMAND_HANDLER(s3c6400_nand_device_command)
 	info->data = S3C2440_NFDATA;
 	info->nfstat = S3C2412_NFSTAT;
 
-	return ERROR_OK;
+	return nand_set_data_register(nand, info->data);
 }
 
 static int s3c6400_init(struct nand_device *nand)
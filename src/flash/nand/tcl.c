@@ -118,7 +118,8 @@ COMMAND_HANDLER(handle_nand_info_command)
 		if (p->blocks[j].is_bad == 0)
 			bad_state = "";
 		else if (p->blocks[j].is_bad == 1)
-			bad_state = " (marked bad)";
+			bad_state = p->blocks[j].is_cached
+					? " (marked bad, cached)" : " (marked bad)";
 		else
 			bad_state = " (block condition unknown)";
 
@@ -577,12 +578,14 @@ static COMMAND_HELPER(create_nand_device, const char *bank_name,
 	c->address_cycles = 0;
 	c->page_size = 0;
 	c->use_raw = 0;
+	c->data_io = NULL;
 	c->next = NULL;
 
 	retval = CALL_COMMAND_HANDLER(controller->nand_device_command, c);
 	if (ERROR_OK != retval)
 	{
 		LOG_ERROR("'%s' driver rejected nand flash", controller->name);
+		free(c->data_io);
 		free(c);
 		return ERROR_OK;
 	}
@@ -615,6 +618,25 @@ COMMAND_HANDLER(handle_nand_device_command)
 	return CALL_COMMAND_HANDLER(create_nand_device, bank_name, controller);
 }
 
+COMMAND_HANDLER(handle_nand_bbt_cache_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1)
+	{
+		if (strcmp(CMD_ARGV[0], "none") == 0)
+			nand_set_bbt_cache(NULL);
+		else
+			nand_set_bbt_cache(CMD_ARGV[0]);
+	}
+
+	const char *file = nand_get_bbt_cache();
+	command_print(CMD_CTX, "bad block cache: %s", file ? file : "none");
+
+	return ERROR_OK;
+}
+
 static const struct command_registration nand_config_command_handlers[] = {
 	{
 		.name = "device",
@@ -635,6 +657,14 @@ static const struct command_registration nand_config_command_handlers[] = {
 		.handler = &handle_nand_init_command,
 		.help = "initialize NAND devices",
 	},
+	{
+		.name = "bbt_cache",
+		.mode = COMMAND_ANY,
+		.handler = &handle_nand_bbt_cache_command,
+		.help = "Keep bad block tables found by full scans in a "
+			"file, and load them when the same chip is probed.",
+		.usage = "[filename|'none']",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 static const struct command_registration nand_command_handlers[] = {
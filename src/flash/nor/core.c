@@ -557,37 +557,135 @@ int flash_unlock_address_range(struct target *target, uint32_t addr, uint32_t le
 			addr, length, &flash_driver_unprotect);
 }
 
-static int compare_section (const void * a, const void * b)
+/* Image sections in one bank which are at most this far apart are
+ * written as one run, with the gap between them padded.
+ */
+static uint32_t flash_gap_limit = 0xffffffff;
+/* the value gaps are padded with, or -1 to keep the flash contents */
+static int flash_gap_pad = 0xff;
+
+void flash_set_gap_fill(uint32_t limit, int pad)
 {
-	struct imagesection *b1, *b2;
-	b1=*((struct imagesection **)a);
-	b2=*((struct imagesection **)b);
+	flash_gap_limit = limit;
+	flash_gap_pad = pad;
+}
 
-	if (b1->base_address == b2->base_address)
-	{
-		return 0;
-	} else if (b1->base_address > b2->base_address)
-	{
-		return 1;
-	} else
+void flash_get_gap_fill(uint32_t *limit, int *pad)
+{
+	*limit = flash_gap_limit;
+	*pad = flash_gap_pad;
+}
+
+static int flash_read_gap(void *priv, uint32_t address, uint32_t size,
+		uint8_t *buffer)
+{
+	return target_read_buffer(priv, address, size, buffer);
+}
+
+/* offset of the end of the sector containing bank offset @a offset */
+static uint32_t flash_sector_end(struct flash_bank *bank, uint32_t offset)
+{
+	int sector;
+
+	for (sector = 0; sector < bank->num_sectors; sector++)
 	{
-		return -1;
+		uint32_t end = bank->sectors[sector].offset
+				+ bank->sectors[sector].size;
+		if (offset < end)
+			return end;
 	}
+
+	return bank->size;
 }
 
+/* write the runs of an image plan for bank @a c */
+static int flash_write_plan(struct target *target, struct flash_bank *c,
+		struct image *image, struct image_plan *plan,
+		uint32_t *written, int erase, bool unlock)
+{
+	int retval = ERROR_OK;
+	int i = 0;
+
+	while (i < plan->num_runs)
+	{
+		uint32_t run_address = plan->runs[i].base_address;
+		uint32_t run_size = plan->runs[i].size;
+		uint8_t *buffer;
+
+		retval = command_check_interrupt();
+		if (retval != ERROR_OK)
+			return retval;
+
+		i++;
+
+		/* If we're applying any sector automagic, then pad this run
+		 * to the end of its last sector.  Runs which then share a
+		 * sector are written together, so erasing for one of them
+		 * can't destroy the other.
+		 */
+		if (unlock || erase)
+		{
+			for (;;)
+			{
+				uint32_t offset = run_address - c->base;
+				uint32_t end = flash_sector_end(c,
+						offset + run_size - 1);
+
+				run_size = end - offset;
+				if ((i == plan->num_runs)
+						|| (plan->runs[i].base_address - c->base >= end))
+					break;
+				run_size = plan->runs[i].base_address
+						+ plan->runs[i].size - run_address;
+				i++;
+			}
+		}
+
+		buffer = malloc(run_size);
+		if (buffer == NULL)
+		{
+			LOG_ERROR("Out of memory for flash bank buffer");
+			return ERROR_FAIL;
+		}
+
+		LOG_DEBUG("flash run at 0x%8.8" PRIx32 ", %" PRIu32 " bytes",
+				run_address, run_size);
+		retval = image_plan_read(image, plan, run_address, run_size, buffer);
+
+		if ((retval == ERROR_OK) && unlock)
+		{
+			retval = flash_unlock_address_range(target, run_address, run_size);
+		}
+		if ((retval == ERROR_OK) && erase)
+		{
+			/* calculate and erase sectors */
+			retval = flash_erase_address_range(target,
+					true, run_address, run_size);
+		}
+		if (retval == ERROR_OK)
+		{
+			/* write flash sectors */
+			retval = flash_driver_write(c, buffer, run_address - c->base, run_size);
+		}
+
+		free(buffer);
+
+		if (retval != ERROR_OK)
+			return retval;
+
+		if (written != NULL)
+			*written += run_size; /* add run size to total written counter */
+	}
+
+	return ERROR_OK;
+}
 
 int flash_write_unlock(struct target *target, struct image *image,
 		uint32_t *written, int erase, bool unlock)
 {
 	int retval = ERROR_OK;
-
-	int section;
-	uint32_t section_offset;
+	struct image_plan plan;
 	struct flash_bank *c;
-	int *padding;
-
-	section = 0;
-	section_offset = 0;
 
 	if (written)
 		*written = 0;
@@ -600,220 +698,233 @@ int flash_write_unlock(struct target *target, struct image *image,
 		flash_set_dirty();
 	}
 
-	/* allocate padding array */
-	padding = calloc(image->num_sections, sizeof(*padding));
-
-	/* This fn requires all sections to be in ascending order of addresses,
-	 * whereas an image can have sections out of order. */
-	struct imagesection **sections = malloc(sizeof(struct imagesection *) *
-			image->num_sections);
-	int i;
-	for (i = 0; i < image->num_sections; i++)
+	/* Plan each bank's part of the image separately: sections are
+	 * sorted, and those close together joined into runs, so that
+	 * images with many small sections don't need one flash algorithm
+	 * run per section.  Sections outside all banks are ignored.
+	 */
+	image_plan_init(&plan);
+	plan.max_gap = flash_gap_limit;
+	if (flash_gap_pad < 0)
 	{
-		sections[i] = &image->sections[i];
+		plan.read_gap = flash_read_gap;
+		plan.priv = target;
 	}
+	else
+		plan.pad = flash_gap_pad;
 
-	qsort(sections, image->num_sections, sizeof(struct imagesection *),
-			compare_section);
-
-	/* loop until we reach end of the image */
-	while (section < image->num_sections)
+	for (c = flash_banks; c; c = c->next)
 	{
-		uint32_t buffer_size;
-		uint8_t *buffer;
-		int section_last;
-		uint32_t run_address = sections[section]->base_address + section_offset;
-		uint32_t run_size = sections[section]->size - section_offset;
-		int pad_bytes = 0;
-
-		if (sections[section]->size ==  0)
-		{
-			LOG_WARNING("empty section %d", section);
-			section++;
-			section_offset = 0;
+		if (c->target != target)
 			continue;
-		}
 
-		/* find the corresponding flash bank */
-		retval = get_flash_bank_by_addr(target, run_address, false, &c);
+		retval = c->driver->auto_probe(c);
 		if (retval != ERROR_OK)
 		{
-			goto done;
+			LOG_ERROR("auto_probe failed");
+			break;
 		}
-		if (c == NULL)
-		{
-			section++; /* and skip it */
-			section_offset = 0;
+		if (c->size == 0)
 			continue;
-		}
 
-		/* collect consecutive sections which fall into the same bank */
-		section_last = section;
-		padding[section] = 0;
-		while ((run_address + run_size - 1 < c->base + c->size - 1)
-				&& (section_last + 1 < image->num_sections))
-		{
-			/* sections are sorted */
-			assert(sections[section_last + 1]->base_address >= c->base);
-			if (sections[section_last + 1]->base_address >= (c->base + c->size))
-			{
-			  /* Done with this bank */
-			  break;
-			}
+		plan.min_address = c->base;
+		plan.max_address = c->base + (c->size - 1);
+		retval = image_plan_build(image, &plan);
+		if (retval != ERROR_OK)
+			break;
 
-			/* FIXME This needlessly touches sectors BETWEEN the
-			 * sections it's writing.  Without auto erase, it just
-			 * writes ones.  That WILL INVALIDATE data in cases
-			 * like Stellaris Tempest chips, corrupting internal
-			 * ECC codes; and at least FreeScale suggests issues
-			 * with that approach (in HC11 documentation).
-			 *
-			 * With auto erase enabled, data in those sectors will
-			 * be needlessly destroyed; and some of the limited
-			 * number of flash erase cycles will be wasted...
-			 *
-			 * In both cases, the extra writes slow things down.
-			 */
+		retval = flash_write_plan(target, c, image, &plan,
+				written, erase, unlock);
+		image_plan_free(&plan);
+		if (retval != ERROR_OK)
+			break;
+	}
 
-			/* if we have multiple sections within our image,
-			 * flash programming could fail due to alignment issues
-			 * attempt to rebuild a consecutive buffer for the flash loader */
-			pad_bytes = (sections[section_last + 1]->base_address) - (run_address + run_size);
-			padding[section_last] = pad_bytes;
-			run_size += sections[++section_last]->size;
-			run_size += pad_bytes;
+	return retval;
+}
 
-			if (pad_bytes > 0)
-				LOG_INFO("Padding image section %d with %d bytes", section_last-1, pad_bytes);
-		}
+int flash_write(struct target *target, struct image *image,
+		uint32_t *written, int erase)
+{
+	return flash_write_unlock(target, image, written, erase, false);
+}
 
-		if (run_address + run_size - 1 > c->base + c->size - 1)
-		{
-			/* If we have more than one flash chip back to back, then we limit
-			 * the current write operation to the current chip.
-			 */
-			LOG_DEBUG("Truncate flash run size to the current flash chip.");
+/* Amount of data a write stream gathers before it programs the
+ * complete sectors it holds; larger runs mean fewer flash algorithm
+ * invocations. */
+#define FLASH_WRITE_STREAM_CHUNK	(32 * 1024)
 
-			run_size = c->base + c->size - run_address;
-			assert(run_size > 0);
-		}
+void flash_write_stream_init(struct flash_write_stream *stream,
+		struct target *target)
+{
+	memset(stream, 0, sizeof(*stream));
+	stream->target = target;
+}
 
-		/* If we're applying any sector automagic, then pad this
-		 * (maybe-combined) segment to the end of its last sector.
-		 */
-		if (unlock || erase) {
-			int sector;
-			uint32_t offset_start = run_address - c->base;
-			uint32_t offset_end = offset_start + run_size;
-			uint32_t end = offset_end, delta;
-
-			for (sector = 0; sector < c->num_sectors; sector++) {
-				end = c->sectors[sector].offset
-						+ c->sectors[sector].size;
-				if (offset_end <= end)
-					break;
-			}
+/* program the first @a count bytes of the pending run */
+static int flash_write_stream_program(struct flash_write_stream *stream,
+		uint32_t count)
+{
+	int retval;
 
-			delta = end - offset_end;
-			padding[section_last] += delta;
-			run_size += delta;
-		}
+	retval = command_check_interrupt();
+	if (retval != ERROR_OK)
+		return retval;
 
-		/* allocate buffer */
-		buffer = malloc(run_size);
-		if (buffer == NULL)
-		{
-			LOG_ERROR("Out of memory for flash bank buffer");
-			retval = ERROR_FAIL;
-			goto done;
-		}
-		buffer_size = 0;
+	retval = flash_driver_write(stream->bank, stream->buffer,
+			stream->address - stream->bank->base, count);
+	if (retval != ERROR_OK)
+		return retval;
 
-		/* read sections to the buffer */
-		while (buffer_size < run_size)
-		{
-			size_t size_read;
+	stream->written += count;
+	stream->address += count;
+	stream->size -= count;
+	memmove(stream->buffer, stream->buffer + count, stream->size);
+	if (stream->size == 0)
+		stream->bank = NULL;
 
-			size_read = run_size - buffer_size;
-			if (size_read > sections[section]->size - section_offset)
-			    size_read = sections[section]->size - section_offset;
+	return ERROR_OK;
+}
 
-			/* KLUDGE!
-			 *
-			 * #¤%#"%¤% we have to figure out the section # from the sorted
-			 * list of pointers to sections to invoke image_read_section()...
-			 */
-			intptr_t diff = (intptr_t)sections[section] - (intptr_t)image->sections;
-			int t_section_num = diff / sizeof(struct imagesection);
-
-			LOG_DEBUG("image_read_section: section = %d, t_section_num = %d, section_offset = %d, buffer_size = %d, size_read = %d",
-				 (int)section,
-(int)t_section_num, (int)section_offset, (int)buffer_size, (int)size_read);
-			if ((retval = image_read_section(image, t_section_num, section_offset,
-					size_read, buffer + buffer_size, &size_read)) != ERROR_OK || size_read == 0)
-			{
-				free(buffer);
-				goto done;
-			}
+/* program all complete sectors of the pending run */
+static int flash_write_stream_program_sectors(struct flash_write_stream *stream)
+{
+	struct flash_bank *bank = stream->bank;
+	uint32_t start = stream->address - bank->base;
+	uint32_t end = start + stream->size;
+	uint32_t boundary = start;
+	int sector;
 
-			/* see if we need to pad the section */
-			while (padding[section]--)
-				 (buffer + buffer_size)[size_read++] = 0xff;
+	for (sector = 0; sector < bank->num_sectors; sector++)
+	{
+		uint32_t sector_end = bank->sectors[sector].offset
+				+ bank->sectors[sector].size;
+		if (sector_end > end)
+			break;
+		if (sector_end > start)
+			boundary = sector_end;
+	}
 
-			buffer_size += size_read;
-			section_offset += size_read;
+	if (boundary == start)
+		return ERROR_OK;
 
-			if (section_offset >= sections[section]->size)
-			{
-				section++;
-				section_offset = 0;
-			}
-		}
+	return flash_write_stream_program(stream, boundary - start);
+}
 
-		retval = ERROR_OK;
+static int flash_write_stream_append(struct flash_write_stream *stream,
+		const uint8_t *data, uint32_t count, uint8_t fill)
+{
+	if (stream->size + count > stream->buffer_size)
+	{
+		uint32_t buffer_size = stream->buffer_size;
+		uint8_t *buffer;
 
-		if (unlock)
+		if (buffer_size == 0)
+			buffer_size = FLASH_WRITE_STREAM_CHUNK;
+		while (buffer_size < stream->size + count)
+			buffer_size *= 2;
+		buffer = realloc(stream->buffer, buffer_size);
+		if (buffer == NULL)
 		{
-			retval = flash_unlock_address_range(target, run_address, run_size);
+			LOG_ERROR("Out of memory for flash write buffer");
+			return ERROR_FAIL;
 		}
-		if (retval == ERROR_OK)
+		stream->buffer = buffer;
+		stream->buffer_size = buffer_size;
+	}
+
+	if (data)
+		memcpy(stream->buffer + stream->size, data, count);
+	else
+		memset(stream->buffer + stream->size, fill, count);
+	stream->size += count;
+
+	return ERROR_OK;
+}
+
+int flash_write_stream_write(struct flash_write_stream *stream,
+		uint32_t address, const uint8_t *data, uint32_t count)
+{
+	int retval;
+
+	while (count > 0)
+	{
+		struct flash_bank *c = stream->bank;
+		uint32_t run_end = stream->address + stream->size;
+
+		if (c != NULL && address != run_end)
 		{
-			if (erase)
+			/* pad small holes within a sector like flash_write() does,
+			 * anything else starts a new run */
+			if ((address > run_end) && (address - c->base <=
+					flash_sector_end(c, run_end - c->base)))
 			{
-				/* calculate and erase sectors */
-				retval = flash_erase_address_range(target,
-						true, run_address, run_size);
+				retval = flash_write_stream_append(stream, NULL,
+						address - run_end, 0xff);
 			}
+			else
+				retval = flash_write_stream_flush(stream);
+			if (retval != ERROR_OK)
+				return retval;
 		}
 
-		if (retval == ERROR_OK)
+		if (stream->bank == NULL)
 		{
-			/* write flash sectors */
-			retval = flash_driver_write(c, buffer, run_address - c->base, run_size);
+			retval = get_flash_bank_by_addr(stream->target, address, false, &c);
+			if (retval != ERROR_OK)
+				return retval;
+			if (c == NULL)
+			{
+				/* GDB only sends flash regions from the memory map, so
+				 * this is a mismatch it should be told about */
+				LOG_ERROR("no flash bank at address 0x%8.8" PRIx32, address);
+				return ERROR_FLASH_DST_OUT_OF_BANK;
+			}
+			stream->bank = c;
+			stream->address = address;
 		}
 
-		free(buffer);
+		/* never let a run cross the end of its bank */
+		uint32_t chunk = c->base + c->size - address;
+		if (chunk > count)
+			chunk = count;
 
+		retval = flash_write_stream_append(stream, data, chunk, 0);
 		if (retval != ERROR_OK)
-		{
-			/* abort operation */
-			goto done;
-		}
+			return retval;
 
-		if (written != NULL)
-			*written += run_size; /* add run size to total written counter */
+		address += chunk;
+		data += chunk;
+		count -= chunk;
+
+		if (address - c->base >= c->size)
+			retval = flash_write_stream_flush(stream);
+		else if (stream->size >= FLASH_WRITE_STREAM_CHUNK)
+			retval = flash_write_stream_program_sectors(stream);
+		if (retval != ERROR_OK)
+			return retval;
 	}
 
+	return ERROR_OK;
+}
 
-done:
-	free(sections);
-	free(padding);
+int flash_write_stream_flush(struct flash_write_stream *stream)
+{
+	if (stream->bank == NULL)
+		return ERROR_OK;
 
-	return retval;
+	return flash_write_stream_program(stream, stream->size);
 }
 
-int flash_write(struct target *target, struct image *image,
-		uint32_t *written, int erase)
+void flash_write_stream_cleanup(struct flash_write_stream *stream)
 {
-	return flash_write_unlock(target, image, written, erase, false);
+	if (stream->bank != NULL)
+		LOG_WARNING("discarding %" PRIu32 " bytes of unwritten flash data",
+				stream->size);
+
+	free(stream->buffer);
+	stream->buffer = NULL;
+	stream->buffer_size = 0;
+	stream->size = 0;
+	stream->bank = NULL;
 }
@@ -129,6 +129,43 @@ int flash_unlock_address_range(struct target *target, uint32_t addr,
 int flash_write(struct target *target,
 		struct image *image, uint32_t *written, int erase);
 
+/**
+ * Programs flash incrementally from a sequence of writes, as sent by
+ * GDB's vFlashWrite packets.  Data for consecutive addresses is merged
+ * into one run, and completed sectors are programmed as soon as enough
+ * of them have accumulated; only a bounded tail stays buffered until
+ * flash_write_stream_flush() is called.
+ */
+struct flash_write_stream
+{
+	struct target *target;
+	/// Bank of the pending run, NULL if nothing is pending.
+	struct flash_bank *bank;
+	/// Start address of the pending run.
+	uint32_t address;
+	/// Pending, not yet programmed data.
+	uint8_t *buffer;
+	uint32_t size;
+	uint32_t buffer_size;
+	/// Number of bytes programmed so far.
+	uint32_t written;
+};
+
+void flash_write_stream_init(struct flash_write_stream *stream,
+		struct target *target);
+/**
+ * Queues @a count bytes of @a data for the flash at @a address,
+ * programming any sectors which are complete.
+ * @returns ERROR_OK if successful; ERROR_FLASH_DST_OUT_OF_BANK if any
+ * of the data lies outside of all flash banks; otherwise, an error code.
+ */
+int flash_write_stream_write(struct flash_write_stream *stream,
+		uint32_t address, const uint8_t *data, uint32_t count);
+/// Programs all data still pending in @a stream.
+int flash_write_stream_flush(struct flash_write_stream *stream);
+/// Releases @a stream, discarding any pending data.
+void flash_write_stream_cleanup(struct flash_write_stream *stream);
+
 /**
  * Forces targets to re-examine their erase/protection state.
  * This routine must be called when the system may modify the status.
@@ -47,4 +47,13 @@ int flash_driver_read(struct flash_bank *bank,
 int flash_write_unlock(struct target *target, struct image *image,
 		uint32_t *written, int erase, bool unlock);
 
+/**
+ * Set how flash_write_unlock() treats gaps between image sections in
+ * the same bank: sections at most @a limit bytes apart are written as
+ * one run, with the gap filled with @a pad, or with the current flash
+ * contents if @a pad is negative.
+ */
+void flash_set_gap_fill(uint32_t limit, int pad);
+void flash_get_gap_fill(uint32_t *limit, int *pad);
+
 #endif // FLASH_NOR_IMP_H
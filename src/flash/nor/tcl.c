@@ -375,6 +375,7 @@ COMMAND_HANDLER(handle_flash_write_image_command)
 	/* flash auto-erase is disabled by default*/
 	int auto_erase = 0;
 	bool auto_unlock = false;
+	bool verify = false;
 
 	for (;;)
 	{
@@ -390,6 +391,11 @@ COMMAND_HANDLER(handle_flash_write_image_command)
 			CMD_ARGV++;
 			CMD_ARGC--;
 			command_print(CMD_CTX, "auto unlock enabled");
+		} else if (strcmp(CMD_ARGV[0], "verify") == 0)
+		{
+			verify = true;
+			CMD_ARGV++;
+			CMD_ARGC--;
 		} else
 		{
 			break;
@@ -443,6 +449,20 @@ COMMAND_HANDLER(handle_flash_write_image_command)
 				duration_elapsed(&bench), duration_kbps(&bench, written));
 	}
 
+	if (verify)
+	{
+		uint32_t verified;
+
+		duration_start(&bench);
+		retval = target_verify_image(CMD_CTX, target, &image, &verified);
+		if ((ERROR_OK == retval) && (duration_measure(&bench) == ERROR_OK))
+		{
+			command_print(CMD_CTX, "verified %" PRIu32 " bytes "
+					"in %fs (%0.3f KiB/s)", verified,
+					duration_elapsed(&bench), duration_kbps(&bench, verified));
+		}
+	}
+
 	image_close(&image);
 
 	return retval;
@@ -741,9 +761,11 @@ static const struct command_registration flash_exec_command_handlers[] = {
 		.name = "write_image",
 		.handler = handle_flash_write_image_command,
 		.mode = COMMAND_EXEC,
-		.usage = "[erase] [unlock] filename [offset [file_type]]",
+		.usage = "[erase] [unlock] [verify] filename "
+			"[offset [file_type]]",
 		.help = "Write an image to flash.  Optionally first unprotect "
-			"and/or erase the region to be used.  Allow optional "
+			"and/or erase the region to be used, and verify the "
+			"result afterwards.  Allow optional "
 			"offset from beginning of bank (defaults to zero)",
 	},
 	{
@@ -913,6 +935,42 @@ COMMAND_HANDLER(handle_flash_init_command)
 	return flash_init_drivers(CMD_CTX);
 }
 
+COMMAND_HANDLER(handle_flash_gap_fill_command)
+{
+	uint32_t limit;
+	int pad;
+
+	if (CMD_ARGC > 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	flash_get_gap_fill(&limit, &pad);
+
+	if (CMD_ARGC >= 1)
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[0], limit);
+	if (CMD_ARGC == 2)
+	{
+		if (strcmp(CMD_ARGV[1], "keep") == 0)
+			pad = -1;
+		else
+		{
+			uint8_t value;
+			COMMAND_PARSE_NUMBER(u8, CMD_ARGV[1], value);
+			pad = value;
+		}
+	}
+
+	flash_set_gap_fill(limit, pad);
+
+	if (pad < 0)
+		command_print(CMD_CTX, "gaps of up to %" PRIu32 " bytes keep "
+				"the flash contents", limit);
+	else
+		command_print(CMD_CTX, "gaps of up to %" PRIu32 " bytes are "
+				"filled with 0x%02x", limit, pad);
+
+	return ERROR_OK;
+}
+
 static const struct command_registration flash_config_command_handlers[] = {
 	{
 		.name = "bank",
@@ -942,6 +1000,17 @@ static const struct command_registration flash_config_command_handlers[] = {
 		.jim_handler = jim_flash_list,
 		.help = "Returns a list of details about the flash banks.",
 	},
+	{
+		.name = "gap_fill",
+		.mode = COMMAND_ANY,
+		.handler = handle_flash_gap_fill_command,
+		.usage = "[max_gap [pad_value|'keep']]",
+		.help = "Set how write_image treats gaps between image "
+			"sections in one bank: sections at most max_gap bytes "
+			"apart are written together, with the gap filled "
+			"with pad_value (default 0xff) or with the current "
+			"flash contents.",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 static const struct command_registration flash_command_handlers[] = {
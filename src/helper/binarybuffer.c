@@ -190,6 +190,29 @@ uint32_t flip_u32(uint32_t value, unsigned int num)
 	return c;
 }
 
+void buf_flip_bytes(uint8_t *buf, unsigned size)
+{
+	for (unsigned i = 0; i < size; i++)
+		buf[i] = bit_reverse_table256[buf[i]];
+}
+
+uint8_t buf_hexify(char *hex, const uint8_t *bin, unsigned count)
+{
+	static const char digits[16] = "0123456789abcdef";
+	uint8_t sum = 0;
+
+	for (unsigned i = 0; i < count; i++)
+	{
+		char hi = digits[bin[i] >> 4];
+		char lo = digits[bin[i] & 0xf];
+		*hex++ = hi;
+		*hex++ = lo;
+		sum += hi + lo;
+	}
+
+	return sum;
+}
+
 static int ceil_f_to_u32(float x)
 {
 	if (x < 0)	/* return zero for negative numbers */
@@ -98,6 +98,13 @@ static inline uint32_t buf_get_u32(const void *_buffer,
  */
 uint32_t flip_u32(uint32_t value, unsigned width);
 
+/**
+ * Inverts the ordering of bits inside each byte of a buffer, in place.
+ * @param buf The buffer to flip.
+ * @param size The number of bytes in @c buf.
+ */
+void buf_flip_bytes(uint8_t *buf, unsigned size);
+
 bool buf_cmp(const void *buf1, const void *buf2, unsigned size);
 bool buf_cmp_mask(const void *buf1, const void *buf2,
 		const void *mask, unsigned size);
@@ -126,6 +133,17 @@ int str_to_buf(const char *str, unsigned len,
 		void *bin_buf, unsigned buf_size, unsigned radix);
 char* buf_to_str(const void *buf, unsigned size, unsigned radix);
 
+/**
+ * Hex encodes @c count bytes as two lower case digits each, without a
+ * terminating NUL.
+ * @param hex The buffer to receive 2 * @c count characters.
+ * @param bin The bytes to encode.
+ * @param count The number of bytes in @c bin.
+ * @returns The modulo-256 sum of the characters written, as used by
+ * GDB packet checksums.
+ */
+uint8_t buf_hexify(char *hex, const uint8_t *bin, unsigned count);
+
 /* read a uint32_t from a buffer in target memory endianness */
 static inline uint32_t fast_target_buffer_get_u32(const void *p, bool le)
 {
@@ -41,6 +41,7 @@
 #include "command.h"
 #include "configuration.h"
 #include "log.h"
+#include "startup_profile.h"
 #include "time_support.h"
 #include "jim-eventloop.h"
 
@@ -199,6 +200,18 @@ struct command_context *current_command_context(Jim_Interp *interp)
 	return cmd_ctx;
 }
 
+static void command_profile_end(struct startup_profile_span *span,
+		struct command *c)
+{
+	if (!startup_profile_enabled())
+		return;
+	char *full_name = command_name(c, ' ');
+	if (NULL == full_name)
+		return;
+	startup_profile_end(span, "command", full_name);
+	free(full_name);
+}
+
 static int script_command_run(Jim_Interp *interp,
 		int argc, Jim_Obj *const *argv, struct command *c, bool capture)
 {
@@ -215,7 +228,10 @@ static int script_command_run(Jim_Interp *interp,
 		state = command_log_capture_start(interp);
 
 	struct command_context *cmd_ctx = current_command_context(interp);
+	struct startup_profile_span span;
+	startup_profile_begin(&span);
 	int retval = run_command(cmd_ctx, c, (const char **)words, nwords);
+	command_profile_end(&span, c);
 
 	command_log_capture_finish(state);
 
@@ -240,16 +256,92 @@ static struct command *command_root(struct command *c)
 	return c;
 }
 
+/* Besides the sorted sibling lists, which are kept for help output,
+ * every command is indexed by (parent, name) in this hash table, so
+ * that dispatch need not strcmp() its way through each level.
+ * Top-level names live in the Jim interpreter's global namespace,
+ * so they are unique even across command contexts. */
+static struct command **command_hash = NULL;
+static unsigned command_hash_size = 0;
+static unsigned command_hash_count = 0;
+
+static unsigned command_hash_key(struct command *parent, const char *name)
+{
+	/* FNV-1a over the name, seeded with the parent */
+	uint32_t h = 2166136261u ^ (uint32_t)((uintptr_t)parent >> 4);
+	while (*name)
+	{
+		h ^= (uint8_t)*name++;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+static void command_hash_insert(struct command *c)
+{
+	if (command_hash_count >= command_hash_size)
+	{
+		unsigned size = command_hash_size ? command_hash_size * 2 : 256;
+		struct command **table = calloc(size, sizeof(*table));
+		if (NULL != table)
+		{
+			for (unsigned i = 0; i < command_hash_size; i++)
+			{
+				while (command_hash[i])
+				{
+					struct command *cc = command_hash[i];
+					command_hash[i] = cc->hash_next;
+					unsigned slot = command_hash_key(cc->parent, cc->name) & (size - 1);
+					cc->hash_next = table[slot];
+					table[slot] = cc;
+				}
+			}
+			free(command_hash);
+			command_hash = table;
+			command_hash_size = size;
+		}
+		else if (NULL == command_hash)
+			return;
+		/* else keep using the old table, just with longer chains */
+	}
+
+	unsigned slot = command_hash_key(c->parent, c->name) & (command_hash_size - 1);
+	c->hash_next = command_hash[slot];
+	command_hash[slot] = c;
+	command_hash_count++;
+}
+
+static void command_hash_remove(struct command *c)
+{
+	if ((NULL == command_hash) || (NULL == c->name))
+		return;
+
+	unsigned slot = command_hash_key(c->parent, c->name) & (command_hash_size - 1);
+	for (struct command **p = &command_hash[slot]; *p; p = &(*p)->hash_next)
+	{
+		if (*p != c)
+			continue;
+		*p = c->hash_next;
+		command_hash_count--;
+		return;
+	}
+}
+
 /**
- * Find a command by name from a list of commands.
- * @returns Returns the named command if it exists in the list.
+ * Find a command by name among the children of a command.
+ * @param parent The parent command, or NULL for top-level commands.
+ * @returns Returns the named command if it exists.
  * Returns NULL otherwise.
  */
-static struct command *command_find(struct command *head, const char *name)
+static struct command *command_find(struct command *parent, const char *name)
 {
-	for (struct command *cc = head; cc; cc = cc->next)
+	if (NULL == command_hash)
+		return NULL;
+
+	unsigned slot = command_hash_key(parent, name) & (command_hash_size - 1);
+	for (struct command *cc = command_hash[slot]; cc; cc = cc->hash_next)
 	{
-		if (strcmp(cc->name, name) == 0)
+		if ((cc->parent == parent) && (strcmp(cc->name, name) == 0))
 			return cc;
 	}
 	return NULL;
@@ -257,12 +349,12 @@ static struct command *command_find(struct command *head, const char *name)
 struct command *command_find_in_context(struct command_context *cmd_ctx,
 		const char *name)
 {
-	return command_find(cmd_ctx->commands, name);
+	return command_find(NULL, name);
 }
 struct command *command_find_in_parent(struct command *parent,
 		const char *name)
 {
-	return command_find(parent->children, name);
+	return command_find(parent, name);
 }
 
 /**
@@ -309,6 +401,8 @@ static void command_free(struct command *c)
 		command_free(tmp);
 	}
 
+	command_hash_remove(c);
+
 	if (c->name)
 		free((void *)c->name);
 	if (c->help)
@@ -343,6 +437,7 @@ static struct command *command_new(struct command_context *cmd_ctx,
 	c->mode = cr->mode;
 
 	command_add_child(command_list_for_parent(cmd_ctx, parent), c);
+	command_hash_insert(c);
 
 	return c;
 
@@ -389,8 +484,7 @@ struct command* register_command(struct command_context *context,
 		return NULL;
 
 	const char *name = cr->name;
-	struct command **head = command_list_for_parent(context, parent);
-	struct command *c = command_find(*head, name);
+	struct command *c = command_find(parent, name);
 	if (NULL != c)
 	{
 		/* TODO: originally we treated attempting to register a cmd twice as an error
@@ -812,20 +906,20 @@ static int jim_capture(Jim_Interp *interp, int argc, Jim_Obj *const *argv)
 	return retcode;
 }
 
-static COMMAND_HELPER(command_help_find, struct command *head,
+static COMMAND_HELPER(command_help_find, struct command *parent,
 		struct command **out)
 {
 	if (0 == CMD_ARGC)
 		return ERROR_INVALID_ARGUMENTS;
-	*out = command_find(head, CMD_ARGV[0]);
+	*out = command_find(parent, CMD_ARGV[0]);
 	if (NULL == *out && strncmp(CMD_ARGV[0], "ocd_", 4) == 0)
-		*out = command_find(head, CMD_ARGV[0] + 4);
+		*out = command_find(parent, CMD_ARGV[0] + 4);
 	if (NULL == *out)
 		return ERROR_INVALID_ARGUMENTS;
 	if (--CMD_ARGC == 0)
 		return ERROR_OK;
 	CMD_ARGV++;
-	return CALL_COMMAND_HANDLER(command_help_find, (*out)->children, out);
+	return CALL_COMMAND_HANDLER(command_help_find, *out, out);
 }
 
 static COMMAND_HELPER(command_help_show, struct command *c, unsigned n,
@@ -978,18 +1072,18 @@ COMMAND_HANDLER(handle_help_command)
 }
 
 static int command_unknown_find(unsigned argc, Jim_Obj *const *argv,
-		struct command *head, struct command **out, bool top_level)
+		struct command *parent, struct command **out, bool top_level)
 {
 	if (0 == argc)
 		return argc;
 	const char *cmd_name = Jim_GetString(argv[0], NULL);
-	struct command *c = command_find(head, cmd_name);
+	struct command *c = command_find(parent, cmd_name);
 	if (NULL == c && top_level && strncmp(cmd_name, "ocd_", 4) == 0)
-		c = command_find(head, cmd_name + 4);
+		c = command_find(parent, cmd_name + 4);
 	if (NULL == c)
 		return argc;
 	*out = c;
-	return command_unknown_find(--argc, ++argv, (*out)->children, out, false);
+	return command_unknown_find(--argc, ++argv, *out, out, false);
 }
 
 
@@ -1005,9 +1099,8 @@ static int command_unknown(Jim_Interp *interp, int argc, Jim_Obj *const *argv)
 	}
 	script_debug(interp, cmd_name, argc, argv);
 
-	struct command_context *cmd_ctx = current_command_context(interp);
-	struct command *c = cmd_ctx->commands;
-	int remaining = command_unknown_find(argc, argv, c, &c, true);
+	struct command *c = NULL;
+	int remaining = command_unknown_find(argc, argv, NULL, &c, true);
 	// if nothing could be consumed, then it's really an unknown command
 	if (remaining == argc)
 	{
@@ -1027,7 +1120,7 @@ static int command_unknown(Jim_Interp *interp, int argc, Jim_Obj *const *argv)
 	}
 	else
 	{
-		c = command_find(cmd_ctx->commands, "usage");
+		c = command_find(NULL, "usage");
 		if (NULL == c)
 		{
 			LOG_ERROR("unknown command, but usage is missing too");
@@ -1041,7 +1134,11 @@ static int command_unknown(Jim_Interp *interp, int argc, Jim_Obj *const *argv)
 	if (c->jim_handler)
 	{
 		interp->cmdPrivData = c->jim_handler_data;
-		return (*c->jim_handler)(interp, count, start);
+		struct startup_profile_span span;
+		startup_profile_begin(&span);
+		int retval = (*c->jim_handler)(interp, count, start);
+		command_profile_end(&span, c);
+		return retval;
 	}
 
 	return script_command_run(interp, count, start, c, found);
@@ -1054,8 +1151,8 @@ static int jim_command_mode(Jim_Interp *interp, int argc, Jim_Obj *const *argv)
 
 	if (argc > 1)
 	{
-		struct command *c = cmd_ctx->commands;
-		int remaining = command_unknown_find(argc - 1, argv + 1, c, &c, true);
+		struct command *c = NULL;
+		int remaining = command_unknown_find(argc - 1, argv + 1, NULL, &c, true);
 		// if nothing could be consumed, then it's an unknown command
 		if (remaining == argc - 1)
 		{
@@ -1083,9 +1180,8 @@ static int jim_command_type(Jim_Interp *interp, int argc, Jim_Obj *const *argv)
 	if (1 == argc)
 		return JIM_ERR;
 
-	struct command_context *cmd_ctx = current_command_context(interp);
-	struct command *c = cmd_ctx->commands;
-	int remaining = command_unknown_find(argc - 1, argv + 1, c, &c, true);
+	struct command *c = NULL;
+	int remaining = command_unknown_find(argc - 1, argv + 1, NULL, &c, true);
 	// if nothing could be consumed, then it's an unknown command
 	if (remaining == argc - 1)
 	{
@@ -1106,8 +1202,7 @@ static int jim_command_type(Jim_Interp *interp, int argc, Jim_Obj *const *argv)
 int help_add_command(struct command_context *cmd_ctx, struct command *parent,
 		const char *cmd_name, const char *help_text, const char *usage)
 {
-	struct command **head = command_list_for_parent(cmd_ctx, parent);
-	struct command *nc = command_find(*head, cmd_name);
+	struct command *nc = command_find(parent, cmd_name);
 	if (NULL == nc)
 	{
 		// add a new command with help text
@@ -1180,8 +1275,7 @@ COMMAND_HANDLER(handle_help_add_command)
 	struct command *c = NULL;
 	if (CMD_ARGC > 0)
 	{
-		c = CMD_CTX->commands;
-		int retval = CALL_COMMAND_HANDLER(command_help_find, c, &c);
+		int retval = CALL_COMMAND_HANDLER(command_help_find, NULL, &c);
 		if (ERROR_OK != retval)
 			return retval;
 	}
@@ -1387,6 +1481,29 @@ int command_context_mode(struct command_context *cmd_ctx, enum command_mode mode
 	return ERROR_OK;
 }
 
+/* set by command_interrupt(), see command_check_interrupt() */
+static bool interrupt_requested = false;
+
+void command_interrupt(void)
+{
+	interrupt_requested = true;
+}
+
+void command_interrupt_clear(void)
+{
+	interrupt_requested = false;
+}
+
+int command_check_interrupt(void)
+{
+	if (!interrupt_requested)
+		return ERROR_OK;
+
+	interrupt_requested = false;
+	LOG_ERROR("interrupted");
+	return ERROR_COMMAND_INTERRUPTED;
+}
+
 void process_jim_events(struct command_context *cmd_ctx)
 {
 #if !BUILD_ECOSBOARD
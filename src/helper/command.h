@@ -183,6 +183,8 @@ struct command
 	void *jim_handler_data;
 	enum command_mode mode;
 	struct command *next;
+	/** next command in the same bucket of the lookup hash */
+	struct command *hash_next;
 };
 
 /**
@@ -347,12 +349,28 @@ void command_output_text(struct command_context *context, const char *data);
 
 void process_jim_events(struct command_context *cmd_ctx);
 
+/**
+ * Ask the operation in progress to give up at its next check point,
+ * e.g. because the user typed Ctrl-C while a long flash write or
+ * memory dump was keeping the server loop from running.
+ */
+void command_interrupt(void);
+/** Drop an interrupt request which no operation acted upon. */
+void command_interrupt_clear(void);
+/**
+ * Long running operations call this between steps.
+ * @returns ERROR_COMMAND_INTERRUPTED once after command_interrupt()
+ * was called, ERROR_OK otherwise.
+ */
+int command_check_interrupt(void);
+
 #define		ERROR_COMMAND_CLOSE_CONNECTION		(-600)
 #define		ERROR_COMMAND_SYNTAX_ERROR			(-601)
 #define		ERROR_COMMAND_NOTFOUND				(-602)
 #define		ERROR_COMMAND_ARGUMENT_INVALID		(-603)
 #define		ERROR_COMMAND_ARGUMENT_OVERFLOW		(-604)
 #define		ERROR_COMMAND_ARGUMENT_UNDERFLOW	(-605)
+#define		ERROR_COMMAND_INTERRUPTED			(-606)
 
 int parse_ulong(const char *str, unsigned long *ul);
 int parse_ullong(const char *str, unsigned long long *ul);
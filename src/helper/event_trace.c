@@ -0,0 +1,220 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "event_trace.h"
+#include "log.h"
+#include "time_support.h"
+
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+/* 6 MiB of records; enough for some seconds of a busy DAP */
+#define EVENT_TRACE_DEFAULT_RECORDS	(256 * 1024)
+
+bool event_trace_enabled = false;
+
+static char *trace_file;
+static struct event_trace_header *trace_header;
+static struct event_trace_record *trace_records;
+static size_t trace_size;
+/* capacity - 1; the capacity is a power of two */
+static uint32_t trace_mask;
+static bool trace_mapped;
+
+void event_trace_add(enum event_trace_type type, int status,
+		uint32_t id, uint32_t addr, uint32_t value)
+{
+	struct timeval now;
+	gettimeofday(&now, NULL);
+
+	struct event_trace_record *r =
+			&trace_records[trace_header->head & trace_mask];
+	r->time_us = (uint64_t)now.tv_sec * 1000000 + now.tv_usec
+			- trace_header->start_us;
+	r->type = type;
+	r->status = status;
+	r->id = id;
+	r->addr = addr;
+	r->value = value;
+
+	trace_header->head++;
+}
+
+static void event_trace_stop(void)
+{
+	if (!trace_header)
+		return;
+
+	event_trace_enabled = false;
+
+	unsigned long long count = trace_header->head;
+#ifdef HAVE_SYS_MMAN_H
+	if (trace_mapped)
+		munmap(trace_header, trace_size);
+	else
+#endif
+	{
+		/* no mmap(); the trace only reaches the file now */
+		FILE *f = fopen(trace_file, "wb");
+		if (!f || fwrite(trace_header, trace_size, 1, f) != 1)
+			LOG_ERROR("can't write event trace '%s'", trace_file);
+		if (f)
+			fclose(f);
+		free(trace_header);
+	}
+
+	LOG_INFO("event trace '%s' stopped after %llu records",
+			trace_file, count);
+
+	trace_header = NULL;
+	trace_records = NULL;
+	free(trace_file);
+	trace_file = NULL;
+}
+
+static int event_trace_start(const char *file, uint32_t capacity)
+{
+	static bool registered;
+	void *p = NULL;
+
+	event_trace_stop();
+
+	trace_size = sizeof(*trace_header)
+			+ (size_t)capacity * sizeof(*trace_records);
+
+#ifdef HAVE_SYS_MMAN_H
+	int fd = open(file, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		LOG_ERROR("can't create event trace '%s'", file);
+		return ERROR_FAIL;
+	}
+	if (ftruncate(fd, trace_size) == 0)
+		p = mmap(NULL, trace_size, PROT_READ | PROT_WRITE,
+				MAP_SHARED, fd, 0);
+	close(fd);
+	if (!p || p == MAP_FAILED) {
+		LOG_ERROR("can't map event trace '%s'", file);
+		return ERROR_FAIL;
+	}
+	trace_mapped = true;
+#else
+	p = calloc(1, trace_size);
+	if (!p)
+		return ERROR_FAIL;
+	trace_mapped = false;
+#endif
+
+	trace_file = strdup(file);
+	trace_header = p;
+	trace_records = (struct event_trace_record *)(trace_header + 1);
+	trace_mask = capacity - 1;
+
+	memset(trace_header, 0, sizeof(*trace_header));
+	strcpy(trace_header->magic, EVENT_TRACE_MAGIC);
+	trace_header->version = EVENT_TRACE_VERSION;
+	trace_header->record_size = sizeof(*trace_records);
+	trace_header->capacity = capacity;
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	trace_header->start_us = (uint64_t)now.tv_sec * 1000000 + now.tv_usec;
+
+	/* a trace kept in memory must still be written out at exit */
+	if (!trace_mapped && !registered) {
+		atexit(event_trace_stop);
+		registered = true;
+	}
+
+	event_trace_enabled = true;
+	LOG_INFO("event trace '%s' started, %u records",
+			file, (unsigned) capacity);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_event_trace_start_command)
+{
+	uint32_t records = EVENT_TRACE_DEFAULT_RECORDS;
+
+	if (CMD_ARGC < 1 || CMD_ARGC > 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	if (CMD_ARGC == 2)
+	{
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[1], records);
+		if (records < 1 || records > (1u << 26))
+		{
+			command_print(CMD_CTX, "record count must be "
+					"between 1 and %u", 1u << 26);
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		}
+	}
+
+	/* round up to a power of two, so a slot is just a mask away */
+	uint32_t capacity = 1;
+	while (capacity < records)
+		capacity <<= 1;
+
+	return event_trace_start(CMD_ARGV[0], capacity);
+}
+
+COMMAND_HANDLER(handle_event_trace_stop_command)
+{
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	event_trace_stop();
+	return ERROR_OK;
+}
+
+static const struct command_registration event_trace_subcommand_handlers[] = {
+	{
+		.name = "start",
+		.handler = handle_event_trace_start_command,
+		.mode = COMMAND_ANY,
+		.help = "Start tracing DAP, DCC, JTAG flush and target "
+			"events into a ring of fixed size records in the "
+			"file; an active trace is stopped first.",
+		.usage = "filename [records]",
+	},
+	{
+		.name = "stop",
+		.handler = handle_event_trace_stop_command,
+		.mode = COMMAND_ANY,
+		.help = "Stop tracing, and close the trace file.",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct command_registration event_trace_command_handlers[] = {
+	{
+		.name = "event_trace",
+		.mode = COMMAND_ANY,
+		.help = "binary trace of low level debug transactions",
+		.chain = event_trace_subcommand_handlers,
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+int event_trace_register_commands(struct command_context *cmd_ctx)
+{
+	return register_commands(cmd_ctx, NULL, event_trace_command_handlers);
+}
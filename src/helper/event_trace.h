@@ -0,0 +1,98 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef EVENT_TRACE_H
+#define EVENT_TRACE_H
+
+#include <helper/command.h>
+
+/**
+ * @file
+ * Binary trace of low level debug transactions: DAP register accesses
+ * and WAIT responses, DCC handshakes, JTAG queue flushes and target
+ * events.  Each is a fixed size, timestamped record in a ring which,
+ * where the host supports it, is a memory mapped file; so the trace
+ * survives a crash, and can be read while OpenOCD runs.
+ * contrib/evtracedump.c turns it into text or CSV.
+ *
+ * The file layout is part of the interface to that tool; bump
+ * EVENT_TRACE_VERSION when changing it.
+ */
+
+#define EVENT_TRACE_MAGIC	"OCDEVTR"
+#define EVENT_TRACE_VERSION	1
+
+enum event_trace_type {
+	/** id = AP (for AP accesses), addr = register, value = data written */
+	EVENT_TRACE_DP_READ = 1,
+	EVENT_TRACE_DP_WRITE = 2,
+	EVENT_TRACE_AP_READ = 3,
+	EVENT_TRACE_AP_WRITE = 4,
+	/** status = ack; addr = retries so far */
+	EVENT_TRACE_DAP_WAIT = 5,
+	/** value = CTRL/STAT with sticky error flags */
+	EVENT_TRACE_DAP_STICKY = 6,
+	/** status = result; value = microseconds spent in the adapter */
+	EVENT_TRACE_JTAG_FLUSH = 7,
+	/** status = result; addr = handshake bit; value = polls */
+	EVENT_TRACE_DCC_HANDSHAKE = 8,
+	/** id = target number; value = enum target_event */
+	EVENT_TRACE_TARGET_EVENT = 9,
+};
+
+/** One trace record; 24 bytes, in host byte order. */
+struct event_trace_record {
+	/** microseconds since the trace was started */
+	uint64_t time_us;
+	uint16_t type;
+	int16_t status;
+	uint32_t id;
+	uint32_t addr;
+	uint32_t value;
+};
+
+/** Start of the trace file; the records follow it. */
+struct event_trace_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t record_size;
+	/** number of record slots in the ring */
+	uint32_t capacity;
+	uint32_t reserved;
+	/** records written so far; the next goes in slot head % capacity */
+	uint64_t head;
+	/** gettimeofday() at the start of the trace, in microseconds */
+	uint64_t start_us;
+};
+
+extern bool event_trace_enabled;
+
+void event_trace_add(enum event_trace_type type, int status,
+		uint32_t id, uint32_t addr, uint32_t value);
+
+/**
+ * Record an event if tracing is on.  When it is off, this costs one
+ * test of a flag, so calls can stay in fast paths.
+ */
+#define EVENT_TRACE(type, status, id, addr, value) \
+		do { \
+			if (event_trace_enabled) \
+				event_trace_add(type, status, id, addr, value); \
+		} while (0)
+
+int event_trace_register_commands(struct command_context *cmd_ctx);
+
+#endif /* EVENT_TRACE_H */
@@ -31,12 +31,18 @@
 #include "configuration.h"
 #include "fileio.h"
 
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
 struct fileio_internal {
 	const char *url;
 	ssize_t size;
 	enum fileio_type type;
 	enum fileio_access access;
 	FILE *file;
+	/* the whole file, once fileio_map() has been called */
+	void *map;
 };
 
 static inline int fileio_close_local(struct fileio_internal *fileio);
@@ -117,6 +123,7 @@ int fileio_open(struct fileio *fileio_p, const char *url, enum fileio_access acc
 	fileio->type = type;
 	fileio->access = access_type;
 	fileio->url = strdup(url);
+	fileio->map = NULL;
 
 	retval = fileio_open_local(fileio);
 
@@ -148,6 +155,11 @@ int fileio_close(struct fileio *fileio_p)
 	int retval;
 	struct fileio_internal *fileio = fileio_p->fp;
 
+#ifdef HAVE_SYS_MMAN_H
+	if (fileio->map)
+		munmap(fileio->map, fileio->size);
+#endif
+
 	retval = fileio_close_local(fileio);
 
 	free((void*)fileio->url);
@@ -245,6 +257,37 @@ int fileio_write_u32(struct fileio *fileio_p, uint32_t data)
 	return retval;
 }
 
+int fileio_map(struct fileio *fileio_p, const uint8_t **data)
+{
+	struct fileio_internal *fileio = fileio_p->fp;
+
+#ifdef HAVE_SYS_MMAN_H
+	if (!fileio->map)
+	{
+		if ((fileio->access != FILEIO_READ) || (fileio->size <= 0))
+			return ERROR_FILEIO_OPERATION_NOT_SUPPORTED;
+
+		void *map = mmap(NULL, fileio->size, PROT_READ, MAP_PRIVATE,
+				fileno(fileio->file), 0);
+		if (map == MAP_FAILED)
+		{
+			LOG_DEBUG("couldn't map %s: %s", fileio->url, strerror(errno));
+			return ERROR_FILEIO_OPERATION_NOT_SUPPORTED;
+		}
+#ifdef MADV_SEQUENTIAL
+		/* images are mostly read front to back, once */
+		madvise(map, fileio->size, MADV_SEQUENTIAL);
+#endif
+		fileio->map = map;
+	}
+
+	*data = fileio->map;
+	return ERROR_OK;
+#else
+	return ERROR_FILEIO_OPERATION_NOT_SUPPORTED;
+#endif
+}
+
 /**
  * FIX!!!!
  *
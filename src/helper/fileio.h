@@ -68,6 +68,16 @@ int fileio_read_u32(struct fileio *fileio, uint32_t *data);
 int fileio_write_u32(struct fileio *fileio, uint32_t data);
 int fileio_size(struct fileio *fileio, int *size);
 
+/**
+ * Map the whole of a file opened with FILEIO_READ into memory, so
+ * it can be used in place instead of copied with fileio_read().
+ * The mapping stays valid until fileio_close().
+ * @returns ERROR_OK, or ERROR_FILEIO_OPERATION_NOT_SUPPORTED if the
+ * file can't be mapped (no mmap() on this host, empty file, ...);
+ * fileio_read() still works then.
+ */
+int fileio_map(struct fileio *fileio, const uint8_t **data);
+
 #define ERROR_FILEIO_LOCATION_UNKNOWN	(-1200)
 #define ERROR_FILEIO_NOT_FOUND			(-1201)
 #define ERROR_FILEIO_OPERATION_FAILED		(-1202)
@@ -32,6 +32,7 @@
 #include <server/server.h>
 
 #include <stdarg.h>
+#include <signal.h>
 
 #ifdef _DEBUG_FREE_SPACE_
 #ifdef HAVE_MALLOC_H
@@ -44,6 +45,8 @@
 int debug_level = -1;
 
 static FILE* log_output;
+/* file descriptor of log_output, for the fatal signal handler */
+static int log_output_fd = -1;
 static struct log_callback *log_callbacks = NULL;
 
 static long long last_time;
@@ -63,6 +66,61 @@ static char *log_strings[5] =
 
 static int count = 0;
 
+/* Debug messages are formatted straight into this buffer and written
+ * to log_output in large chunks, rather than with an fflush()ed
+ * fprintf() and a malloc() each.  The buffer is flushed before any
+ * other output (errors included), when it fills up, from the server
+ * loop, at exit and on fatal signals, so the log never lags far behind
+ * and the last debug messages survive a crash.
+ */
+#define LOG_BUFFER_SIZE		(64 * 1024)
+
+static char log_buffer[LOG_BUFFER_SIZE];
+static size_t log_buffer_used = 0;
+
+void log_flush(void)
+{
+	if (log_buffer_used == 0)
+		return;
+
+	fwrite(log_buffer, 1, log_buffer_used, log_output);
+	fflush(log_output);
+	log_buffer_used = 0;
+}
+
+/* A crash, abort() or kill would lose the buffer, which holds the
+ * debug messages most likely to explain it.  Write it out with write(),
+ * which unlike stdio is safe here, then let the signal take its course.
+ * Only SIGKILL can't be caught.
+ */
+static void log_fatal_signal(int sig)
+{
+	if (log_buffer_used > 0 && log_output_fd >= 0)
+	{
+		if (write(log_output_fd, log_buffer, log_buffer_used) > 0)
+			log_buffer_used = 0;
+	}
+
+	signal(sig, SIG_DFL);
+	raise(sig);
+}
+
+static void log_catch_fatal_signals(void)
+{
+	static const int fatal_signals[] = {
+		SIGSEGV, SIGILL, SIGFPE, SIGABRT, SIGINT, SIGTERM,
+#ifdef SIGBUS
+		SIGBUS,
+#endif
+#ifdef SIGHUP
+		SIGHUP,
+#endif
+	};
+
+	for (unsigned i = 0; i < ARRAY_SIZE(fatal_signals); i++)
+		signal(fatal_signals[i], log_fatal_signal);
+}
+
 
 static struct store_log_forward * log_head = NULL;
 static int log_forward_count = 0;
@@ -127,6 +185,7 @@ static void log_forward(const char *file, unsigned line, const char *function, c
 static void log_puts(enum log_levels level, const char *file, int line, const char *function, const char *string)
 {
 	char *f;
+
 	if (level == LOG_LVL_OUTPUT)
 	{
 		/* do not prepend any headers, just print out what we were given and return */
@@ -180,6 +239,56 @@ static void log_puts(enum log_levels level, const char *file, int line, const ch
 	}
 }
 
+/* Debug messages are never forwarded to the log callbacks, so they
+ * can go to the buffer.  Returns false if the message is too long
+ * for it, and must be printed by log_puts() instead.
+ */
+static bool log_buffer_debug(const char *file, unsigned line,
+		const char *function, bool newline, const char *format, va_list ap)
+{
+#ifdef _DEBUG_FREE_SPACE_
+	/* mallinfo() output is only produced by log_puts() */
+	return false;
+#else
+	const char *f = strrchr(file, '/');
+	if (f != NULL)
+		file = f + 1;
+
+	int t = (int)(timeval_ms()-start);
+
+	for (int tries = 0; tries < 2; tries++)
+	{
+		char *p = log_buffer + log_buffer_used;
+		size_t room = LOG_BUFFER_SIZE - log_buffer_used;
+
+		int head = snprintf(p, room, "%s%d %d %s:%d %s(): ",
+				log_strings[LOG_LVL_DEBUG + 1], count, t,
+				file, line, function);
+		if (head >= 0 && (size_t)head < room)
+		{
+			va_list ap_copy;
+			va_copy(ap_copy, ap);
+			int len = vsnprintf(p + head, room - head, format, ap_copy);
+			va_end(ap_copy);
+
+			/* the newline takes the place of vsnprintf()'s NUL */
+			if (len >= 0 && (size_t)(head + len) < room)
+			{
+				/* as in log_puts(), empty strings are not logged */
+				if (len == 0 && !newline)
+					return true;
+				if (newline)
+					p[head + len++] = '\n';
+				log_buffer_used += head + len;
+				return true;
+			}
+		}
+
+		log_flush();
+	}
+	return false;
+#endif
+}
 
 void log_printf(enum log_levels level, const char *file, unsigned line, const char *function, const char *format, ...)
 {
@@ -192,6 +301,17 @@ void log_printf(enum log_levels level, const char *file, unsigned line, const ch
 
 	va_start(ap, format);
 
+	if (level == LOG_LVL_DEBUG
+			&& log_buffer_debug(file, line, function, false, format, ap))
+	{
+		va_end(ap);
+		return;
+	}
+
+	/* errors and everything else go out after the buffered messages,
+	 * even if they can't be formatted */
+	log_flush();
+
 	string = alloc_vprintf(format, ap);
 	if (string != NULL)
 	{
@@ -213,6 +333,15 @@ void log_printf_lf(enum log_levels level, const char *file, unsigned line, const
 
 	va_start(ap, format);
 
+	if (level == LOG_LVL_DEBUG
+			&& log_buffer_debug(file, line, function, true, format, ap))
+	{
+		va_end(ap);
+		return;
+	}
+
+	log_flush();
+
 	string = alloc_vprintf(format, ap);
 	if (string != NULL)
 	{
@@ -253,7 +382,9 @@ COMMAND_HANDLER(handle_log_output_command)
 
 		if (file)
 		{
+			log_flush();
 			log_output = file;
+			log_output_fd = fileno(file);
 		}
 	}
 
@@ -307,13 +438,20 @@ void log_init(void)
 
 	if (log_output == NULL)
 		log_output = stderr;
+	log_output_fd = fileno(log_output);
+
+	/* don't lose buffered debug messages on exit() or a crash */
+	atexit(log_flush);
+	log_catch_fatal_signals();
 
 	start = last_time = timeval_ms();
 }
 
 int set_log_output(struct command_context *cmd_ctx, FILE *output)
 {
+	log_flush();
 	log_output = output;
+	log_output_fd = fileno(output);
 	return ERROR_OK;
 }
 
@@ -438,15 +576,23 @@ void keep_alive()
 	}
 	if (current_time-last_time > 500)
 	{
-		/* this will keep the GDB connection alive */
+		/* this will keep the GDB connection alive, and
+		 * write out any buffered debug messages */
 		LOG_USER_N("%s", "");
 
+		/* let clients interrupt whatever is keeping us busy */
+		server_keep_alive();
+
 		/* DANGER!!!! do not add code to invoke e.g. target event processing,
 		 * jim timer processing, etc. it can cause infinite recursion +
 		 * jim event callbacks need to happen at a well defined time,
 		 * not anywhere keep_alive() is invoked.
 		 *
 		 * These functions should be invoked at a well defined spot in server.c
+		 *
+		 * server_keep_alive() above only peeks at the connection whose
+		 * command is running for an interrupt request, it never
+		 * processes input.
 		 */
 
 		last_time = current_time;
@@ -71,6 +71,8 @@ __attribute__ ((format (PRINTF_ATTRIBUTE_FORMAT, 5, 6)));
  */
 void log_init(void);
 int set_log_output(struct command_context *cmd_ctx, FILE *output);
+/// Write out debug messages still held in the log buffer.
+void log_flush(void);
 
 int log_register_commands(struct command_context *cmd_ctx);
 
@@ -25,6 +25,7 @@
 #endif
 
 #include "configuration.h"
+#include "startup_profile.h"
 // @todo the inclusion of server.h here is a layering violation
 #include <server/server.h>
 
@@ -42,6 +43,7 @@ static const struct option long_options[] =
 	{"log_output",	required_argument,	0,	'l'},
 	{"command",	required_argument,	0,		'c'},
 	{"pipe",	no_argument,		0,		'p'},
+	{"startup-profile", optional_argument,	0,		'P'},
 	{0, 0, 0, 0}
 };
 
@@ -183,6 +185,10 @@ int parse_cmdline_args(struct command_context *cmd_ctx, int argc, char *argv[])
 				command_run_line(cmd_ctx, "gdb_port pipe; log_output openocd.log");
 				LOG_WARNING("deprecated option: -p/--pipe. Use '-c \"gdb_port pipe; log_output openocd.log\"' instead.");
 				break;
+			case 'P':	/* --startup-profile */
+				if (startup_profile_start(cmd_ctx, optarg) != ERROR_OK)
+					return ERROR_FAIL;
+				break;
 		}
 	}
 
@@ -196,6 +202,9 @@ int parse_cmdline_args(struct command_context *cmd_ctx, int argc, char *argv[])
 		LOG_OUTPUT("--debug      | -d\tset debug level <0-3>\n");
 		LOG_OUTPUT("--log_output | -l\tredirect log output to file <name>\n");
 		LOG_OUTPUT("--command    | -c\trun <command>\n");
+		LOG_OUTPUT("--startup-profile[=<file>]\n"
+				"\t\t\treport time spent starting up, "
+				"as Chrome trace if <file> ends in .json\n");
 		exit(-1);
 	}
 
@@ -0,0 +1,304 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "startup_profile.h"
+#include "log.h"
+#include "time_support.h"
+
+struct startup_profile_event
+{
+	const char *category;
+	char *name;
+	int64_t start_us;
+	int64_t duration_us;
+};
+
+/* one line of the text report: all spans sharing category and name */
+struct startup_profile_total
+{
+	const char *category;
+	const char *name;
+	unsigned count;
+	int64_t total_us;
+	int64_t max_us;
+};
+
+static bool profile_enabled;
+static char *profile_output;
+static int64_t profile_epoch_us;
+
+static struct startup_profile_event *profile_events;
+static unsigned profile_count;
+static unsigned profile_size;
+
+static int64_t profile_now_us(void)
+{
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	return (int64_t)now.tv_sec * 1000000 + now.tv_usec;
+}
+
+bool startup_profile_enabled(void)
+{
+	return profile_enabled;
+}
+
+void startup_profile_begin(struct startup_profile_span *span)
+{
+	if (profile_enabled)
+		span->start_us = profile_now_us();
+}
+
+void startup_profile_end(struct startup_profile_span *span,
+		const char *category, const char *name)
+{
+	if (!profile_enabled)
+		return;
+
+	int64_t end_us = profile_now_us();
+
+	if (profile_count == profile_size)
+	{
+		unsigned size = profile_size ? profile_size * 2 : 256;
+		struct startup_profile_event *events = realloc(profile_events,
+				size * sizeof(*events));
+		if (NULL == events)
+			return;
+		profile_events = events;
+		profile_size = size;
+	}
+
+	char *copy = strdup(name);
+	if (NULL == copy)
+		return;
+
+	struct startup_profile_event *e = &profile_events[profile_count++];
+	e->category = category;
+	e->name = copy;
+	e->start_us = span->start_us - profile_epoch_us;
+	e->duration_us = end_us - span->start_us;
+}
+
+/* Replaces Jim's "source" while profiling, so each script file --
+ * including the ones sourced by other scripts -- gets a span.
+ */
+static int startup_profile_source(Jim_Interp *interp,
+		int argc, Jim_Obj *const *argv)
+{
+	if (argc != 2)
+	{
+		Jim_WrongNumArgs(interp, 1, argv, "fileName");
+		return JIM_ERR;
+	}
+	const char *file = Jim_GetString(argv[1], NULL);
+
+	struct startup_profile_span span;
+	startup_profile_begin(&span);
+	int retval = Jim_EvalFile(interp, file);
+	startup_profile_end(&span, "script", file);
+
+	if (retval == JIM_RETURN)
+		retval = JIM_OK;
+	return retval;
+}
+
+int startup_profile_start(struct command_context *cmd_ctx, const char *output)
+{
+	if (profile_enabled)
+		return ERROR_OK;
+
+	if (NULL != output)
+	{
+		profile_output = strdup(output);
+		if (NULL == profile_output)
+			return ERROR_FAIL;
+	}
+
+	Jim_CreateCommand(cmd_ctx->interp, "source",
+			startup_profile_source, NULL, NULL);
+
+	profile_epoch_us = profile_now_us();
+	profile_enabled = true;
+	return ERROR_OK;
+}
+
+static void profile_json_string(FILE *f, const char *s)
+{
+	fputc('"', f);
+	for (; *s; s++)
+	{
+		if (*s == '"' || *s == '\\')
+			fprintf(f, "\\%c", *s);
+		else if ((unsigned char)*s < 0x20)
+			fprintf(f, "\\u%04x", (unsigned char)*s);
+		else
+			fputc(*s, f);
+	}
+	fputc('"', f);
+}
+
+/* Chrome trace event format, as loaded by chrome://tracing.  Spans
+ * are "complete" events, so nesting is derived from their times.
+ */
+static void profile_write_trace(FILE *f)
+{
+	fprintf(f, "{\"traceEvents\":[\n");
+	for (unsigned i = 0; i < profile_count; i++)
+	{
+		struct startup_profile_event *e = &profile_events[i];
+		fprintf(f, "{\"name\":");
+		profile_json_string(f, e->name);
+		fprintf(f, ",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"
+				"\"ts\":%lld,\"dur\":%lld}%s\n",
+				e->category, (long long)e->start_us,
+				(long long)e->duration_us,
+				(i + 1 < profile_count) ? "," : "");
+	}
+	fprintf(f, "],\"displayTimeUnit\":\"ms\"}\n");
+}
+
+static int profile_by_name(const void *a, const void *b)
+{
+	const struct startup_profile_event *ea = a, *eb = b;
+	int cmp = strcmp(ea->category, eb->category);
+	return cmp ? cmp : strcmp(ea->name, eb->name);
+}
+
+static int profile_by_total(const void *a, const void *b)
+{
+	const struct startup_profile_total *ta = a, *tb = b;
+	if (ta->total_us != tb->total_us)
+		return (ta->total_us < tb->total_us) ? 1 : -1;
+	return 0;
+}
+
+static void profile_emit(FILE *f, const char *format, ...)
+{
+	va_list ap;
+	va_start(ap, format);
+	if (NULL != f)
+		vfprintf(f, format, ap);
+	else
+	{
+		char *line = alloc_vprintf(format, ap);
+		if (NULL != line)
+		{
+			LOG_USER_N("%s", line);
+			free(line);
+		}
+	}
+	va_end(ap);
+}
+
+/* Text report: one line per distinct span, most expensive first.
+ * Times are inclusive, so a script's total covers the commands and
+ * scripts it ran.
+ */
+static void profile_write_report(FILE *f)
+{
+	struct startup_profile_total *totals = NULL;
+	unsigned ntotals = 0;
+
+	if (profile_count)
+	{
+		totals = malloc(profile_count * sizeof(*totals));
+		if (NULL == totals)
+		{
+			LOG_ERROR("no memory for the startup profile report");
+			return;
+		}
+		qsort(profile_events, profile_count, sizeof(*profile_events),
+				profile_by_name);
+	}
+
+	for (unsigned i = 0; i < profile_count; i++)
+	{
+		struct startup_profile_event *e = &profile_events[i];
+		struct startup_profile_total *t;
+		if (ntotals && !profile_by_name(e, &profile_events[i - 1]))
+			t = &totals[ntotals - 1];
+		else
+		{
+			t = &totals[ntotals++];
+			t->category = e->category;
+			t->name = e->name;
+			t->count = 0;
+			t->total_us = 0;
+			t->max_us = 0;
+		}
+		t->count++;
+		t->total_us += e->duration_us;
+		if (e->duration_us > t->max_us)
+			t->max_us = e->duration_us;
+	}
+	qsort(totals, ntotals, sizeof(*totals), profile_by_total);
+
+	profile_emit(f, "startup profile: %lld ms total\n",
+			(long long)((profile_now_us() - profile_epoch_us) / 1000));
+	profile_emit(f, "%10s %10s %6s  %-8s %s\n",
+			"total ms", "max ms", "count", "kind", "name");
+	for (unsigned i = 0; i < ntotals; i++)
+	{
+		struct startup_profile_total *t = &totals[i];
+		profile_emit(f, "%10.3f %10.3f %6u  %-8s %s\n",
+				t->total_us / 1000.0, t->max_us / 1000.0,
+				t->count, t->category, t->name);
+	}
+
+	free(totals);
+}
+
+void startup_profile_finish(void)
+{
+	if (!profile_enabled)
+		return;
+	profile_enabled = false;
+
+	FILE *f = NULL;
+	if (NULL != profile_output)
+	{
+		f = fopen(profile_output, "w");
+		if (NULL == f)
+			LOG_ERROR("can't write startup profile to '%s'",
+					profile_output);
+	}
+
+	size_t len = profile_output ? strlen(profile_output) : 0;
+	if ((NULL != f) && (len > 5)
+			&& (strcmp(profile_output + len - 5, ".json") == 0))
+		profile_write_trace(f);
+	else if ((NULL != f) || (NULL == profile_output))
+		profile_write_report(f);
+
+	if (NULL != f)
+	{
+		fclose(f);
+		LOG_INFO("startup profile written to '%s'", profile_output);
+	}
+
+	for (unsigned i = 0; i < profile_count; i++)
+		free(profile_events[i].name);
+	free(profile_events);
+	profile_events = NULL;
+	profile_count = profile_size = 0;
+
+	free(profile_output);
+	profile_output = NULL;
+}
@@ -0,0 +1,63 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#ifndef STARTUP_PROFILE_H
+#define STARTUP_PROFILE_H
+
+#include <helper/command.h>
+
+/**
+ * @file
+ * Wall-clock profiling of OpenOCD startup, enabled by the
+ * --startup-profile option.  Spans are recorded for each sourced
+ * script, each command, and the interesting parts of "init"; they
+ * are reported once startup completes.  While the profiler is off,
+ * beginning and ending a span costs one test of a flag.
+ */
+
+/** A span being timed; only meaningful between begin and end. */
+struct startup_profile_span
+{
+	int64_t start_us;
+};
+
+/// @returns true while startup spans are being recorded.
+bool startup_profile_enabled(void);
+
+/**
+ * Start recording.  Takes over the Jim "source" command so that
+ * every script file gets its own span.
+ * @param cmd_ctx The command context whose interpreter runs the
+ *	configuration scripts.
+ * @param output Where the report goes: NULL for the log, a file
+ *	name ending in ".json" for Chrome trace event format, or any
+ *	other file name for a plain text report.
+ */
+int startup_profile_start(struct command_context *cmd_ctx, const char *output);
+
+void startup_profile_begin(struct startup_profile_span *span);
+/**
+ * Record a finished span.
+ * @param category Span kind, such as "script", "command" or "jtag".
+ * @param name Span name; it is copied.
+ */
+void startup_profile_end(struct startup_profile_span *span,
+		const char *category, const char *name);
+
+/// Stop recording, write the report and release all spans.
+void startup_profile_finish(void);
+
+#endif /* STARTUP_PROFILE_H */
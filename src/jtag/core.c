@@ -34,6 +34,8 @@
 #include "jtag.h"
 #include "interface.h"
 #include "transport.h"
+#include <helper/event_trace.h>
+#include <helper/startup_profile.h>
 
 #ifdef HAVE_STRINGS_H
 #include <strings.h>
@@ -98,6 +100,9 @@ tap_state_t cmd_queue_cur_state = TAP_RESET;
 static bool jtag_verify_capture_ir = true;
 static int jtag_verify = 1;
 
+/* file holding the scan chain found by the last full examination */
+static char *jtag_chain_cache_file = NULL;
+
 /* how long the OpenOCD should wait before attempting JTAG communication after reset lines deasserted (in ms) */
 static int adapter_nsrst_delay = 0; /* default to no nSRST delay */
 static int jtag_ntrst_delay = 0; /* default to no nTRST delay */
@@ -832,7 +837,19 @@ int default_interface_jtag_execute_queue(void)
 void jtag_execute_queue_noclear(void)
 {
 	jtag_flush_queue_count++;
-	jtag_set_error(interface_jtag_execute_queue());
+	if (event_trace_enabled)
+	{
+		struct timeval start, end;
+		gettimeofday(&start, NULL);
+		int retval = interface_jtag_execute_queue();
+		gettimeofday(&end, NULL);
+		EVENT_TRACE(EVENT_TRACE_JTAG_FLUSH, retval, 0, 0,
+				(end.tv_sec - start.tv_sec) * 1000000
+				+ (end.tv_usec - start.tv_usec));
+		jtag_set_error(retval);
+	}
+	else
+		jtag_set_error(interface_jtag_execute_queue());
 
 	if (jtag_flush_queue_sleep > 0)
 	{
@@ -1302,6 +1319,183 @@ done:
 	return retval;
 }
 
+/* One TAP as recorded in the chain cache; an idcode of zero means
+ * the TAP came up in BYPASS.
+ */
+struct jtag_chain_cache_entry {
+	uint32_t idcode;
+	unsigned ir_length;
+};
+
+static int jtag_chain_cache_load(struct jtag_chain_cache_entry *entries)
+{
+	FILE *f = fopen(jtag_chain_cache_file, "r");
+	if (!f) {
+		LOG_DEBUG("no chain cache '%s'", jtag_chain_cache_file);
+		return ERROR_FAIL;
+	}
+
+	struct jtag_tap *tap = NULL;
+	unsigned count = 0;
+	int retval = ERROR_OK;
+	char line[128];
+
+	while (retval == ERROR_OK && fgets(line, sizeof(line), f)) {
+		char name[64];
+		unsigned idcode, ir_length;
+
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+
+		/* entries must name the enabled TAPs, in chain order */
+		tap = jtag_tap_next_enabled(tap);
+		if (sscanf(line, "%63s %x %u", name, &idcode, &ir_length) != 3
+				|| !tap || count == JTAG_MAX_CHAIN_SIZE
+				|| strcmp(name, tap->dotted_name) != 0
+				|| ir_length < 2 || ir_length > 32
+				|| (tap->ir_length && tap->ir_length != (int) ir_length))
+			retval = ERROR_FAIL;
+		else {
+			entries[count].idcode = idcode;
+			entries[count].ir_length = ir_length;
+			count++;
+		}
+	}
+	fclose(f);
+
+	if (retval == ERROR_OK && (count == 0 || jtag_tap_next_enabled(tap)))
+		retval = ERROR_FAIL;
+	if (retval != ERROR_OK)
+		LOG_INFO("chain cache '%s' does not match the configured TAPs",
+				jtag_chain_cache_file);
+	return retval;
+}
+
+static void jtag_chain_cache_save(void)
+{
+	FILE *f = fopen(jtag_chain_cache_file, "w");
+	if (!f) {
+		LOG_WARNING("can't write chain cache '%s'",
+				jtag_chain_cache_file);
+		return;
+	}
+
+	fprintf(f, "# JTAG scan chain fingerprint: tap idcode irlen\n");
+	for (struct jtag_tap *tap = jtag_tap_next_enabled(NULL); tap;
+			tap = jtag_tap_next_enabled(tap))
+		fprintf(f, "%s 0x%08" PRIx32 " %d\n", tap->dotted_name,
+				tap->hasidcode ? tap->idcode : 0, tap->ir_length);
+	fclose(f);
+
+	LOG_INFO("saved chain fingerprint to '%s'", jtag_chain_cache_file);
+}
+
+/*
+ * Check the chain against the cached fingerprint.  One queue flush
+ * does both the IDCODE/BYPASS scan, sized for the cached chain plus
+ * one end-of-chain word, and the IR capture scan; this replaces the
+ * blind interrogation and separate IR capture validation.  On success
+ * the TAPs are set up just as that full examination would have left
+ * them: IDCODEs recorded, IR lengths known, all TAPs in BYPASS.
+ */
+static int jtag_chain_cache_verify(void)
+{
+	struct jtag_chain_cache_entry entries[JTAG_MAX_CHAIN_SIZE];
+	struct jtag_tap *tap;
+	unsigned dr_bits = 32, ir_bits = 2;
+	unsigned i, pos;
+	int retval;
+
+	retval = jtag_chain_cache_load(entries);
+	if (retval != ERROR_OK)
+		return retval;
+
+	for (tap = jtag_tap_next_enabled(NULL), i = 0; tap;
+			tap = jtag_tap_next_enabled(tap), i++) {
+		dr_bits += entries[i].idcode ? 32 : 1;
+		ir_bits += entries[i].ir_length;
+	}
+
+	uint8_t dr[DIV_ROUND_UP(JTAG_MAX_CHAIN_SIZE * 32 + 32, 8)];
+	uint8_t ir[DIV_ROUND_UP(JTAG_MAX_CHAIN_SIZE * 32 + 2, 8)];
+
+	for (pos = 0; pos < dr_bits; pos += 32)
+		buf_set_u32(dr, pos, 32, END_OF_CHAIN_FLAG);
+	buf_set_ones(ir, ir_bits);
+
+	jtag_add_plain_dr_scan(dr_bits, dr, dr, TAP_DRPAUSE);
+	jtag_add_tlr();
+	jtag_add_plain_ir_scan(ir_bits, ir, ir, TAP_IDLE);
+	retval = jtag_execute_queue();
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* IDCODE or BYPASS bit of each TAP, then our end-of-chain word */
+	for (tap = jtag_tap_next_enabled(NULL), i = 0, pos = 0; tap;
+			tap = jtag_tap_next_enabled(tap), i++) {
+		if (entries[i].idcode) {
+			if (buf_get_u32(dr, pos, 32) != entries[i].idcode)
+				break;
+			pos += 32;
+		} else {
+			if (buf_get_u32(dr, pos, 1) != 0)
+				break;
+			pos += 1;
+		}
+	}
+	if (tap || !jtag_idcode_is_final(buf_get_u32(dr, pos, 32)))
+		goto mismatch;
+
+	/* captured IR values, then the '11' sentinel */
+	for (tap = jtag_tap_next_enabled(NULL), i = 0, pos = 0; tap;
+			tap = jtag_tap_next_enabled(tap), i++) {
+		uint32_t val = buf_get_u32(ir, pos, entries[i].ir_length);
+		if ((val & tap->ir_capture_mask) != tap->ir_capture_value)
+			break;
+		pos += entries[i].ir_length;
+	}
+	if (tap || buf_get_u32(ir, pos, 2) != 0x3)
+		goto mismatch;
+
+	for (tap = jtag_tap_next_enabled(NULL), i = 0; tap;
+			tap = jtag_tap_next_enabled(tap), i++) {
+		tap->hasidcode = entries[i].idcode != 0;
+		tap->idcode = entries[i].idcode;
+		if (tap->hasidcode)
+			jtag_examine_chain_display(LOG_LVL_INFO,
+					"tap/device found",
+					tap->dotted_name, tap->idcode);
+
+		/* a stale cache must not hide a configuration problem */
+		if (!jtag_examine_chain_match_tap(tap))
+			goto mismatch;
+	}
+	for (tap = jtag_tap_next_enabled(NULL), i = 0; tap;
+			tap = jtag_tap_next_enabled(tap), i++)
+		tap->ir_length = entries[i].ir_length;
+
+	LOG_INFO("JTAG scan chain matches fingerprint '%s'",
+			jtag_chain_cache_file);
+	return ERROR_OK;
+
+mismatch:
+	LOG_INFO("JTAG scan chain differs from fingerprint '%s'; "
+			"examining it in full", jtag_chain_cache_file);
+	jtag_add_tlr();
+	jtag_execute_queue();
+	return ERROR_FAIL;
+}
+
+void jtag_set_chain_cache(const char *file)
+{
+	free(jtag_chain_cache_file);
+	jtag_chain_cache_file = file ? strdup(file) : NULL;
+}
+
+const char *jtag_get_chain_cache(void)
+{
+	return jtag_chain_cache_file;
+}
 
 void jtag_tap_init(struct jtag_tap *tap)
 {
@@ -1457,11 +1651,27 @@ int jtag_init_inner(struct command_context *cmd_ctx)
 	if ((retval = jtag_execute_queue()) != ERROR_OK)
 		return retval;
 
+	/* A board which asked for a chain cache can skip the blind
+	 * interrogation when the chain still matches it.
+	 */
+	struct startup_profile_span span;
+	if (tap && jtag_chain_cache_file) {
+		startup_profile_begin(&span);
+		retval = jtag_chain_cache_verify();
+		startup_profile_end(&span, "jtag", "jtag_chain_cache_verify");
+		if (retval == ERROR_OK) {
+			jtag_notify_event(JTAG_TAP_EVENT_SETUP);
+			return ERROR_OK;
+		}
+	}
+
 	/* Examine DR values first.  This discovers problems which will
 	 * prevent communication ... hardware issues like TDO stuck, or
 	 * configuring the wrong number of (enabled) TAPs.
 	 */
+	startup_profile_begin(&span);
 	retval = jtag_examine_chain();
+	startup_profile_end(&span, "jtag", "jtag_examine_chain");
 	switch (retval) {
 	case ERROR_OK:
 		/* complete success */
@@ -1487,7 +1697,9 @@ int jtag_init_inner(struct command_context *cmd_ctx)
 	 * latter is uncommon, but easily worked around:  provide
 	 * ircapture/irmask values during TAP setup.)
 	 */
+	startup_profile_begin(&span);
 	retval = jtag_validate_ircapture();
+	startup_profile_end(&span, "jtag", "jtag_validate_ircapture");
 	if (retval != ERROR_OK)
 	{
 		/* The target might be powered down. The user
@@ -1498,7 +1710,11 @@ int jtag_init_inner(struct command_context *cmd_ctx)
 	}
 
 	if (issue_setup)
+	{
+		if (tap && jtag_chain_cache_file)
+			jtag_chain_cache_save();
 		jtag_notify_event(JTAG_TAP_EVENT_SETUP);
+	}
 	else
 		LOG_WARNING("Bypassing JTAG setup events due to errors");
 
@@ -1571,7 +1787,11 @@ int jtag_init_reset(struct command_context *cmd_ctx)
 	 * That would allow users to more easily perform any magic they need to before
 	 * reset happens.
 	 */
-	return jtag_init_inner(cmd_ctx);
+	struct startup_profile_span span;
+	startup_profile_begin(&span);
+	retval = jtag_init_inner(cmd_ctx);
+	startup_profile_end(&span, "jtag", "jtag_init_inner");
+	return retval;
 }
 
 int jtag_init(struct command_context *cmd_ctx)
@@ -308,6 +308,14 @@ void jtag_set_verify_capture_ir(bool enable);
 /// @returns True if IR scan verification will be performed.
 bool jtag_will_verify_capture_ir(void);
 
+/**
+ * Use a cached scan chain fingerprint to speed up chain examination.
+ * @param file Where the fingerprint is kept, or NULL to stop caching.
+ */
+void jtag_set_chain_cache(const char *file);
+/// @returns The chain cache file, or NULL if no cache is used.
+const char *jtag_get_chain_cache(void);
+
 /** Initialize debug adapter upon startup.  */
 int  adapter_init(struct command_context* cmd_ctx);
 
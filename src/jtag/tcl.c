@@ -40,6 +40,7 @@
 #include <strings.h>
 #endif
 
+#include <helper/startup_profile.h>
 #include <helper/time_support.h>
 
 /**
@@ -688,7 +689,10 @@ static int jim_jtag_arp_init(Jim_Interp *interp, int argc, Jim_Obj *const *argv)
 		return JIM_ERR;
 	}
 	struct command_context *context = current_command_context(interp);
+	struct startup_profile_span span;
+	startup_profile_begin(&span);
 	int e = jtag_init_inner(context);
+	startup_profile_end(&span, "jtag", "jtag_init_inner");
 	if (e != ERROR_OK) {
 		Jim_Obj *eObj = Jim_NewIntObj(goi.interp, e);
 		Jim_SetResultFormatted(goi.interp, "error: %#s", eObj);
@@ -849,6 +853,25 @@ COMMAND_HANDLER(handle_jtag_init_command)
 	return jtag_init(CMD_CTX);
 }
 
+COMMAND_HANDLER(handle_jtag_chain_cache_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1)
+	{
+		if (strcmp(CMD_ARGV[0], "none") == 0)
+			jtag_set_chain_cache(NULL);
+		else
+			jtag_set_chain_cache(CMD_ARGV[0]);
+	}
+
+	const char *file = jtag_get_chain_cache();
+	command_print(CMD_CTX, "chain cache: %s", file ? file : "none");
+
+	return ERROR_OK;
+}
+
 static const struct command_registration jtag_subcommand_handlers[] = {
 	{
 		.name = "init",
@@ -930,6 +953,15 @@ static const struct command_registration jtag_subcommand_handlers[] = {
 		.jim_handler = jim_jtag_names,
 		.help = "Returns list of all JTAG tap names.",
 	},
+	{
+		.name = "chain_cache",
+		.mode = COMMAND_ANY,
+		.handler = handle_jtag_chain_cache_command,
+		.help = "Keep the scan chain found by a full examination "
+			"in a file, and on later examinations check the "
+			"chain against it with one short scan.",
+		.usage = "[filename|'none']",
+	},
 	{
 		.chain = jtag_command_handlers_to_move,
 	},
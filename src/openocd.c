@@ -35,6 +35,8 @@
 #include <helper/ioutil.h>
 #include <helper/util.h>
 #include <helper/configuration.h>
+#include <helper/event_trace.h>
+#include <helper/startup_profile.h>
 #include <flash/nor/core.h>
 #include <flash/nand/core.h>
 #include <pld/pld.h>
@@ -128,7 +130,11 @@ COMMAND_HANDLER(handle_init_command)
 	if (ERROR_OK != retval)
 		return ERROR_FAIL;
 
-	if ((retval = adapter_init(CMD_CTX)) != ERROR_OK)
+	struct startup_profile_span span;
+	startup_profile_begin(&span);
+	retval = adapter_init(CMD_CTX);
+	startup_profile_end(&span, "jtag", "adapter_init");
+	if (retval != ERROR_OK)
 	{
 		/* we must be able to set up the debug adapter */
 		return retval;
@@ -273,6 +279,7 @@ struct command_context *setup_command_handler(Jim_Interp *interp)
 		&server_register_commands,
 		&gdb_register_commands,
 		&log_register_commands,
+		&event_trace_register_commands,
 		&transport_register_commands,
 		&interface_register_commands,
 		&target_register_commands,
@@ -305,19 +312,33 @@ static int main2(int argc, char *argv[], struct command_context *cmd_ctx)
 {
 	int ret;
 
+	/* the profile may already have been started by the command line,
+	 * so every failure below reports what it has got so far */
 	if (parse_cmdline_args(cmd_ctx, argc, argv) != ERROR_OK)
+	{
+		startup_profile_finish();
 		return EXIT_FAILURE;
+	}
 
 	if (server_preinit() != ERROR_OK)
+	{
+		startup_profile_finish();
 		return EXIT_FAILURE;
+	}
 
 	ret = parse_config_file(cmd_ctx);
 	if (ret != ERROR_OK)
+	{
+		startup_profile_finish();
 		return EXIT_FAILURE;
+	}
 
 	ret = server_init(cmd_ctx);
 	if (ERROR_OK != ret)
+	{
+		startup_profile_finish();
 		return EXIT_FAILURE;
+	}
 
 	ret = command_run_line(cmd_ctx, "init_targets");
 	if (ERROR_OK != ret)
@@ -327,9 +348,15 @@ static int main2(int argc, char *argv[], struct command_context *cmd_ctx)
 	{
 		ret = command_run_line(cmd_ctx, "init");
 		if (ERROR_OK != ret)
+		{
+			startup_profile_finish();
 			return EXIT_FAILURE;
+		}
 	}
 
+	/* startup is over; report where its time went */
+	startup_profile_finish();
+
 	server_loop(cmd_ctx);
 
 	server_quit();
@@ -24,6 +24,7 @@
 #include "virtex2.h"
 #include "xilinx_bit.h"
 #include "pld.h"
+#include <helper/time_support.h>
 
 
 static int virtex2_set_instr(struct jtag_tap *tap, uint32_t new_instr)
@@ -129,19 +130,50 @@ static int virtex2_read_stat(struct pld_device *pld_device, uint32_t *status)
 	return ERROR_OK;
 }
 
+/* The bitstream is shifted in with scans of this many bytes, and the
+ * queue is run whenever this much of it is waiting; so neither the
+ * file nor the JTAG queue need be held in memory all at once.
+ */
+#define VIRTEX2_SCAN_BYTES	(64 * 1024)
+#define VIRTEX2_QUEUE_BYTES	(1024 * 1024)
+
 static int virtex2_load(struct pld_device *pld_device, const char *filename)
 {
 	struct virtex2_pld_device *virtex2_info = pld_device->driver_priv;
 	struct xilinx_bit_file bit_file;
+	struct jtag_tap *tap;
+	struct duration bench;
+	uint8_t *buffer;
+	uint32_t queued = 0;
+	int pad_first = 0, pad_last = 0;
+	bool found = false;
+	int scans = 0;
 	int retval;
-	unsigned int i;
-	struct scan_field field;
-
-	field.in_value = NULL;
 
-	if ((retval = xilinx_read_bit_file(&bit_file, filename)) != ERROR_OK)
+	if ((retval = xilinx_open_bit_file(&bit_file, filename)) != ERROR_OK)
 		return retval;
 
+	buffer = malloc(VIRTEX2_SCAN_BYTES);
+	if (buffer == NULL)
+	{
+		xilinx_free_bit_file(&bit_file);
+		return ERROR_FAIL;
+	}
+
+	/* Plain DR scans move through DRPAUSE but not Update-DR, so the
+	 * device sees a single stream.  The bypass bits of the other TAPs
+	 * go at its ends, as jtag_add_dr_scan() would put them.
+	 */
+	for (tap = jtag_tap_next_enabled(NULL); tap; tap = jtag_tap_next_enabled(tap))
+	{
+		if (tap == virtex2_info->tap)
+			found = true;
+		else if (found)
+			pad_last++;
+		else
+			pad_first++;
+	}
+
 	virtex2_set_instr(virtex2_info->tap, 0xb); /* JPROG_B */
 	jtag_execute_queue();
 	jtag_add_sleep(1000);
@@ -149,14 +181,63 @@ static int virtex2_load(struct pld_device *pld_device, const char *filename)
 	virtex2_set_instr(virtex2_info->tap, 0x5); /* CFG_IN */
 	jtag_execute_queue();
 
-	for (i = 0; i < bit_file.length; i++)
-		bit_file.data[i] = flip_u32(bit_file.data[i], 8);
+	duration_start(&bench);
 
-	field.num_bits = bit_file.length * 8;
-	field.out_value = bit_file.data;
+	memset(buffer, 0, VIRTEX2_SCAN_BYTES);
+	if (pad_first > 0)
+		jtag_add_plain_dr_scan(pad_first, buffer, NULL, TAP_DRPAUSE);
 
-	jtag_add_dr_scan(virtex2_info->tap, 1, &field, TAP_DRPAUSE);
-	jtag_execute_queue();
+	while (bit_file.offset < bit_file.length)
+	{
+		uint32_t size = bit_file.length - bit_file.offset;
+
+		if (size > VIRTEX2_SCAN_BYTES)
+			size = VIRTEX2_SCAN_BYTES;
+
+		retval = xilinx_read_bit_data(&bit_file, buffer, size);
+		if (retval != ERROR_OK)
+			break;
+
+		/* the queue keeps its own copy of the data */
+		buf_flip_bytes(buffer, size);
+		jtag_add_plain_dr_scan(size * 8, buffer, NULL, TAP_DRPAUSE);
+		scans++;
+
+		queued += size;
+		if (queued >= VIRTEX2_QUEUE_BYTES)
+		{
+			retval = jtag_execute_queue();
+			if (retval != ERROR_OK)
+				break;
+			queued = 0;
+		}
+	}
+
+	if (retval == ERROR_OK)
+	{
+		memset(buffer, 0, VIRTEX2_SCAN_BYTES);
+		if (pad_last > 0)
+			jtag_add_plain_dr_scan(pad_last, buffer, NULL, TAP_DRPAUSE);
+		retval = jtag_execute_queue();
+	}
+
+	free(buffer);
+
+	if (retval != ERROR_OK)
+	{
+		LOG_ERROR("failed after %" PRIu32 " of %" PRIu32 " bytes of '%s'",
+				bit_file.offset, bit_file.length, filename);
+		xilinx_free_bit_file(&bit_file);
+		return retval;
+	}
+
+	if (duration_measure(&bench) == ERROR_OK)
+	{
+		LOG_INFO("shifted %" PRIu32 " bytes in %d scans, %fs (%0.3f KiB/s)",
+				bit_file.length, scans, duration_elapsed(&bench),
+				duration_kbps(&bench, bit_file.length));
+	}
+	xilinx_free_bit_file(&bit_file);
 
 	jtag_add_tlr();
 
@@ -28,11 +28,11 @@
 #include <sys/stat.h>
 
 
-static int read_section(FILE *input_file, int length_size, char section,
-		uint32_t *buffer_length, uint8_t **buffer)
+/* reads a section's tag and length, leaving the file at its data */
+static int read_section_length(FILE *input_file, int length_size, char section,
+		uint32_t *length)
 {
 	uint8_t length_buffer[4];
-	int length;
 	char section_char;
 	int read_count;
 
@@ -58,16 +58,29 @@ static int read_section(FILE *input_file, int length_size, char section,
 	}
 
 	if (length_size == 4)
-		length = be_to_h_u32(length_buffer);
+		*length = be_to_h_u32(length_buffer);
 	else /* (length_size == 2) */
-		length = be_to_h_u16(length_buffer);
+		*length = be_to_h_u16(length_buffer);
+
+	return ERROR_OK;
+}
+
+static int read_section(FILE *input_file, int length_size, char section,
+		uint32_t *buffer_length, uint8_t **buffer)
+{
+	uint32_t length;
+
+	if (read_section_length(input_file, length_size, section, &length) != ERROR_OK)
+		return ERROR_PLD_FILE_LOAD_FAILED;
 
 	if (buffer_length)
 		*buffer_length = length;
 
 	*buffer = malloc(length);
+	if (!*buffer)
+		return ERROR_PLD_FILE_LOAD_FAILED;
 
-	if ((read_count = fread(*buffer, 1, length, input_file)) != length)
+	if (fread(*buffer, 1, length, input_file) != length)
 	{
 		return ERROR_PLD_FILE_LOAD_FAILED;
 	}
@@ -75,15 +88,17 @@ static int read_section(FILE *input_file, int length_size, char section,
 	return ERROR_OK;
 }
 
-int xilinx_read_bit_file(struct xilinx_bit_file *bit_file, const char *filename)
+int xilinx_open_bit_file(struct xilinx_bit_file *bit_file, const char *filename)
 {
-	FILE *input_file;
 	struct stat input_stat;
 	int read_count;
+	long data_start;
 
 	if (!filename || !bit_file)
 		return ERROR_INVALID_ARGUMENTS;
 
+	memset(bit_file, 0, sizeof(*bit_file));
+
 	if (stat(filename, &input_stat) == -1)
 	{
 		LOG_ERROR("couldn't stat() %s: %s", filename, strerror(errno));
@@ -101,37 +116,95 @@ int xilinx_read_bit_file(struct xilinx_bit_file *bit_file, const char *filename)
 		return ERROR_PLD_FILE_LOAD_FAILED;
 	}
 
-	if (!(input_file = fopen(filename, "rb")))
+	if (!(bit_file->input_file = fopen(filename, "rb")))
 	{
 		LOG_ERROR("couldn't open %s: %s", filename, strerror(errno));
 		return ERROR_PLD_FILE_LOAD_FAILED;
 	}
 
-	if ((read_count = fread(bit_file->unknown_header, 1, 13, input_file)) != 13)
+	if ((read_count = fread(bit_file->unknown_header, 1, 13, bit_file->input_file)) != 13)
 	{
 		LOG_ERROR("couldn't read unknown_header from file '%s'", filename);
-		return ERROR_PLD_FILE_LOAD_FAILED;
+		goto fail;
 	}
 
-	if (read_section(input_file, 2, 'a', NULL, &bit_file->source_file) != ERROR_OK)
-		return ERROR_PLD_FILE_LOAD_FAILED;
+	if (read_section(bit_file->input_file, 2, 'a', NULL, &bit_file->source_file) != ERROR_OK)
+		goto fail;
 
-	if (read_section(input_file, 2, 'b', NULL, &bit_file->part_name) != ERROR_OK)
-		return ERROR_PLD_FILE_LOAD_FAILED;
+	if (read_section(bit_file->input_file, 2, 'b', NULL, &bit_file->part_name) != ERROR_OK)
+		goto fail;
 
-	if (read_section(input_file, 2, 'c', NULL, &bit_file->date) != ERROR_OK)
-		return ERROR_PLD_FILE_LOAD_FAILED;
+	if (read_section(bit_file->input_file, 2, 'c', NULL, &bit_file->date) != ERROR_OK)
+		goto fail;
 
-	if (read_section(input_file, 2, 'd', NULL, &bit_file->time) != ERROR_OK)
-		return ERROR_PLD_FILE_LOAD_FAILED;
+	if (read_section(bit_file->input_file, 2, 'd', NULL, &bit_file->time) != ERROR_OK)
+		goto fail;
 
-	if (read_section(input_file, 4, 'e', &bit_file->length, &bit_file->data) != ERROR_OK)
-		return ERROR_PLD_FILE_LOAD_FAILED;
+	if (read_section_length(bit_file->input_file, 4, 'e', &bit_file->length) != ERROR_OK)
+		goto fail;
+
+	/* don't start loading a device from a truncated file */
+	data_start = ftell(bit_file->input_file);
+	if ((data_start < 0) || (bit_file->length > input_stat.st_size - data_start))
+	{
+		LOG_ERROR("file '%s' is truncated", filename);
+		goto fail;
+	}
 
 	LOG_DEBUG("bit_file: %s %s %s,%s %" PRIi32 "", bit_file->source_file, bit_file->part_name,
 		bit_file->date, bit_file->time, bit_file->length);
 
-	fclose(input_file);
+	return ERROR_OK;
+
+fail:
+	xilinx_free_bit_file(bit_file);
+	return ERROR_PLD_FILE_LOAD_FAILED;
+}
+
+int xilinx_read_bit_data(struct xilinx_bit_file *bit_file, uint8_t *buffer, uint32_t size)
+{
+	if ((bit_file->input_file == NULL) || (size > bit_file->length - bit_file->offset))
+		return ERROR_PLD_FILE_LOAD_FAILED;
+
+	if (fread(buffer, 1, size, bit_file->input_file) != size)
+	{
+		LOG_ERROR("couldn't read bitstream data");
+		return ERROR_PLD_FILE_LOAD_FAILED;
+	}
+	bit_file->offset += size;
 
 	return ERROR_OK;
 }
+
+int xilinx_read_bit_file(struct xilinx_bit_file *bit_file, const char *filename)
+{
+	int retval = xilinx_open_bit_file(bit_file, filename);
+	if (retval != ERROR_OK)
+		return retval;
+
+	bit_file->data = malloc(bit_file->length);
+	if (!bit_file->data
+			|| (xilinx_read_bit_data(bit_file, bit_file->data,
+					bit_file->length) != ERROR_OK))
+	{
+		xilinx_free_bit_file(bit_file);
+		return ERROR_PLD_FILE_LOAD_FAILED;
+	}
+
+	fclose(bit_file->input_file);
+	bit_file->input_file = NULL;
+
+	return ERROR_OK;
+}
+
+void xilinx_free_bit_file(struct xilinx_bit_file *bit_file)
+{
+	if (bit_file->input_file)
+		fclose(bit_file->input_file);
+	free(bit_file->source_file);
+	free(bit_file->part_name);
+	free(bit_file->date);
+	free(bit_file->time);
+	free(bit_file->data);
+	memset(bit_file, 0, sizeof(*bit_file));
+}
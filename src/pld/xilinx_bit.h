@@ -31,8 +31,20 @@ struct xilinx_bit_file
 	uint8_t *time;
 	uint32_t length;
 	uint8_t *data;
+	/* while streaming, the file at the next byte of data */
+	FILE *input_file;
+	uint32_t offset;
 };
 
+/* Reads the whole bitstream into bit_file->data. */
 int xilinx_read_bit_file(struct xilinx_bit_file *bit_file, const char *filename);
 
+/* Reads only the header; the data is then read in pieces with
+ * xilinx_read_bit_data(), so large bitstreams need little memory.
+ */
+int xilinx_open_bit_file(struct xilinx_bit_file *bit_file, const char *filename);
+/* Reads the next size bytes of data; size may not exceed what is left. */
+int xilinx_read_bit_data(struct xilinx_bit_file *bit_file, uint8_t *buffer, uint32_t size);
+void xilinx_free_bit_file(struct xilinx_bit_file *bit_file);
+
 #endif /* XILINX_BIT_H */
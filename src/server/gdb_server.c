@@ -60,9 +60,19 @@ struct gdb_connection
 	char buffer[GDB_BUFFER_SIZE];
 	char *buf_p;
 	int buf_cnt;
+	/* outgoing packets are framed here, grown on demand and kept for
+	 * the lifetime of the connection */
+	char *out_buffer;
+	size_t out_buffer_size;
+	/* scratch space for decoded memory and register data, also kept
+	 * across packets */
+	uint8_t *scratch;
+	size_t scratch_size;
 	int ctrl_c;
 	enum target_state frontend_state;
-	struct image *vflash_image;
+	/* flash writer fed by vFlashWrite packets, NULL outside of a
+	 * vFlashWrite sequence */
+	struct flash_write_stream *vflash_stream;
 	int closed;
 	int busy;
 	int noack_mode;
@@ -190,10 +200,19 @@ static int gdb_get_char_inner(struct connection *connection, int* next_char)
 		}
 		else
 		{
-			retval = check_pending(connection, 1, NULL);
-			if (retval != ERROR_OK)
-				return retval;
-			gdb_con->buf_cnt = read_socket(connection->fd, gdb_con->buffer, GDB_BUFFER_SIZE);
+#ifdef MSG_DONTWAIT
+			/* most of the time the data is already waiting, so only
+			 * wait for the socket if this non-blocking read comes back
+			 * empty handed */
+			gdb_con->buf_cnt = recv(connection->fd, gdb_con->buffer, GDB_BUFFER_SIZE, MSG_DONTWAIT);
+			if ((gdb_con->buf_cnt < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+#endif
+			{
+				retval = check_pending(connection, 1, NULL);
+				if (retval != ERROR_OK)
+					return retval;
+				gdb_con->buf_cnt = read_socket(connection->fd, gdb_con->buffer, GDB_BUFFER_SIZE);
+			}
 		}
 
 		if (gdb_con->buf_cnt > 0)
@@ -344,20 +363,90 @@ static int gdb_write(struct connection *connection, void *data, int len)
 	return ERROR_SERVER_REMOTE_CLOSED;
 }
 
-static int gdb_put_packet_inner(struct connection *connection,
-		char *buffer, int len)
+/* Make sure the connection's output buffer can hold a packet with
+ * @a len bytes of payload plus the '$', '#' and checksum framing.
+ */
+static char *gdb_get_out_buffer(struct connection *connection, size_t len)
+{
+	struct gdb_connection *gdb_con = connection->priv;
+
+	/* keep the doubling below from overflowing */
+	if (len > SIZE_MAX / 2 - 4)
+	{
+		LOG_ERROR("Can't send a %lu byte gdb packet", (unsigned long)len);
+		return NULL;
+	}
+
+	if (gdb_con->out_buffer_size < len + 4)
+	{
+		size_t size = gdb_con->out_buffer_size ? gdb_con->out_buffer_size : GDB_BUFFER_SIZE;
+		char *buffer;
+
+		while (size < len + 4)
+			size *= 2;
+		buffer = realloc(gdb_con->out_buffer, size);
+		if (buffer == NULL)
+		{
+			LOG_ERROR("Out of memory for a %lu byte gdb packet", (unsigned long)len);
+			return NULL;
+		}
+		gdb_con->out_buffer = buffer;
+		gdb_con->out_buffer_size = size;
+	}
+
+	return gdb_con->out_buffer;
+}
+
+static unsigned char gdb_checksum(const char *payload, int len)
 {
-	int i;
 	unsigned char my_checksum = 0;
-#ifdef _DEBUG_GDB_IO_
-	char *debug_buffer;
-#endif
+	int i;
+
+	for (i = 0; i < len; i++)
+		my_checksum += payload[i];
+
+	return my_checksum;
+}
+
+/* Returns at least @a size bytes of per-connection scratch space; its
+ * contents are only valid while handling the current packet.
+ */
+static uint8_t *gdb_get_scratch(struct connection *connection, size_t size)
+{
+	struct gdb_connection *gdb_con = connection->priv;
+
+	if (gdb_con->scratch_size < size)
+	{
+		uint8_t *scratch = realloc(gdb_con->scratch, size);
+		if (scratch == NULL)
+		{
+			LOG_ERROR("Out of memory for %lu bytes of gdb packet data",
+					(unsigned long)size);
+			return NULL;
+		}
+		gdb_con->scratch = scratch;
+		gdb_con->scratch_size = size;
+	}
+
+	return gdb_con->scratch;
+}
+
+/* Send the packet with @a len bytes of payload which has been built in
+ * the connection's output buffer, appending the checksum, and wait for
+ * GDB to acknowledge it.
+ */
+static int gdb_put_frame_inner(struct connection *connection,
+		int len, unsigned char my_checksum)
+{
+	struct gdb_connection *gdb_con = connection->priv;
+	char *frame = gdb_con->out_buffer;
 	int reply;
 	int retval;
-	struct gdb_connection *gdb_con = connection->priv;
 
-	for (i = 0; i < len; i++)
-		my_checksum += buffer[i];
+	frame[0] = '$';
+	frame[len + 1] = '#';
+	frame[len + 2] = DIGITS[(my_checksum >> 4) & 0xf];
+	frame[len + 3] = DIGITS[my_checksum & 0xf];
 
 #ifdef _DEBUG_GDB_IO_
 	/*
@@ -389,46 +478,13 @@ static int gdb_put_packet_inner(struct connection *connection,
 	while (1)
 	{
 #ifdef _DEBUG_GDB_IO_
-		debug_buffer = malloc(len + 1);
-		memcpy(debug_buffer, buffer, len);
-		debug_buffer[len] = 0;
-		LOG_DEBUG("sending packet '$%s#%2.2x'", debug_buffer, my_checksum);
-		free(debug_buffer);
+		LOG_DEBUG("sending packet '%.*s'", len + 4, frame);
 #endif
 
-		char local_buffer[1024];
-		local_buffer[0] = '$';
-		if ((size_t)len + 4 <= sizeof(local_buffer))
-		{
-			/* performance gain on smaller packets by only a single call to gdb_write() */
-			memcpy(local_buffer + 1, buffer, len++);
-			local_buffer[len++] = '#';
-			local_buffer[len++] = DIGITS[(my_checksum >> 4) & 0xf];
-			local_buffer[len++] = DIGITS[my_checksum & 0xf];
-			if ((retval = gdb_write(connection, local_buffer, len)) != ERROR_OK)
-			{
-				return retval;
-			}
-		}
-		else
+		/* the whole packet goes out with a single gdb_write() */
+		if ((retval = gdb_write(connection, frame, len + 4)) != ERROR_OK)
 		{
-			/* larger packets are transmitted directly from caller supplied buffer
-			   by several calls to gdb_write() to avoid dynamic allocation */
-			local_buffer[1] = '#';
-			local_buffer[2] = DIGITS[(my_checksum >> 4) & 0xf];
-			local_buffer[3] = DIGITS[my_checksum & 0xf];
-			if ((retval = gdb_write(connection, local_buffer, 1)) != ERROR_OK)
-			{
-				return retval;
-			}
-			if ((retval = gdb_write(connection, buffer, len)) != ERROR_OK)
-			{
-				return retval;
-			}
-			if ((retval = gdb_write(connection, local_buffer + 1, 3)) != ERROR_OK)
-			{
-				return retval;
-			}
+			return retval;
 		}
 
 		if (gdb_con->noack_mode)
@@ -487,11 +543,12 @@ static int gdb_put_packet_inner(struct connection *connection,
 	return ERROR_OK;
 }
 
-int gdb_put_packet(struct connection *connection, char *buffer, int len)
+static int gdb_put_frame(struct connection *connection,
+		int len, unsigned char my_checksum)
 {
 	struct gdb_connection *gdb_con = connection->priv;
 	gdb_con->busy = 1;
-	int retval = gdb_put_packet_inner(connection, buffer, len);
+	int retval = gdb_put_frame_inner(connection, len, my_checksum);
 	gdb_con->busy = 0;
 
 	/* we sent some data, reset timer for keep alive messages */
@@ -500,6 +557,60 @@ int gdb_put_packet(struct connection *connection, char *buffer, int len)
 	return retval;
 }
 
+int gdb_put_packet(struct connection *connection, char *buffer, int len)
+{
+	unsigned char my_checksum = 0;
+	char *payload;
+	int i;
+
+	payload = gdb_get_out_buffer(connection, len);
+	if (payload == NULL)
+		return ERROR_GDB_BUFFER_TOO_SMALL;
+	payload++;
+
+	/* copy and checksum in one go */
+	for (i = 0; i < len; i++)
+	{
+		char c = buffer[i];
+		payload[i] = c;
+		my_checksum += c;
+	}
+
+	return gdb_put_frame(connection, len, my_checksum);
+}
+
+/**
+ * Sends @a prefix followed by @a len bytes of @a data, hex encoded.
+ * The data is encoded and checksummed in a single pass, straight into
+ * the connection's output buffer.
+ */
+static int gdb_put_packet_hex(struct connection *connection,
+		const char *prefix, const uint8_t *data, size_t len)
+{
+	unsigned char my_checksum = 0;
+	size_t prefix_len = prefix ? strlen(prefix) : 0;
+	char *payload;
+	size_t i;
+
+	if (len > (SIZE_MAX / 2 - prefix_len) / 2)
+		return ERROR_GDB_BUFFER_TOO_SMALL;
+
+	payload = gdb_get_out_buffer(connection, prefix_len + len * 2);
+	if (payload == NULL)
+		return ERROR_GDB_BUFFER_TOO_SMALL;
+	payload++;
+
+	for (i = 0; i < prefix_len; i++)
+	{
+		*payload++ = prefix[i];
+		my_checksum += prefix[i];
+	}
+
+	my_checksum += buf_hexify(payload, data, len);
+
+	return gdb_put_frame(connection, prefix_len + len * 2, my_checksum);
+}
+
 static __inline__ int fetch_packet(struct connection *connection, int *checksum_ok, int noack, int *len, char *buffer)
 {
 	unsigned char my_checksum = 0;
@@ -713,24 +824,7 @@ static int gdb_get_packet(struct connection *connection, char *buffer, int *len)
 
 static int gdb_output_con(struct connection *connection, const char* line)
 {
-	char *hex_buffer;
-	int i, bin_size;
-
-	bin_size = strlen(line);
-
-	hex_buffer = malloc(bin_size*2 + 2);
-	if (hex_buffer == NULL)
-		return ERROR_GDB_BUFFER_TOO_SMALL;
-
-	hex_buffer[0] = 'O';
-	for (i = 0; i < bin_size; i++)
-		snprintf(hex_buffer + 1 + i*2, 3, "%2.2x", line[i]);
-	hex_buffer[bin_size*2 + 1] = 0;
-
-	int retval = gdb_put_packet(connection, hex_buffer, bin_size*2 + 1);
-
-	free(hex_buffer);
-	return retval;
+	return gdb_put_packet_hex(connection, "O", (const uint8_t *)line, strlen(line));
 }
 
 static int gdb_output(struct command_context *context, const char* line)
@@ -820,9 +914,13 @@ static int gdb_new_connection(struct connection *connection)
 	/* initialize gdb connection information */
 	gdb_connection->buf_p = gdb_connection->buffer;
 	gdb_connection->buf_cnt = 0;
+	gdb_connection->out_buffer = NULL;
+	gdb_connection->out_buffer_size = 0;
+	gdb_connection->scratch = NULL;
+	gdb_connection->scratch_size = 0;
 	gdb_connection->ctrl_c = 0;
 	gdb_connection->frontend_state = TARGET_HALTED;
-	gdb_connection->vflash_image = NULL;
+	gdb_connection->vflash_stream = NULL;
 	gdb_connection->closed = 0;
 	gdb_connection->busy = 0;
 	gdb_connection->noack_mode = 0;
@@ -905,12 +1003,12 @@ static int gdb_connection_closed(struct connection *connection)
 		  target_state_name(gdb_service->target),
 		  gdb_actual_connections);
 
-	/* see if an image built with vFlash commands is left */
-	if (gdb_connection->vflash_image)
+	/* see if a vFlash sequence was left unfinished */
+	if (gdb_connection->vflash_stream)
 	{
-		image_close(gdb_connection->vflash_image);
-		free(gdb_connection->vflash_image);
-		gdb_connection->vflash_image = NULL;
+		flash_write_stream_cleanup(gdb_connection->vflash_stream);
+		free(gdb_connection->vflash_stream);
+		gdb_connection->vflash_stream = NULL;
 	}
 
 	/* if this connection registered a debug-message receiver delete it */
@@ -918,6 +1016,8 @@ static int gdb_connection_closed(struct connection *connection)
 
 	if (connection->priv)
 	{
+		free(gdb_connection->out_buffer);
+		free(gdb_connection->scratch);
 		free(connection->priv);
 		connection->priv = NULL;
 	}
@@ -1056,16 +1156,24 @@ static int gdb_get_registers_packet(struct connection *connection,
 
 	for (i = 0; i < reg_list_size; i++)
 	{
-		reg_packet_size += reg_list[i]->size;
+		reg_packet_size += DIV_ROUND_UP(reg_list[i]->size, 8) * 2;
+		if (!reg_list[i]->valid)
+			reg_list[i]->type->get(reg_list[i]);
 	}
 
-	reg_packet = malloc(DIV_ROUND_UP(reg_packet_size, 8) * 2);
+	/* encode straight into the connection's output buffer; fetch the
+	 * registers first, log output sent to GDB uses that buffer too */
+	reg_packet = gdb_get_out_buffer(connection, reg_packet_size);
+	if (reg_packet == NULL)
+	{
+		free(reg_list);
+		return ERROR_GDB_BUFFER_TOO_SMALL;
+	}
+	reg_packet++;
 	reg_packet_p = reg_packet;
 
 	for (i = 0; i < reg_list_size; i++)
 	{
-		if (!reg_list[i]->valid)
-			reg_list[i]->type->get(reg_list[i]);
 		gdb_str_to_target(target, reg_packet_p, reg_list[i]);
 		reg_packet_p += DIV_ROUND_UP(reg_list[i]->size, 8) * 2;
 	}
@@ -1073,18 +1181,16 @@ static int gdb_get_registers_packet(struct connection *connection,
 #ifdef _DEBUG_GDB_IO_
 	{
 		char *reg_packet_p;
-		reg_packet_p = strndup(reg_packet, DIV_ROUND_UP(reg_packet_size, 8) * 2);
+		reg_packet_p = strndup(reg_packet, reg_packet_size);
 		LOG_DEBUG("reg_packet: %s", reg_packet_p);
 		free(reg_packet_p);
 	}
 #endif
 
-	gdb_put_packet(connection, reg_packet, DIV_ROUND_UP(reg_packet_size, 8) * 2);
-	free(reg_packet);
-
 	free(reg_list);
 
-	return ERROR_OK;
+	return gdb_put_frame(connection, reg_packet_size,
+			gdb_checksum(reg_packet, reg_packet_size));
 }
 
 static int gdb_set_registers_packet(struct connection *connection,
@@ -1126,16 +1232,18 @@ static int gdb_set_registers_packet(struct connection *connection,
 			LOG_ERROR("BUG: register packet is too small for registers");
 		}
 
-		bin_buf = malloc(DIV_ROUND_UP(reg_list[i]->size, 8));
+		bin_buf = gdb_get_scratch(connection, DIV_ROUND_UP(reg_list[i]->size, 8));
+		if (bin_buf == NULL)
+		{
+			free(reg_list);
+			return ERROR_GDB_BUFFER_TOO_SMALL;
+		}
 		gdb_target_to_reg(target, packet_p, chars, bin_buf);
 
 		reg_list[i]->type->set(reg_list[i], bin_buf);
 
 		/* advance packet pointer */
 		packet_p += chars;
-
-
-		free(bin_buf);
 	}
 
 	/* free struct reg *reg_list[] array allocated by get_gdb_reg_list */
@@ -1173,16 +1281,22 @@ static int gdb_get_register_packet(struct connection *connection,
 	if (!reg_list[reg_num]->valid)
 		reg_list[reg_num]->type->get(reg_list[reg_num]);
 
-	reg_packet = malloc(DIV_ROUND_UP(reg_list[reg_num]->size, 8) * 2);
+	int chars = DIV_ROUND_UP(reg_list[reg_num]->size, 8) * 2;
 
-	gdb_str_to_target(target, reg_packet, reg_list[reg_num]);
+	/* encode straight into the connection's output buffer */
+	reg_packet = gdb_get_out_buffer(connection, chars);
+	if (reg_packet == NULL)
+	{
+		free(reg_list);
+		return ERROR_GDB_BUFFER_TOO_SMALL;
+	}
+	reg_packet++;
 
-	gdb_put_packet(connection, reg_packet, DIV_ROUND_UP(reg_list[reg_num]->size, 8) * 2);
+	gdb_str_to_target(target, reg_packet, reg_list[reg_num]);
 
 	free(reg_list);
-	free(reg_packet);
 
-	return ERROR_OK;
+	return gdb_put_frame(connection, chars, gdb_checksum(reg_packet, chars));
 }
 
 static int gdb_set_register_packet(struct connection *connection,
@@ -1215,7 +1329,12 @@ static int gdb_set_register_packet(struct connection *connection,
 	}
 
 	/* convert from GDB-string (target-endian) to hex-string (big-endian) */
-	bin_buf = malloc(DIV_ROUND_UP(reg_list[reg_num]->size, 8));
+	bin_buf = gdb_get_scratch(connection, DIV_ROUND_UP(reg_list[reg_num]->size, 8));
+	if (bin_buf == NULL)
+	{
+		free(reg_list);
+		return ERROR_GDB_BUFFER_TOO_SMALL;
+	}
 	int chars = (DIV_ROUND_UP(reg_list[reg_num]->size, 8) * 2);
 
 	/* fix!!! add some sanity checks on packet size here */
@@ -1226,7 +1345,6 @@ static int gdb_set_register_packet(struct connection *connection,
 
 	gdb_put_packet(connection, "OK", 2);
 
-	free(bin_buf);
 	free(reg_list);
 
 	return ERROR_OK;
@@ -1256,7 +1374,6 @@ static int gdb_read_memory_packet(struct connection *connection,
 	uint32_t len = 0;
 
 	uint8_t *buffer;
-	char *hex_buffer;
 
 	int retval = ERROR_OK;
 
@@ -1273,7 +1390,16 @@ static int gdb_read_memory_packet(struct connection *connection,
 
 	len = strtoul(separator + 1, NULL, 16);
 
-	buffer = malloc(len);
+	/* the reply must fit the PacketSize we advertised */
+	if (len > (GDB_BUFFER_SIZE - 4) / 2)
+	{
+		LOG_ERROR("memory read of 0x%8.8" PRIx32 " bytes is too long", len);
+		return gdb_error(connection, ERROR_GDB_BUFFER_TOO_SMALL);
+	}
+
+	buffer = gdb_get_scratch(connection, len);
+	if (buffer == NULL)
+		return gdb_error(connection, ERROR_GDB_BUFFER_TOO_SMALL);
 
 	LOG_DEBUG("addr: 0x%8.8" PRIx32 ", len: 0x%8.8" PRIx32 "", addr, len);
 
@@ -1299,27 +1425,13 @@ static int gdb_read_memory_packet(struct connection *connection,
 
 	if (retval == ERROR_OK)
 	{
-		hex_buffer = malloc(len * 2 + 1);
-
-		uint32_t i;
-		for (i = 0; i < len; i++)
-		{
-			uint8_t t = buffer[i];
-			hex_buffer[2 * i] = DIGITS[(t >> 4) & 0xf];
-			hex_buffer[2 * i + 1] = DIGITS[t & 0xf];
-		}
-
-		gdb_put_packet(connection, hex_buffer, len * 2);
-
-		free(hex_buffer);
+		retval = gdb_put_packet_hex(connection, NULL, buffer, len);
 	}
 	else
 	{
 		retval = gdb_error(connection, retval);
 	}
 
-	free(buffer);
-
 	return retval;
 }
 
@@ -1354,15 +1466,23 @@ static int gdb_write_memory_packet(struct connection *connection,
 		return ERROR_SERVER_REMOTE_CLOSED;
 	}
 
-	buffer = malloc(len);
+	/* two hex digits per byte, without overflowing 2 * len */
+	if (len > (uint32_t)(packet + packet_size - 1 - separator) / 2)
+	{
+		LOG_ERROR("incomplete write memory packet received, dropping connection");
+		return ERROR_SERVER_REMOTE_CLOSED;
+	}
+
+	buffer = gdb_get_scratch(connection, len);
+	if (buffer == NULL)
+		return gdb_error(connection, ERROR_GDB_BUFFER_TOO_SMALL);
 
 	LOG_DEBUG("addr: 0x%8.8" PRIx32 ", len: 0x%8.8" PRIx32 "", addr, len);
 
 	for (i = 0; i < len; i++)
 	{
-		uint32_t tmp;
-		sscanf(separator + 2*i, "%2" SCNx32 , &tmp);
-		buffer[i] = tmp;
+		buffer[i] = (hextoint(separator[2 * i]) << 4)
+				| hextoint(separator[2 * i + 1]);
 	}
 
 	retval = target_write_buffer(target, addr, len, buffer);
@@ -1376,8 +1496,6 @@ static int gdb_write_memory_packet(struct connection *connection,
 		retval = gdb_error(connection, retval);
 	}
 
-	free(buffer);
-
 	return retval;
 }
 
@@ -2068,17 +2186,31 @@ static int gdb_v_packet(struct connection *connection,
 		}
 		length = packet_size - (parse - packet);
 
-		/* create a new image if there isn't already one */
-		if (gdb_connection->vflash_image == NULL)
+		/* start a new flash write sequence if there isn't already one */
+		if (gdb_connection->vflash_stream == NULL)
 		{
-			gdb_connection->vflash_image = malloc(sizeof(struct image));
-			image_open(gdb_connection->vflash_image, "", "build");
+			gdb_connection->vflash_stream = malloc(sizeof(struct flash_write_stream));
+			flash_write_stream_init(gdb_connection->vflash_stream, gdb_service->target);
+			target_call_event_callbacks(gdb_service->target, TARGET_EVENT_GDB_FLASH_WRITE_START);
 		}
 
-		/* create new section with content from packet buffer */
-		if ((retval = image_add_section(gdb_connection->vflash_image, addr, length, 0x0, (uint8_t*)parse)) != ERROR_OK)
+		/* program whatever complete sectors this packet gives us; the
+		 * tail stays buffered until more data or vFlashDone arrives */
+		retval = flash_write_stream_write(gdb_connection->vflash_stream,
+				addr, (uint8_t*)parse, length);
+		if (retval != ERROR_OK)
 		{
-			return retval;
+			/* abandon the sequence, GDB won't continue it */
+			target_call_event_callbacks(gdb_service->target, TARGET_EVENT_GDB_FLASH_WRITE_END);
+			flash_write_stream_cleanup(gdb_connection->vflash_stream);
+			free(gdb_connection->vflash_stream);
+			gdb_connection->vflash_stream = NULL;
+
+			if (retval == ERROR_FLASH_DST_OUT_OF_BANK)
+				gdb_put_packet(connection, "E.memtype", 9);
+			else
+				gdb_send_error(connection, EIO);
+			return ERROR_OK;
 		}
 
 		gdb_put_packet(connection, "OK", 2);
@@ -2088,29 +2220,28 @@ static int gdb_v_packet(struct connection *connection,
 
 	if (!strcmp(packet, "vFlashDone"))
 	{
-		uint32_t written;
-
-		/* process the flashing buffer. No need to erase as GDB
+		/* program the data still buffered. No need to erase as GDB
 		 * always issues a vFlashErase first. */
-		target_call_event_callbacks(gdb_service->target, TARGET_EVENT_GDB_FLASH_WRITE_START);
-		result = flash_write(gdb_service->target, gdb_connection->vflash_image, &written, 0);
+		if (gdb_connection->vflash_stream == NULL)
+		{
+			gdb_put_packet(connection, "OK", 2);
+			return ERROR_OK;
+		}
+
+		result = flash_write_stream_flush(gdb_connection->vflash_stream);
 		target_call_event_callbacks(gdb_service->target, TARGET_EVENT_GDB_FLASH_WRITE_END);
 		if (result != ERROR_OK)
-		{
-			if (result == ERROR_FLASH_DST_OUT_OF_BANK)
-				gdb_put_packet(connection, "E.memtype", 9);
-			else
-				gdb_send_error(connection, EIO);
-			}
+			gdb_send_error(connection, EIO);
 		else
 		{
-			LOG_DEBUG("wrote %u bytes from vFlash image to flash", (unsigned)written);
+			LOG_DEBUG("wrote %u bytes from vFlash image to flash",
+					(unsigned)gdb_connection->vflash_stream->written);
 			gdb_put_packet(connection, "OK", 2);
 		}
 
-		image_close(gdb_connection->vflash_image);
-		free(gdb_connection->vflash_image);
-		gdb_connection->vflash_image = NULL;
+		flash_write_stream_cleanup(gdb_connection->vflash_stream);
+		free(gdb_connection->vflash_stream);
+		gdb_connection->vflash_stream = NULL;
 
 		return ERROR_OK;
 	}
@@ -33,7 +33,9 @@ struct image;
 struct reg;
 #include <target/target.h>
 
-#define GDB_BUFFER_SIZE	16384
+/* Largest packet exchanged with GDB, advertised as PacketSize in the
+ * qSupported reply; GDB sizes its memory read/write requests by it. */
+#define GDB_BUFFER_SIZE	65536
 
 int gdb_target_add_all(struct target *target);
 int gdb_register_commands(struct command_context *command_context);
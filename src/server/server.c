@@ -39,12 +39,133 @@
 #include <netinet/tcp.h>
 #endif
 
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
 
 static struct service *services = NULL;
 
+/* the connection whose input handler is running, if any */
+static struct connection *input_connection;
+
 /* shutdown_openocd == 1: exit the main event loop, and quit the debugger */
 static int shutdown_openocd = 0;
 
+/* Upper bound for how long server_loop() sleeps when idle. Jim events
+ * (e.g. "after") have no deadline we can query, so don't sleep longer
+ * than the old fixed 100ms. */
+#define SERVER_MAX_IDLE_MS 100
+
+#ifdef HAVE_SYS_EPOLL_H
+/* All listening and connection fds are kept registered here, so the
+ * server loop does not need to rebuild its fd set on every iteration.
+ * If epoll is unavailable or refuses an fd (e.g. stdin redirected from
+ * a regular file), we permanently fall back to select(). */
+static int server_epoll_fd = -1;
+static bool server_epoll_failed = false;
+
+static void server_epoll_disable(void)
+{
+	if (server_epoll_fd != -1)
+		close(server_epoll_fd);
+	server_epoll_fd = -1;
+	server_epoll_failed = true;
+	LOG_DEBUG("epoll unavailable, using select()");
+}
+
+static void server_watch_fd(int fd)
+{
+	if (server_epoll_failed)
+		return;
+
+	if (server_epoll_fd == -1)
+	{
+		server_epoll_fd = epoll_create(16);
+		if (server_epoll_fd == -1)
+		{
+			server_epoll_disable();
+			return;
+		}
+	}
+
+	struct epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = fd;
+
+	/* pipe connections hand their fd back and forth with the service */
+	if ((epoll_ctl(server_epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1)
+			&& (errno != EEXIST))
+		server_epoll_disable();
+}
+
+static void server_unwatch_fd(int fd)
+{
+	if (server_epoll_fd == -1)
+		return;
+
+	struct epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	epoll_ctl(server_epoll_fd, EPOLL_CTL_DEL, fd, &ev);
+}
+
+static inline bool server_using_epoll(void)
+{
+	return server_epoll_fd != -1;
+}
+#else
+static inline bool server_using_epoll(void)
+{
+	return false;
+}
+
+static inline void server_watch_fd(int fd)
+{
+}
+
+static inline void server_unwatch_fd(int fd)
+{
+}
+#endif
+
+/* Wait up to timeout_ms for activity, marking the readable fds in read_fds.
+ * Returns the number of ready fds, 0 on timeout or -1 on error. */
+static int server_wait(fd_set *read_fds, int fd_max, int timeout_ms)
+{
+#ifdef HAVE_SYS_EPOLL_H
+	if (server_epoll_fd != -1)
+	{
+		struct epoll_event events[16];
+		int n = epoll_wait(server_epoll_fd, events, ARRAY_SIZE(events), timeout_ms);
+		if ((n == -1) && (errno != EINTR))
+		{
+			LOG_ERROR("error during epoll_wait: %s", strerror(errno));
+			server_epoll_disable();
+			return 0;
+		}
+
+		for (int i = 0; i < n; i++)
+			FD_SET(events[i].data.fd, read_fds);
+		return n;
+	}
+#endif
+
+	struct timeval tv;
+	tv.tv_sec = timeout_ms / 1000;
+	tv.tv_usec = (timeout_ms % 1000) * 1000;
+	return socket_select(fd_max + 1, read_fds, NULL, NULL, &tv);
+}
+
+/* how long may we sleep before a timer callback is due? */
+static int server_idle_timeout_ms(void)
+{
+	int timeout = target_timer_next_event_ms();
+	if ((timeout < 0) || (timeout > SERVER_MAX_IDLE_MS))
+		timeout = SERVER_MAX_IDLE_MS;
+	return timeout;
+}
+
 static int add_connection(struct service *service, struct command_context *cmd_ctx)
 {
 	socklen_t address_size;
@@ -59,6 +180,7 @@ static int add_connection(struct service *service, struct command_context *cmd_c
 	c->cmd_ctx = copy_command_context(cmd_ctx);
 	c->service = service;
 	c->input_pending = 0;
+	c->interruptible = false;
 	c->priv = NULL;
 	c->next = NULL;
 
@@ -129,6 +251,8 @@ static int add_connection(struct service *service, struct command_context *cmd_c
 		}
 	}
 
+	server_watch_fd(c->fd);
+
 	/* add to the end of linked list */
 	for (p = &service->connections; *p; p = &(*p)->next);
 	*p = c;
@@ -151,11 +275,16 @@ static int remove_connection(struct service *service, struct connection *connect
 			service->connection_closed(c);
 			if (service->type == CONNECTION_TCP)
 			{
+				server_unwatch_fd(c->fd);
 				close_socket(c->fd);
 			} else if (service->type == CONNECTION_PIPE)
 			{
-				/* The service will listen to the pipe again */
+				/* The service will listen to the pipe again, so
+				 * the fd stays registered with the event loop */
 				c->service->fd = c->fd;
+			} else
+			{
+				server_unwatch_fd(c->fd);
 			}
 
 			command_done(c->cmd_ctx);
@@ -289,6 +418,9 @@ int add_service(char *name, const char *port, int max_connections, new_connectio
 #endif
 	}
 
+	if (c->fd != -1)
+		server_watch_fd(c->fd);
+
 	/* add to the end of linked list */
 	for (p = &services; *p; p = &(*p)->next);
 	*p = c;
@@ -308,6 +440,9 @@ static int remove_services(void)
 		if (c->name)
 			free((void *)c->name);
 
+		if (c->fd != -1)
+			server_unwatch_fd(c->fd);
+
 		if (c->type == CONNECTION_PIPE)
 		{
 			if (c->fd != -1)
@@ -328,9 +463,50 @@ static int remove_services(void)
 
 	services = NULL;
 
+#ifdef HAVE_SYS_EPOLL_H
+	if (server_epoll_fd != -1)
+		close(server_epoll_fd);
+	server_epoll_fd = -1;
+#endif
+
 	return ERROR_OK;
 }
 
+/* While a long operation keeps server_loop() from running, keep_alive()
+ * calls this.  If the operation is a command run on behalf of a TCP
+ * connection which sits at a protocol boundary, i.e. it has no further
+ * input buffered (see connection->interruptible), a Ctrl-C (0x03) as
+ * its next input byte asks for the operation to be interrupted.  Other
+ * connections, and anything but a leading Ctrl-C, are left alone; their
+ * input is processed once we are back in server_loop(). */
+void server_keep_alive(void)
+{
+	struct connection *c = input_connection;
+	fd_set read_fds;
+	char ch;
+
+	if ((c == NULL) || !c->interruptible
+			|| (c->service->type != CONNECTION_TCP))
+		return;
+
+	FD_ZERO(&read_fds);
+	FD_SET(c->fd, &read_fds);
+
+	struct timeval tv;
+	tv.tv_sec = 0;
+	tv.tv_usec = 0;
+	if (socket_select(c->fd + 1, &read_fds, NULL, NULL, &tv) <= 0)
+		return;
+
+	if ((recv(c->fd, &ch, 1, MSG_PEEK) != 1) || (ch != 0x03))
+		return;
+
+	/* consume the Ctrl-C */
+	recv(c->fd, &ch, 1, 0);
+	LOG_USER("'%s' connection requested an interrupt", c->service->name);
+	command_interrupt();
+}
+
 int server_loop(struct command_context *command_context)
 {
 	struct service *service;
@@ -351,12 +527,21 @@ int server_loop(struct command_context *command_context)
 
 	while (!shutdown_openocd)
 	{
+		/* an interrupt request only applies to the operation it arrived
+		 * during, we are idle now */
+		command_interrupt_clear();
+
+		/* the log may sit in its buffer while we are busy, not idle */
+		log_flush();
+
 		/* monitor sockets for activity */
 		fd_max = 0;
 		FD_ZERO(&read_fds);
 
-		/* add service and connection fds to read_fds */
-		for (service = services; service; service = service->next)
+		/* add service and connection fds to read_fds, unless they
+		 * are already registered with epoll */
+		for (service = server_using_epoll() ? NULL : services;
+				service; service = service->next)
 		{
 			if (service->fd != -1)
 			{
@@ -381,22 +566,19 @@ int server_loop(struct command_context *command_context)
 			}
 		}
 
-		struct timeval tv;
-		tv.tv_sec = 0;
 		if (poll_ok)
 		{
 			/* we're just polling this iteration, this is faster on embedded
 			 * hosts */
-			tv.tv_usec = 0;
-			retval = socket_select(fd_max + 1, &read_fds, NULL, NULL, &tv);
+			retval = server_wait(&read_fds, fd_max, 0);
 		} else
 		{
-			/* Every 100ms */
-			tv.tv_usec = 100000;
+			/* Sleep until the next timer callback is due */
+			int timeout_ms = server_idle_timeout_ms();
 			/* Only while we're sleeping we'll let others run */
 			openocd_sleep_prelude();
 			kept_alive();
-			retval = socket_select(fd_max + 1, &read_fds, NULL, NULL, &tv);
+			retval = server_wait(&read_fds, fd_max, timeout_ms);
 			openocd_sleep_postlude();
 		}
 
@@ -476,7 +658,11 @@ int server_loop(struct command_context *command_context)
 				{
 					if ((FD_ISSET(c->fd, &read_fds)) || c->input_pending)
 					{
-						if ((retval = service->input(c)) != ERROR_OK)
+						input_connection = c;
+						retval = service->input(c);
+						input_connection = NULL;
+						c->interruptible = false;
+						if (retval != ERROR_OK)
 						{
 							struct connection *next = c->next;
 							if (service->type == CONNECTION_PIPE)
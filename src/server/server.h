@@ -47,6 +47,9 @@ struct connection
 	struct command_context *cmd_ctx;
 	struct service *service;
 	int input_pending;
+	/* set by the input handler while it runs a command with no further
+	 * input of this connection buffered, see server_keep_alive() */
+	bool interruptible;
 	void *priv;
 	struct connection *next;
 };
@@ -83,6 +86,13 @@ int server_quit(void);
 
 int server_loop(struct command_context *command_context);
 
+/**
+ * Called by keep_alive() to notice interrupt requests.  Only the
+ * connection whose command is running, and only while it is marked
+ * interruptible, is looked at.
+ */
+void server_keep_alive(void);
+
 int server_register_commands(struct command_context *context);
 
 int connection_write(struct connection *connection, const void *data, int len);
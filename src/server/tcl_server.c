@@ -23,16 +23,52 @@
 #endif
 
 #include "tcl_server.h"
+#include <target/target.h>
 
 
 #define TCL_SERVER_VERSION	"TCL Server 0.1"
 #define TCL_MAX_LINE		(4096)
 
+/* Besides 0x1a terminated Tcl text, a client may send binary frames.
+ * A frame starts with a zero byte where a line would start, and has a
+ * 12 byte header, all numbers little endian:
+ *
+ *   u8 0x00, u8 op, u8 status, u8 reserved, u32 tag, u32 payload length
+ *
+ * followed by the payload.  Every request frame is answered, in order,
+ * with a frame holding the same op and tag, and a status which is zero
+ * on success; on failure the payload is an error message.  So clients
+ * can pipeline requests, and memory moves as raw bytes.
+ */
+#define TCL_FRAME_MAGIC			0x00
+#define TCL_FRAME_HEADER_SIZE	12
+#define TCL_FRAME_MAX_PAYLOAD	(16 * 1024 * 1024)
+
+enum tcl_frame_op {
+	/* payload: script; reply: its result */
+	TCL_FRAME_EVAL = 1,
+	/* payload: u32 address, u32 count; reply: count bytes of memory */
+	TCL_FRAME_READ_MEMORY = 2,
+	/* payload: u32 address, data bytes; reply: empty */
+	TCL_FRAME_WRITE_MEMORY = 3,
+};
+
 struct tcl_connection {
 	int tc_linedrop;
 	int tc_lineoffset;
 	char tc_line[TCL_MAX_LINE];
 	int tc_outerror; /* flag an output error */
+
+	/* binary frames have been used, see tcl_input() */
+	bool tc_framed;
+	/* binary frame being received */
+	bool tc_inframe;
+	int tc_headeroffset;
+	uint8_t tc_header[TCL_FRAME_HEADER_SIZE];
+	uint32_t tc_payloadlen;
+	uint32_t tc_payloadoffset;
+	uint8_t *tc_payload;
+	uint32_t tc_payloadsize;	/* allocated size of tc_payload */
 };
 
 static const char *tcl_port;
@@ -81,6 +117,175 @@ static int tcl_new_connection(struct connection *connection)
 	return ERROR_OK;
 }
 
+static int tcl_output_frame(struct connection *connection,
+		const uint8_t *request, uint8_t status, const void *data, uint32_t len)
+{
+	uint8_t header[TCL_FRAME_HEADER_SIZE];
+	int retval;
+
+	memcpy(header, request, TCL_FRAME_HEADER_SIZE);
+	header[2] = status;
+	header[3] = 0;
+	h_u32_to_le(header + 8, len);
+
+	retval = tcl_output(connection, header, sizeof(header));
+	if ((retval != ERROR_OK) || (len == 0))
+		return retval;
+	return tcl_output(connection, data, len);
+}
+
+static int tcl_output_frame_error(struct connection *connection,
+		const uint8_t *request, const char *msg)
+{
+	return tcl_output_frame(connection, request, 1, msg, strlen(msg));
+}
+
+static int tcl_frame_memory(struct connection *connection)
+{
+	struct tcl_connection *tclc = connection->priv;
+	uint8_t *payload = tclc->tc_payload;
+	uint32_t address;
+	uint32_t count;
+	int retval;
+
+	if (all_targets == NULL)
+		return tcl_output_frame_error(connection, tclc->tc_header,
+				"no target");
+	struct target *target = get_current_target(connection->cmd_ctx);
+
+	if (tclc->tc_header[1] == TCL_FRAME_WRITE_MEMORY)
+	{
+		if (tclc->tc_payloadlen < 4)
+			return tcl_output_frame_error(connection, tclc->tc_header,
+					"write_memory: payload too short");
+
+		address = le_to_h_u32(payload);
+		count = tclc->tc_payloadlen - 4;
+		retval = target_write_buffer(target, address, count, payload + 4);
+		if (retval != ERROR_OK)
+			return tcl_output_frame_error(connection, tclc->tc_header,
+					"write_memory: failed");
+		return tcl_output_frame(connection, tclc->tc_header, 0, NULL, 0);
+	}
+
+	if (tclc->tc_payloadlen != 8)
+		return tcl_output_frame_error(connection, tclc->tc_header,
+				"read_memory: payload must be address and count");
+
+	address = le_to_h_u32(payload);
+	count = le_to_h_u32(payload + 4);
+	if (count > TCL_FRAME_MAX_PAYLOAD)
+		return tcl_output_frame_error(connection, tclc->tc_header,
+				"read_memory: count too large");
+
+	uint8_t *buffer = malloc(count ? count : 1);
+	if (buffer == NULL)
+		return tcl_output_frame_error(connection, tclc->tc_header,
+				"read_memory: out of memory");
+
+	retval = target_read_buffer(target, address, count, buffer);
+	if (retval != ERROR_OK)
+		retval = tcl_output_frame_error(connection, tclc->tc_header,
+				"read_memory: failed");
+	else
+		retval = tcl_output_frame(connection, tclc->tc_header, 0,
+				buffer, count);
+
+	free(buffer);
+	return retval;
+}
+
+/* execute the binary frame which has just been received */
+static int tcl_frame(struct connection *connection)
+{
+	Jim_Interp *interp = (Jim_Interp *)connection->cmd_ctx->interp;
+	struct tcl_connection *tclc = connection->priv;
+	const char *result;
+	int reslen;
+	int retval;
+
+	switch (tclc->tc_header[1])
+	{
+	case TCL_FRAME_EVAL:
+		/* there is always room for the terminator, see tcl_input() */
+		tclc->tc_payload[tclc->tc_payloadlen] = '\0';
+		LOG_DEBUG("Executing script:\n %s", tclc->tc_payload);
+		retval = Jim_Eval_Named(interp, (char *)tclc->tc_payload,
+				"remote:connection", 1);
+		result = Jim_GetString(Jim_GetResult(interp), &reslen);
+		return tcl_output_frame(connection, tclc->tc_header,
+				retval, result, reslen);
+
+	case TCL_FRAME_READ_MEMORY:
+	case TCL_FRAME_WRITE_MEMORY:
+		return tcl_frame_memory(connection);
+
+	default:
+		return tcl_output_frame_error(connection, tclc->tc_header,
+				"unknown request");
+	}
+}
+
+/* Consume up to len bytes of a binary frame; returns how many were used,
+ * or a negative error code. */
+static int tcl_frame_input(struct connection *connection,
+		const unsigned char *in, int len)
+{
+	struct tcl_connection *tclc = connection->priv;
+	int used = 0;
+	int retval;
+
+	if (tclc->tc_headeroffset < TCL_FRAME_HEADER_SIZE)
+	{
+		used = TCL_FRAME_HEADER_SIZE - tclc->tc_headeroffset;
+		if (used > len)
+			used = len;
+		memcpy(tclc->tc_header + tclc->tc_headeroffset, in, used);
+		tclc->tc_headeroffset += used;
+		if (tclc->tc_headeroffset < TCL_FRAME_HEADER_SIZE)
+			return used;
+
+		tclc->tc_payloadlen = le_to_h_u32(tclc->tc_header + 8);
+		tclc->tc_payloadoffset = 0;
+		if (tclc->tc_payloadlen > TCL_FRAME_MAX_PAYLOAD)
+		{
+			LOG_ERROR("tcl frame too large: %u bytes",
+					(unsigned)tclc->tc_payloadlen);
+			return ERROR_SERVER_REMOTE_CLOSED;
+		}
+
+		/* leave room to terminate a script */
+		if (tclc->tc_payloadsize < tclc->tc_payloadlen + 1)
+		{
+			free(tclc->tc_payload);
+			tclc->tc_payloadsize = tclc->tc_payloadlen + 1;
+			tclc->tc_payload = malloc(tclc->tc_payloadsize);
+			if (tclc->tc_payload == NULL)
+			{
+				tclc->tc_payloadsize = 0;
+				return ERROR_SERVER_REMOTE_CLOSED;
+			}
+		}
+	}
+
+	uint32_t chunk = tclc->tc_payloadlen - tclc->tc_payloadoffset;
+	if (chunk > (uint32_t)(len - used))
+		chunk = len - used;
+	memcpy(tclc->tc_payload + tclc->tc_payloadoffset, in + used, chunk);
+	tclc->tc_payloadoffset += chunk;
+	used += chunk;
+
+	if (tclc->tc_payloadoffset < tclc->tc_payloadlen)
+		return used;
+
+	tclc->tc_inframe = false;
+	retval = tcl_frame(connection);
+	if (retval != ERROR_OK)
+		return retval;
+
+	return used;
+}
+
 static int tcl_input(struct connection *connection)
 {
 	Jim_Interp *interp = (Jim_Interp *)connection->cmd_ctx->interp;
@@ -90,7 +295,7 @@ static int tcl_input(struct connection *connection)
 	const char *result;
 	int reslen;
 	struct tcl_connection *tclc;
-	unsigned char in[256];
+	unsigned char in[4096];
 
 	rlen = connection_read(connection, &in, sizeof(in));
 	if (rlen <= 0) {
@@ -106,6 +311,23 @@ static int tcl_input(struct connection *connection)
 	/* push as much data into the line as possible */
 	for (i = 0; i < rlen; i++)
 	{
+		/* a zero byte at the start of a line starts a binary frame */
+		if (!tclc->tc_inframe && (tclc->tc_lineoffset == 0)
+				&& (in[i] == TCL_FRAME_MAGIC))
+		{
+			tclc->tc_framed = true;
+			tclc->tc_inframe = true;
+			tclc->tc_headeroffset = 0;
+		}
+		if (tclc->tc_inframe)
+		{
+			retval = tcl_frame_input(connection, in + i, rlen - i);
+			if (retval < 0)
+				return retval;
+			i += retval - 1;
+			continue;
+		}
+
 		/* buffer the data */
 		tclc->tc_line[tclc->tc_lineoffset] = in[i];
 		if (tclc->tc_lineoffset < TCL_MAX_LINE)
@@ -131,7 +353,12 @@ static int tcl_input(struct connection *connection)
 		else {
 			tclc->tc_line[tclc->tc_lineoffset-1] = '\0';
 			LOG_DEBUG("Executing script:\n %s", tclc->tc_line);
+			/* A Ctrl-C may interrupt the script if it is the next
+			 * command's first byte; clients which use binary frames,
+			 * whose payload may hold that byte, can't do this. */
+			connection->interruptible = !tclc->tc_framed && (i == rlen - 1);
 			retval = Jim_Eval_Named(interp, tclc->tc_line, "remote:connection",1);
+			connection->interruptible = false;
 			LOG_DEBUG("Result: %d\n %s", retval, Jim_GetString(Jim_GetResult(interp), &reslen));
 			result = Jim_GetString(Jim_GetResult(interp), &reslen);
 			retval = tcl_output(connection, result, reslen);
@@ -152,6 +379,8 @@ static int tcl_closed(struct connection *connection)
 {
 	/* cleanup connection context */
 	if (connection->priv) {
+		struct tcl_connection *tclc = connection->priv;
+		free(tclc->tc_payload);
 		free(connection->priv);
 		connection->priv = NULL;
 	}
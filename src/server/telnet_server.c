@@ -328,7 +328,11 @@ static int telnet_input(struct connection *connection)
 
 							t_con->line_cursor = -1; /* to supress prompt in log callback during command execution */
 
+							/* Ctrl-C may interrupt the command unless more
+							 * input was typed ahead of it */
+							connection->interruptible = (bytes_read == 1);
 							retval = command_run_line(command_context, t_con->line);
+							connection->interruptible = false;
 
 							t_con->line_cursor = 0;
 
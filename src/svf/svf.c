@@ -33,6 +33,7 @@
 
 #include <jtag/jtag.h>
 #include "svf.h"
+#include <helper/fileio.h>
 #include <helper/time_support.h>
 
 
@@ -141,6 +142,15 @@ static const struct svf_statemove svf_statemoves[] =
 #define XXR_TDO						(1 << 1)
 #define XXR_MASK					(1 << 2)
 #define XXR_SMASK					(1 << 3)
+
+static const char *svf_xxr_para_name[4] =
+{
+	"TDI",
+	"TDO",
+	"MASK",
+	"SMASK"
+};
+
 struct svf_xxr_para
 {
 	int len;
@@ -202,26 +212,64 @@ struct svf_check_tdo_para
 	int bit_len;		// bit length to check
 };
 
-#define SVF_CHECK_TDO_PARA_SIZE	1024
+// TDO checks are deferred until this many are pending, or the
+// buffers are half full, or a command needs the queue flushed
+#define SVF_CHECK_TDO_PARA_SIZE	(16 * 1024)
 static struct svf_check_tdo_para *svf_check_tdo_para = NULL;
 static int svf_check_tdo_para_index = 0;
 
-static int svf_read_command_from_file(FILE * fd);
+/* An SVF file is compiled into a program before anything runs: one
+ * pass over the file collects the commands, and scan data is decoded
+ * from hex right away.  Running an SDR or SIR then only copies bytes.
+ */
+struct svf_insn
+{
+	int line_num;			// line where the command ends
+	svf_command_t command;
+	const char *echo;		// line to log when running the command,
+	int echo_len;			// NULL if an earlier command logged it
+	size_t text;			// offset of the command text, if not XXR
+	// HDR, HIR, SDR, SIR, TDR, TIR
+	int len;
+	int data_mask;			// XXR_* values given
+	size_t value[4];		// their offsets in the program data
+};
+
+struct svf_program
+{
+	struct svf_insn *insns;
+	int num_insns;
+	int max_insns;
+	uint8_t *data;
+	size_t data_size;
+	size_t data_max;
+	char *text;
+	size_t text_size;
+	size_t text_max;
+	int num_lines;
+};
+
+static int svf_compile(struct svf_program *program, const char *file, size_t size);
+static void svf_free_program(struct svf_program *program);
 static int svf_check_tdo(void);
+static int svf_execute_tap(void);
 static int svf_add_check_para(uint8_t enabled, int buffer_offset, int bit_len);
-static int svf_run_command(struct command_context *cmd_ctx, char *cmd_str);
+static int svf_run_command(struct command_context *cmd_ctx,
+		struct svf_program *program, struct svf_insn *insn);
 
-static FILE * svf_fd = NULL;
-static char * svf_read_line = NULL;
-static size_t svf_read_line_size = 0;
-static char *svf_command_buffer = NULL;
-static size_t svf_command_buffer_size = 0;
+static struct fileio svf_fileio;
+static int svf_file_open = 0;
+static char *svf_file_copy = NULL;
+static struct svf_program svf_program;
 static int svf_line_number = 1;
-static int svf_getline (char **lineptr, size_t *n, FILE *stream);
+// first line with commands that are still in the JTAG queue
+static int svf_queue_first_line = 0;
 
 #define SVF_MAX_BUFFER_SIZE_TO_COMMIT	(1024 * 1024)
 static uint8_t *svf_tdi_buffer = NULL, *svf_tdo_buffer = NULL, *svf_mask_buffer = NULL;
 static int svf_buffer_index = 0, svf_buffer_size = 0;
+// bytes of scans without TDO check which are only in the JTAG queue
+static int svf_queued_bytes = 0;
 static int svf_quiet = 0;
 static int svf_nil = 0;
 
@@ -366,20 +414,27 @@ COMMAND_HANDLER(handle_svf_command)
 		{
 			svf_progress_enabled = 1;
 		}
-		else if ((svf_fd = fopen(CMD_ARGV[i], "r")) == NULL)
+		else if (svf_file_open)
 		{
-			int err = errno;
-			command_print(CMD_CTX, "open(\"%s\"): %s", CMD_ARGV[i], strerror(err));
+			// only one file at a time
+			fileio_close(&svf_fileio);
+			svf_file_open = 0;
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		}
+		else if (ERROR_OK != fileio_open(&svf_fileio, CMD_ARGV[i], FILEIO_READ, FILEIO_BINARY))
+		{
+			command_print(CMD_CTX, "can't open \"%s\"", CMD_ARGV[i]);
 			// no need to free anything now
 			return ERROR_COMMAND_SYNTAX_ERROR;
 		}
 		else
 		{
+			svf_file_open = 1;
 			LOG_USER("svf processing file: \"%s\"", CMD_ARGV[i]);
 		}
 	}
 
-	if (svf_fd == NULL)
+	if (!svf_file_open)
 	{
 		return ERROR_COMMAND_SYNTAX_ERROR;
 	}
@@ -389,7 +444,7 @@ COMMAND_HANDLER(handle_svf_command)
 
 	// init
 	svf_line_number = 1;
-	svf_command_buffer_size = 0;
+	svf_queue_first_line = 0;
 
 	svf_check_tdo_para_index = 0;
 	svf_check_tdo_para = malloc(sizeof(struct svf_check_tdo_para) * SVF_CHECK_TDO_PARA_SIZE);
@@ -401,6 +456,7 @@ COMMAND_HANDLER(handle_svf_command)
 	}
 
 	svf_buffer_index = 0;
+	svf_queued_bytes = 0;
 	// double the buffer size
 	// in case current command cannot be committed, and next command is a bit scan command
 	// here is 32K bits for this big scan command, it should be enough
@@ -489,18 +545,45 @@ COMMAND_HANDLER(handle_svf_command)
 
 	}
 
-	if (svf_progress_enabled)
+	// compile the whole file first; the program refers to its lines
+	const uint8_t *file;
+	int file_size;
+	if (ERROR_OK != fileio_size(&svf_fileio, &file_size))
+	{
+		ret = ERROR_FAIL;
+		goto free_all;
+	}
+	if (ERROR_OK != fileio_map(&svf_fileio, &file))
+	{
+		size_t read_bytes;
+
+		svf_file_copy = malloc(file_size + 1);
+		if (NULL == svf_file_copy)
+		{
+			LOG_ERROR("not enough memory");
+			ret = ERROR_FAIL;
+			goto free_all;
+		}
+		if (ERROR_OK != fileio_read(&svf_fileio, file_size, svf_file_copy, &read_bytes))
+		{
+			ret = ERROR_FAIL;
+			goto free_all;
+		}
+		file_size = read_bytes;
+		file = (const uint8_t *)svf_file_copy;
+	}
+	if (ERROR_OK != svf_compile(&svf_program, (const char *)file, file_size))
 	{
-		// Count total lines in file.
-		while ( ! feof (svf_fd) )
-		 {
-		   svf_getline (&svf_command_buffer, &svf_command_buffer_size, svf_fd);
-		   svf_total_lines++;
-		 }
-		rewind(svf_fd);
+		ret = ERROR_FAIL;
+		goto free_all;
 	}
-	while (ERROR_OK == svf_read_command_from_file(svf_fd))
+	svf_total_lines = svf_program.num_lines;
+
+	for (int insn_num = 0; insn_num < svf_program.num_insns; insn_num++)
 	{
+		struct svf_insn *insn = &svf_program.insns[insn_num];
+
+		svf_line_number = insn->line_num;
 		// Log Output
 		if (svf_quiet)
 		{
@@ -516,18 +599,22 @@ COMMAND_HANDLER(handle_svf_command)
 		}
 		else
 		{
-			if (svf_progress_enabled)
+			if (NULL == insn->echo)
+			{
+				// line logged with an earlier command
+			}
+			else if (svf_progress_enabled)
 			{
 				svf_percentage = ((svf_line_number * 20) / svf_total_lines) * 5;
-				LOG_USER_N("%3d%%  %s", svf_percentage, svf_read_line);
+				LOG_USER_N("%3d%%  %.*s", svf_percentage, insn->echo_len, insn->echo);
 			}
 			else
 			{
-				LOG_USER_N("%s",svf_read_line);
+				LOG_USER_N("%.*s", insn->echo_len, insn->echo);
 			}
 		}
 			// Run Command
-		if (ERROR_OK != svf_run_command(CMD_CTX, svf_command_buffer))
+		if (ERROR_OK != svf_run_command(CMD_CTX, &svf_program, insn))
 		{
 			LOG_ERROR("fail to run command at line %d", svf_line_number);
 			ret = ERROR_FAIL;
@@ -536,11 +623,7 @@ COMMAND_HANDLER(handle_svf_command)
 		command_num++;
 	}
 
-	if ((!svf_nil) && (ERROR_OK != jtag_execute_queue()))
-	{
-		ret = ERROR_FAIL;
-	}
-	else if (ERROR_OK != svf_check_tdo())
+	if (ERROR_OK != svf_execute_tap())
 	{
 		ret = ERROR_FAIL;
 	}
@@ -558,16 +641,16 @@ COMMAND_HANDLER(handle_svf_command)
 
 free_all:
 
-	fclose(svf_fd);
-	svf_fd = 0;
+	fileio_close(&svf_fileio);
+	svf_file_open = 0;
 
 	// free buffers
-	if (svf_command_buffer)
+	if (svf_file_copy)
 	{
-		free(svf_command_buffer);
-		svf_command_buffer = NULL;
-		svf_command_buffer_size = 0;
+		free(svf_file_copy);
+		svf_file_copy = NULL;
 	}
+	svf_free_program(&svf_program);
 	if (svf_check_tdo_para)
 	{
 		free(svf_check_tdo_para);
@@ -591,6 +674,7 @@ free_all:
 	}
 	svf_buffer_index = 0;
 	svf_buffer_size = 0;
+	svf_queued_bytes = 0;
 
 	svf_free_xxd_para(&svf_para.hdr_para);
 	svf_free_xxd_para(&svf_para.hir_para);
@@ -611,145 +695,6 @@ free_all:
 	return ret;
 }
 
-static int svf_getline (char **lineptr, size_t *n, FILE *stream)
-{
-#define MIN_CHUNK 16	//Buffer is increased by this size each time as required
-  size_t i = 0;
-
-  if (*lineptr == NULL)
-    {
-      *n = MIN_CHUNK;
-      *lineptr = (char *)malloc (*n);
-      if (!*lineptr)
-        {
-		  return -1;
-        }
-    }
-
-	(*lineptr)[0] = fgetc(stream);
-	while ((*lineptr)[i] != '\n')
-	{
-		(*lineptr)[++i] = fgetc(stream);
-		if (feof(stream))
-		{
-			(*lineptr)[0] = 0;
-			return -1;
-		}
-		if ((i + 2) > *n)
-		{
-			*n += MIN_CHUNK;
-			*lineptr = realloc(*lineptr, *n);
-		}
-	}
-
-	(*lineptr)[++i] = 0;
-
-	return sizeof(*lineptr);
-}
-
-#define SVFP_CMD_INC_CNT			1024
-static int svf_read_command_from_file(FILE * fd)
-{
-	unsigned char ch;
-	int i = 0;
-	size_t cmd_pos = 0;
-	int cmd_ok = 0, slash = 0;
-
-	if (svf_getline (&svf_read_line, &svf_read_line_size, svf_fd) <= 0)
-	{
-		return ERROR_FAIL;
-	}
-	svf_line_number++;
-	ch = svf_read_line[0];
-	while (!cmd_ok && (ch != 0))
-	{
-		switch (ch)
-		{
-		case '!':
-			slash = 0;
-			if (svf_getline (&svf_read_line, &svf_read_line_size, svf_fd) <= 0)
-			{
-				return ERROR_FAIL;
-			}
-			svf_line_number++;
-			i = -1;
-			break;
-		case '/':
-			if (++slash == 2)
-			{
-				slash = 0;
-				if (svf_getline (&svf_read_line, &svf_read_line_size, svf_fd) <= 0)
-				{
-					return ERROR_FAIL;
-				}
-				svf_line_number++;
-				i = -1;
-			}
-			break;
-		case ';':
-			slash = 0;
-			cmd_ok = 1;
-			break;
-		case '\n':
-			svf_line_number++;
-			if (svf_getline (&svf_read_line, &svf_read_line_size, svf_fd) <= 0)
-			{
-				return ERROR_FAIL;
-			}
-			i = -1;
-		case '\r':
-			slash = 0;
-			/* Don't save '\r' and '\n' if no data is parsed */
-			if (!cmd_pos)
-				break;
-		default:
-			/* The parsing code currently expects a space
-			 * before parentheses -- "TDI (123)".  Also a
-			 * space afterwards -- "TDI (123) TDO(456)".
-			 * But such spaces are optional... instead of
-			 * parser updates, cope with that by adding the
-			 * spaces as needed.
-			 *
-			 * Ensure there are 3 bytes available, for:
-			 *  - current character
-			 *  - added space.
-			 *  - terminating NUL ('\0')
-			 */
-			if ((cmd_pos + 2) >= svf_command_buffer_size)
-			{
-				svf_command_buffer = realloc(svf_command_buffer, (cmd_pos + 2));
-				if (svf_command_buffer == NULL)
-				{
-					LOG_ERROR("not enough memory");
-					return ERROR_FAIL;
-				}
-			}
-
-			/* insert a space before '(' */
-			if ('(' == ch)
-				svf_command_buffer[cmd_pos++] = ' ';
-
-			svf_command_buffer[cmd_pos++] = (char)toupper(ch);
-
-			/* insert a space after ')' */
-			if (')' == ch)
-				svf_command_buffer[cmd_pos++] = ' ';
-			break;
-		}
-		ch = svf_read_line[++i];
-	}
-
-	if (cmd_ok)
-	{
-		svf_command_buffer[cmd_pos] = '\0';
-		return ERROR_OK;
-	}
-	else
-	{
-		return ERROR_FAIL;
-	}
-}
-
 static int svf_parse_cmd_string(char *str, int len, char **argus, int *num_of_argu)
 {
 	int pos = 0, num = 0, space_found = 1, in_bracket = 0;
@@ -845,16 +790,18 @@ static int svf_set_padding(struct svf_xxr_para *para, int len, unsigned char tdi
 	return error;
 }
 
-static int svf_copy_hexstring_to_binary(char *str, uint8_t **bin, int orig_bit_len, int bit_len)
+/* hex digit values plus one; text reaching here is already uppercase */
+static const uint8_t svf_hex_digit[256] =
 {
-	int i, str_len = strlen(str), str_hbyte_len = (bit_len + 3) >> 2;
-	uint8_t ch = 0;
+	['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5,
+	['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+	['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+};
 
-	if (ERROR_OK != svf_adjust_array_length(bin, orig_bit_len, bit_len))
-	{
-		LOG_ERROR("fail to adjust length of array");
-		return ERROR_FAIL;
-	}
+static int svf_decode_hex(const char *str, int str_len, uint8_t *bin, int bit_len)
+{
+	int i, str_hbyte_len = (bit_len + 3) >> 2;
+	uint8_t ch = 0;
 
 	/* fill from LSB (end of str) to MSB (beginning of str) */
 	for (i = 0; i < str_hbyte_len; i++)
@@ -862,7 +809,14 @@ static int svf_copy_hexstring_to_binary(char *str, uint8_t **bin, int orig_bit_l
 		ch = 0;
 		while (str_len > 0)
 		{
-			ch = str[--str_len];
+			uint8_t c = str[--str_len];
+			uint8_t digit = svf_hex_digit[c];
+
+			if (digit)
+			{
+				ch = digit - 1;
+				break;
+			}
 
 			/* Skip whitespace.  The SVF specification (rev E) is
 			 * deficient in terms of basic lexical issues like
@@ -870,39 +824,23 @@ static int svf_copy_hexstring_to_binary(char *str, uint8_t **bin, int orig_bit_l
 			 * require line ends for correctness, since there is
 			 * a hard limit on line length.
 			 */
-			if (!isspace(ch))
+			if (!isspace(c))
 			{
-				if ((ch >= '0') && (ch <= '9'))
-				{
-					ch = ch - '0';
-					break;
-				}
-				else if ((ch >= 'A') && (ch <= 'F'))
-				{
-					ch = ch - 'A' + 10;
-					break;
-				}
-				else
-				{
-					LOG_ERROR("invalid hex string");
-					return ERROR_FAIL;
-				}
+				LOG_ERROR("invalid hex string");
+				return ERROR_FAIL;
 			}
-
-			ch = 0;
 		}
 
 		// write bin
 		if (i % 2)
 		{
 			// MSB
-			(*bin)[i / 2] |= ch << 4;
+			bin[i / 2] |= ch << 4;
 		}
 		else
 		{
 			// LSB
-			(*bin)[i / 2] = 0;
-			(*bin)[i / 2] |= ch;
+			bin[i / 2] = ch;
 		}
 	}
 
@@ -921,6 +859,290 @@ static int svf_copy_hexstring_to_binary(char *str, uint8_t **bin, int orig_bit_l
 	return ERROR_OK;
 }
 
+#define SVFP_CMD_INC_CNT			1024
+static int svf_program_add_insn(struct svf_program *program, struct svf_insn **insn)
+{
+	if (program->num_insns == program->max_insns)
+	{
+		int max_insns = program->max_insns ? program->max_insns * 2 : SVFP_CMD_INC_CNT;
+		struct svf_insn *insns = realloc(program->insns, max_insns * sizeof(*insns));
+		if (NULL == insns)
+		{
+			LOG_ERROR("not enough memory");
+			return ERROR_FAIL;
+		}
+		program->insns = insns;
+		program->max_insns = max_insns;
+	}
+
+	*insn = &program->insns[program->num_insns++];
+	memset(*insn, 0, sizeof(**insn));
+	return ERROR_OK;
+}
+
+// reserve size bytes at the end of a program's data or text
+static int svf_program_reserve(void *area, size_t *used, size_t *max, size_t size)
+{
+	uint8_t **buffer = area;
+
+	if (*used + size > *max)
+	{
+		size_t new_max = *max ? *max : 64 * 1024;
+		uint8_t *new_buffer;
+
+		while (*used + size > new_max)
+			new_max *= 2;
+		new_buffer = realloc(*buffer, new_max);
+		if (NULL == new_buffer)
+		{
+			LOG_ERROR("not enough memory");
+			return ERROR_FAIL;
+		}
+		*buffer = new_buffer;
+		*max = new_max;
+	}
+
+	return ERROR_OK;
+}
+
+// XXR length [TDI (tdi)] [TDO (tdo)] [MASK (mask)] [SMASK (smask)]
+static int svf_compile_xxr(struct svf_program *program, struct svf_insn *insn,
+		char **argus, int num_of_argu)
+{
+	int i, j;
+
+	if ((num_of_argu > 10) || (num_of_argu % 2))
+	{
+		LOG_ERROR("invalid parameter of %s", argus[0]);
+		return ERROR_FAIL;
+	}
+	insn->len = atoi(argus[1]);
+	insn->data_mask = 0;
+	for (i = 2; i < num_of_argu; i += 2)
+	{
+		int arg_len = strlen(argus[i + 1]);
+		int byte_len = (insn->len + 7) >> 3;
+
+		if ((arg_len < 3) || (argus[i + 1][0] != '(') || (argus[i + 1][arg_len - 1] != ')'))
+		{
+			LOG_ERROR("data section error");
+			return ERROR_FAIL;
+		}
+		// TDI, TDO, MASK, SMASK
+		for (j = 0; j < 4; j++)
+		{
+			if (!strcmp(argus[i], svf_xxr_para_name[j]))
+				break;
+		}
+		if (j == 4)
+		{
+			LOG_ERROR("unknow parameter: %s", argus[i]);
+			return ERROR_FAIL;
+		}
+
+		if (ERROR_OK != svf_program_reserve(&program->data,
+				&program->data_size, &program->data_max, byte_len))
+		{
+			return ERROR_FAIL;
+		}
+		if (ERROR_OK != svf_decode_hex(&argus[i + 1][1], arg_len - 2,
+				program->data + program->data_size, insn->len))
+		{
+			LOG_ERROR("fail to parse hex value");
+			return ERROR_FAIL;
+		}
+		insn->data_mask |= 1 << j;
+		insn->value[j] = program->data_size;
+		program->data_size += byte_len;
+	}
+
+	return ERROR_OK;
+}
+
+// compile one command, as collected by svf_compile()
+static int svf_compile_command(struct svf_program *program, char *cmd_str, int len,
+		int line_num, const char *line, const char *end, const char **echoed)
+{
+	char *argus[256];
+	int num_of_argu = 0;
+	struct svf_insn *insn;
+	int command;
+	int i;
+
+	// the command name decides whether the rest gets compiled
+	for (i = 0; (i < len) && isspace((int) cmd_str[i]); i++)
+		;
+	if (i == len)
+	{
+		// empty command
+		return ERROR_OK;
+	}
+	int name_len = strcspn(&cmd_str[i], " \t\n\r\f\v");
+	for (command = 0; command < (int)ARRAY_SIZE(svf_command_name); command++)
+	{
+		if (((int)strlen(svf_command_name[command]) == name_len)
+				&& !strncmp(&cmd_str[i], svf_command_name[command], name_len))
+			break;
+	}
+
+	if (ERROR_OK != svf_program_add_insn(program, &insn))
+	{
+		return ERROR_FAIL;
+	}
+	insn->line_num = line_num;
+	insn->command = command;
+
+	// log each line once, even if it holds several commands
+	if (*echoed != line)
+	{
+		const char *eol = memchr(line, '\n', end - line);
+		insn->echo = line;
+		insn->echo_len = eol ? (eol - line + 1) : (end - line);
+		*echoed = line;
+	}
+
+	switch (command)
+	{
+	case HDR:
+	case HIR:
+	case TDR:
+	case TIR:
+		// skipped, so not checked either, when targetting a tap
+		if (svf_tap_is_specified)
+			return ERROR_OK;
+		/* fall through */
+	case SDR:
+	case SIR:
+		if (ERROR_OK != svf_parse_cmd_string(cmd_str, len, argus, &num_of_argu))
+		{
+			return ERROR_FAIL;
+		}
+		return svf_compile_xxr(program, insn, argus, num_of_argu);
+	default:
+		// everything else runs from its text
+		if (ERROR_OK != svf_program_reserve(&program->text,
+				&program->text_size, &program->text_max, len + 1))
+		{
+			return ERROR_FAIL;
+		}
+		insn->text = program->text_size;
+		memcpy(program->text + program->text_size, cmd_str, len + 1);
+		program->text_size += len + 1;
+		return ERROR_OK;
+	}
+}
+
+/* Compile a whole SVF file.  This collects commands exactly the way
+ * commands used to be read line by line: comments are dropped, text is
+ * uppercased, and spaces are put around parentheses.
+ */
+static int svf_compile(struct svf_program *program, const char *file, size_t size)
+{
+	const char *end = file + size;
+	const char *p = file;
+	const char *line = file;
+	const char *echoed = NULL;
+	int line_num = 1;
+	char *cmd = NULL;
+	size_t cmd_pos = 0, cmd_size = 0;
+	int slash = 0;
+	int ret = ERROR_OK;
+
+	memset(program, 0, sizeof(*program));
+
+	while ((ERROR_OK == ret) && (p < end))
+	{
+		char ch = *p++;
+
+		switch (ch)
+		{
+		case '!':
+			slash = 0;
+			// comment to the end of the line
+			p = memchr(p, '\n', end - p);
+			if (p == NULL)
+				p = end;
+			break;
+		case '/':
+			if (++slash == 2)
+			{
+				slash = 0;
+				p = memchr(p, '\n', end - p);
+				if (p == NULL)
+					p = end;
+			}
+			break;
+		case ';':
+			slash = 0;
+			if (!cmd_pos)
+				break;
+			cmd[cmd_pos] = '\0';
+			ret = svf_compile_command(program, cmd, cmd_pos, line_num, line, end, &echoed);
+			if (ERROR_OK != ret)
+				LOG_ERROR("fail to compile command at line %d", line_num);
+			cmd_pos = 0;
+			break;
+		case '\n':
+			line_num++;
+			line = p;
+		case '\r':
+			slash = 0;
+			/* Don't save '\r' and '\n' if no data is parsed */
+			if (!cmd_pos)
+				break;
+		default:
+			/* The parsing code currently expects a space
+			 * before parentheses -- "TDI (123)".  Also a
+			 * space afterwards -- "TDI (123) TDO(456)".
+			 * But such spaces are optional... instead of
+			 * parser updates, cope with that by adding the
+			 * spaces as needed.
+			 *
+			 * Ensure there are 3 bytes available, for:
+			 *  - current character
+			 *  - added space.
+			 *  - terminating NUL ('\0')
+			 */
+			if ((cmd_pos + 3) > cmd_size)
+			{
+				cmd_size = cmd_size ? cmd_size * 2 : 4096;
+				char *new_cmd = realloc(cmd, cmd_size);
+				if (new_cmd == NULL)
+				{
+					LOG_ERROR("not enough memory");
+					ret = ERROR_FAIL;
+					break;
+				}
+				cmd = new_cmd;
+			}
+
+			/* insert a space before '(' */
+			if ('(' == ch)
+				cmd[cmd_pos++] = ' ';
+
+			cmd[cmd_pos++] = ((ch >= 'a') && (ch <= 'z')) ? (ch - 'a' + 'A') : ch;
+
+			/* insert a space after ')' */
+			if (')' == ch)
+				cmd[cmd_pos++] = ' ';
+			break;
+		}
+	}
+
+	program->num_lines = line_num;
+	free(cmd);
+
+	return ret;
+}
+
+static void svf_free_program(struct svf_program *program)
+{
+	free(program->insns);
+	free(program->data);
+	free(program->text);
+	memset(program, 0, sizeof(*program));
+}
+
 static int svf_check_tdo(void)
 {
 	int i, len, index_var;
@@ -974,6 +1196,8 @@ static int svf_execute_tap(void)
 {
 	if ((!svf_nil) && (ERROR_OK != jtag_execute_queue()))
 	{
+		LOG_ERROR("JTAG queue failed, running lines %d to %d",
+				svf_queue_first_line, svf_line_number);
 		return ERROR_FAIL;
 	}
 	else if (ERROR_OK != svf_check_tdo())
@@ -982,13 +1206,16 @@ static int svf_execute_tap(void)
 	}
 
 	svf_buffer_index = 0;
+	svf_queued_bytes = 0;
+	svf_queue_first_line = 0;
 
 	return ERROR_OK;
 }
 
-static int svf_run_command(struct command_context *cmd_ctx, char *cmd_str)
+static int svf_run_command(struct command_context *cmd_ctx,
+		struct svf_program *program, struct svf_insn *insn)
 {
-	char *argus[256], command;
+	char *argus[256], *cmd_str, command;
 	int num_of_argu = 0, i;
 
 	// tmp variable
@@ -1006,17 +1233,38 @@ static int svf_run_command(struct command_context *cmd_ctx, char *cmd_str)
 	// flag padding commands skipped due to -tap command
 	int padding_command_skipped = 0;
 
-	if (ERROR_OK != svf_parse_cmd_string(cmd_str, strlen(cmd_str), argus, &num_of_argu))
+	if (!svf_queue_first_line)
 	{
-		return ERROR_FAIL;
+		svf_queue_first_line = svf_line_number;
 	}
 
-	/* NOTE: we're a bit loose here, because we ignore case in
-	 * TAP state names (instead of insisting on uppercase).
-	 */
+	switch (insn->command)
+	{
+	case HDR:
+	case HIR:
+	case SDR:
+	case SIR:
+	case TDR:
+	case TIR:
+		// compiled already
+		command = insn->command;
+		break;
+	default:
+		cmd_str = program->text + insn->text;
+		if (ERROR_OK != svf_parse_cmd_string(cmd_str, strlen(cmd_str), argus, &num_of_argu))
+		{
+			return ERROR_FAIL;
+		}
+
+		/* NOTE: we're a bit loose here, because we ignore case in
+		 * TAP state names (instead of insisting on uppercase).
+		 */
+
+		command = svf_find_string_in_array(argus[0],
+				(char **)svf_command_name, ARRAY_SIZE(svf_command_name));
+		break;
+	}
 
-	command = svf_find_string_in_array(argus[0],
-			(char **)svf_command_name, ARRAY_SIZE(svf_command_name));
 	switch (command)
 	{
 	case ENDDR:
@@ -1122,59 +1370,40 @@ static int svf_run_command(struct command_context *cmd_ctx, char *cmd_str)
 		goto XXR_common;
 		XXR_common:
 		// XXR length [TDI (tdi)] [TDO (tdo)][MASK (mask)] [SMASK (smask)]
-		if ((num_of_argu > 10) || (num_of_argu % 2))
-		{
-			LOG_ERROR("invalid parameter of %s", argus[0]);
-			return ERROR_FAIL;
-		}
 		i_tmp = xxr_para_tmp->len;
-		xxr_para_tmp->len = atoi(argus[1]);
+		xxr_para_tmp->len = insn->len;
 		LOG_DEBUG("\tlength = %d", xxr_para_tmp->len);
-		xxr_para_tmp->data_mask = 0;
-		for (i = 2; i < num_of_argu; i += 2)
+		xxr_para_tmp->data_mask = insn->data_mask;
+		for (i = 0; i < 4; i++)
 		{
-			if ((strlen(argus[i + 1]) < 3) || (argus[i + 1][0] != '(') || (argus[i + 1][strlen(argus[i + 1]) - 1] != ')'))
+			if (!(insn->data_mask & (1 << i)))
 			{
-				LOG_ERROR("data section error");
-				return ERROR_FAIL;
+				continue;
 			}
-			argus[i + 1][strlen(argus[i + 1]) - 1] = '\0';
 			// TDI, TDO, MASK, SMASK
-			if (!strcmp(argus[i], "TDI"))
+			switch (1 << i)
 			{
-				// TDI
+			case XXR_TDI:
 				pbuffer_tmp = &xxr_para_tmp->tdi;
-				xxr_para_tmp->data_mask |= XXR_TDI;
-			}
-			else if (!strcmp(argus[i], "TDO"))
-			{
-				// TDO
+				break;
+			case XXR_TDO:
 				pbuffer_tmp = &xxr_para_tmp->tdo;
-				xxr_para_tmp->data_mask |= XXR_TDO;
-			}
-			else if (!strcmp(argus[i], "MASK"))
-			{
-				// MASK
+				break;
+			case XXR_MASK:
 				pbuffer_tmp = &xxr_para_tmp->mask;
-				xxr_para_tmp->data_mask |= XXR_MASK;
-			}
-			else if (!strcmp(argus[i], "SMASK"))
-			{
-				// SMASK
+				break;
+			default:
 				pbuffer_tmp = &xxr_para_tmp->smask;
-				xxr_para_tmp->data_mask |= XXR_SMASK;
-			}
-			else
-			{
-				LOG_ERROR("unknow parameter: %s", argus[i]);
-				return ERROR_FAIL;
+				break;
 			}
-			if (ERROR_OK != svf_copy_hexstring_to_binary(&argus[i + 1][1], pbuffer_tmp, i_tmp, xxr_para_tmp->len))
+			if (ERROR_OK != svf_adjust_array_length(pbuffer_tmp, i_tmp, xxr_para_tmp->len))
 			{
-				LOG_ERROR("fail to parse hex value");
+				LOG_ERROR("fail to adjust length of array");
 				return ERROR_FAIL;
 			}
-			LOG_DEBUG("\t%s = 0x%X", argus[i], (**(int**)pbuffer_tmp) & svf_get_mask_u32(xxr_para_tmp->len));
+			// the value was decoded when compiling
+			memcpy(*pbuffer_tmp, program->data + insn->value[i], (xxr_para_tmp->len + 7) >> 3);
+			LOG_DEBUG("\t%s = 0x%X", svf_xxr_para_name[i], (**(int**)pbuffer_tmp) & svf_get_mask_u32(xxr_para_tmp->len));
 		}
 		// If a command changes the length of the last scan of the same type and the MASK parameter is absent,
 		// the mask pattern used is all cares
@@ -1293,10 +1522,23 @@ static int svf_run_command(struct command_context *cmd_ctx, char *cmd_str)
 
 				svf_add_check_para(1, svf_buffer_index, i);
 			}
-			else
+			else if (debug_level >= LOG_LVL_DEBUG)
 			{
+				// keep what was read, to be logged
 				svf_add_check_para(0, svf_buffer_index, i);
 			}
+			else
+			{
+				// nothing to check: TDI is copied when queued and TDO
+				// is dropped, so the buffer space can be used again
+				if (!svf_nil)
+				{
+					jtag_add_plain_dr_scan(i, &svf_tdi_buffer[svf_buffer_index], NULL,
+							svf_para.dr_end_state);
+				}
+				svf_queued_bytes += (i + 7) >> 3;
+				break;
+			}
 			field.num_bits = i;
 			field.out_value = &svf_tdi_buffer[svf_buffer_index];
 			field.in_value = &svf_tdi_buffer[svf_buffer_index];
@@ -1391,10 +1633,23 @@ static int svf_run_command(struct command_context *cmd_ctx, char *cmd_str)
 
 				svf_add_check_para(1, svf_buffer_index, i);
 			}
-			else
+			else if (debug_level >= LOG_LVL_DEBUG)
 			{
+				// keep what was read, to be logged
 				svf_add_check_para(0, svf_buffer_index, i);
 			}
+			else
+			{
+				// nothing to check: TDI is copied when queued and TDO
+				// is dropped, so the buffer space can be used again
+				if (!svf_nil)
+				{
+					jtag_add_plain_ir_scan(i, &svf_tdi_buffer[svf_buffer_index], NULL,
+							svf_para.ir_end_state);
+				}
+				svf_queued_bytes += (i + 7) >> 3;
+				break;
+			}
 			field.num_bits = i;
 			field.out_value = &svf_tdi_buffer[svf_buffer_index];
 			field.in_value = &svf_tdi_buffer[svf_buffer_index];
@@ -1715,9 +1970,14 @@ static int svf_run_command(struct command_context *cmd_ctx, char *cmd_str)
 	}
 	else
 	{
-		// for fast executing, execute tap if necessary
-		// half of the buffer is for the next command
-		if (((svf_buffer_index >= SVF_MAX_BUFFER_SIZE_TO_COMMIT) || (svf_check_tdo_para_index >= SVF_CHECK_TDO_PARA_SIZE / 2)) && \
+		// for fast executing, execute tap if necessary: once the scans
+		// kept in the buffers for checking, or those only copied into
+		// the JTAG queue, add up to SVF_MAX_BUFFER_SIZE_TO_COMMIT bytes,
+		// or there are too many TDO checks; the buffers are twice that
+		// size, so the next command still fits
+		if (((svf_buffer_index >= SVF_MAX_BUFFER_SIZE_TO_COMMIT)
+				|| (svf_queued_bytes >= SVF_MAX_BUFFER_SIZE_TO_COMMIT)
+				|| (svf_check_tdo_para_index >= SVF_CHECK_TDO_PARA_SIZE)) && \
 			(((command != STATE) && (command != RUNTEST)) || \
 			((command == STATE) && (num_of_argu == 2))))
 		{
@@ -232,9 +232,11 @@ static int jtagdp_transaction_endcheck(struct adiv5_dap *dap)
 	if (dap->ack != JTAG_ACK_OK_FAULT)
 	{
 		long long then = timeval_ms();
+		uint32_t retries = 0;
 
 		while (dap->ack != JTAG_ACK_OK_FAULT)
 		{
+			EVENT_TRACE(EVENT_TRACE_DAP_WAIT, dap->ack, 0, retries++, 0);
 			if (dap->ack == JTAG_ACK_WAIT)
 			{
 				if ((timeval_ms()-then) > 1000)
@@ -271,6 +273,7 @@ static int jtagdp_transaction_endcheck(struct adiv5_dap *dap)
 	/* Check for STICKYERR and STICKYORUN */
 	if (ctrlstat & (SSTICKYORUN | SSTICKYERR))
 	{
+		EVENT_TRACE(EVENT_TRACE_DAP_STICKY, 0, 0, DP_CTRL_STAT, ctrlstat);
 		LOG_DEBUG("jtag-dp: CTRL/STAT error, 0x%" PRIx32, ctrlstat);
 		/* Check power to debug regions */
 		if ((ctrlstat & 0xf0000000) != 0xf0000000)
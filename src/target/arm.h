@@ -225,6 +225,8 @@ int armv4_5_run_algorithm_inner(struct target *target,
 
 int arm_checksum_memory(struct target *target,
 		uint32_t address, uint32_t count, uint32_t *checksum);
+int arm_checksum_memory_blocks(struct target *target,
+		struct target_memory_check_block *blocks, unsigned num_blocks);
 int arm_blank_check_memory(struct target *target,
 		uint32_t address, uint32_t count, uint32_t *blank);
 
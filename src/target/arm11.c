@@ -1416,6 +1416,7 @@ struct target_type arm11_target = {
 	.bulk_write_memory =	arm11_bulk_write_memory,
 
 	.checksum_memory =	arm_checksum_memory,
+	.checksum_memory_blocks =	arm_checksum_memory_blocks,
 	.blank_check_memory =	arm_blank_check_memory,
 
 	.add_breakpoint =	arm11_add_breakpoint,
@@ -844,6 +844,7 @@ struct target_type arm926ejs_target =
 	.bulk_write_memory = arm7_9_bulk_write_memory,
 
 	.checksum_memory = arm_checksum_memory,
+	.checksum_memory_blocks = arm_checksum_memory_blocks,
 	.blank_check_memory = arm_blank_check_memory,
 
 	.run_algorithm = armv4_5_run_algorithm,
@@ -31,6 +31,7 @@
  */
 
 #include "arm_jtag.h"
+#include <helper/event_trace.h>
 
 /* FIXME remove these JTAG-specific decls when mem_ap_read_buf_u32()
  * is no longer JTAG-specific
@@ -257,6 +258,7 @@ static inline int dap_queue_dp_read(struct adiv5_dap *dap,
 		unsigned reg, uint32_t *data)
 {
 	assert(dap->ops != NULL);
+	EVENT_TRACE(EVENT_TRACE_DP_READ, 0, 0, reg, 0);
 	return dap->ops->queue_dp_read(dap, reg, data);
 }
 
@@ -275,6 +277,7 @@ static inline int dap_queue_dp_write(struct adiv5_dap *dap,
 		unsigned reg, uint32_t data)
 {
 	assert(dap->ops != NULL);
+	EVENT_TRACE(EVENT_TRACE_DP_WRITE, 0, 0, reg, data);
 	return dap->ops->queue_dp_write(dap, reg, data);
 }
 
@@ -292,6 +295,7 @@ static inline int dap_queue_ap_read(struct adiv5_dap *dap,
 		unsigned reg, uint32_t *data)
 {
 	assert(dap->ops != NULL);
+	EVENT_TRACE(EVENT_TRACE_AP_READ, 0, dap->ap_current >> 24, reg, 0);
 	return dap->ops->queue_ap_read(dap, reg, data);
 }
 
@@ -308,6 +312,7 @@ static inline int dap_queue_ap_write(struct adiv5_dap *dap,
 		unsigned reg, uint32_t data)
 {
 	assert(dap->ops != NULL);
+	EVENT_TRACE(EVENT_TRACE_AP_WRITE, 0, dap->ap_current >> 24, reg, data);
 	return dap->ops->queue_ap_write(dap, reg, data);
 }
 
@@ -1389,6 +1389,155 @@ int arm_checksum_memory(struct target *target,
 	return ERROR_OK;
 }
 
+/**
+ * Runs ARM code in the target to calculate the CRC32 checksums of a list
+ * of memory blocks.  The block table is staged in working area, so each
+ * algorithm run covers as many blocks as the table area can hold.
+ */
+int arm_checksum_memory_blocks(struct target *target,
+		struct target_memory_check_block *blocks, unsigned num_blocks)
+{
+	struct working_area *crc_algorithm;
+	struct working_area *table_area = NULL;
+	struct arm_algorithm armv4_5_info;
+	struct arm *armv4_5 = target_to_arm(target);
+	struct reg_param reg_params[2];
+	struct mem_param mem_params[1];
+	int retval;
+	uint32_t i;
+	uint32_t exit_var = 0;
+	unsigned batch, done;
+
+	/* see contib/loaders/checksum/armv4_5_crc_blocks.s for src */
+
+	static const uint32_t arm_crc_blocks_code[] = {
+		0xE1A08000,		/* mov		r8, r0 */
+		0xE1A09001,		/* mov		r9, r1 */
+		0xE59F705C,		/* ldr		r7, CRC32XOR */
+		0xEA000013,		/* b		nblock */
+		/* block: */
+		0xE4982004,		/* ldr		r2, [r8], #4 */
+		0xE5983000,		/* ldr		r3, [r8] */
+		0xE3E00000,		/* mov		r0, #0xffffffff */
+		0xE3A04000,		/* mov		r4, #0 */
+		0xEA00000A,		/* b		ncomp */
+		/* nbyte: */
+		0xE7D21004,		/* ldrb	r1, [r2, r4] */
+		0xE0200C01,		/* eor		r0, r0, r1, asl 24 */
+		0xE3A05000,		/* mov		r5, #0 */
+		/* loop: */
+		0xE3500000,		/* cmp		r0, #0 */
+		0xE1A06080,		/* mov		r6, r0, asl #1 */
+		0xE2855001,		/* add		r5, r5, #1 */
+		0xE1A00006,		/* mov		r0, r6 */
+		0xB0260007,		/* eorlt	r0, r6, r7 */
+		0xE3550008,		/* cmp		r5, #8 */
+		0x1AFFFFF8,		/* bne		loop */
+		0xE2844001,		/* add		r4, r4, #1 */
+		/* ncomp: */
+		0xE1540003,		/* cmp		r4, r3 */
+		0x1AFFFFF2,		/* bne		nbyte */
+		0xE4880004,		/* str		r0, [r8], #4 */
+		0xE2499001,		/* sub		r9, r9, #1 */
+		/* nblock: */
+		0xE3590000,		/* cmp		r9, #0 */
+		0x1AFFFFE9,		/* bne		block */
+		/* end: */
+		0xe1200070,		/* bkpt		#0 */
+		/* CRC32XOR: */
+		0x04C11DB7		/* .word 0x04C11DB7 */
+	};
+
+	retval = target_alloc_working_area(target,
+			sizeof(arm_crc_blocks_code), &crc_algorithm);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* convert code into a buffer in target endianness */
+	for (i = 0; i < ARRAY_SIZE(arm_crc_blocks_code); i++) {
+		retval = target_write_u32(target,
+				crc_algorithm->address + i * sizeof(uint32_t),
+				arm_crc_blocks_code[i]);
+		if (retval != ERROR_OK) {
+			target_free_working_area(target, crc_algorithm);
+			return retval;
+		}
+	}
+
+	/* each table entry is an (address, count) pair; the count
+	 * is overwritten with the crc of that block */
+	batch = num_blocks < 1024 ? num_blocks : 1024;
+	while (target_alloc_working_area_try(target,
+			batch * 8, &table_area) != ERROR_OK) {
+		batch /= 2;
+		if (batch == 0) {
+			LOG_WARNING("not enough working area for crc block table");
+			target_free_working_area(target, crc_algorithm);
+			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		}
+	}
+
+	armv4_5_info.common_magic = ARM_COMMON_MAGIC;
+	armv4_5_info.core_mode = ARM_MODE_SVC;
+	armv4_5_info.core_state = ARM_STATE_ARM;
+
+	/* armv4 must exit using a hardware breakpoint */
+	if (armv4_5->is_armv4)
+		exit_var = crc_algorithm->address + sizeof(arm_crc_blocks_code) - 8;
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_OUT);
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);
+
+	for (done = 0; done < num_blocks; done += batch) {
+		unsigned count = num_blocks - done;
+		uint32_t total = 0;
+
+		if (count > batch)
+			count = batch;
+
+		init_mem_param(&mem_params[0], table_area->address,
+				count * 8, PARAM_IN_OUT);
+		for (i = 0; i < count; i++) {
+			target_buffer_set_u32(target, mem_params[0].value + i * 8,
+					blocks[done + i].address);
+			target_buffer_set_u32(target, mem_params[0].value + i * 8 + 4,
+					blocks[done + i].size);
+			total += blocks[done + i].size;
+		}
+
+		buf_set_u32(reg_params[0].value, 0, 32, table_area->address);
+		buf_set_u32(reg_params[1].value, 0, 32, count);
+
+		/* 20 second timeout/megabyte */
+		int timeout = 20000 * (1 + (total / (1024 * 1024)));
+
+		retval = target_run_algorithm(target, 1, mem_params, 2, reg_params,
+				crc_algorithm->address,
+				exit_var,
+				timeout, &armv4_5_info);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("error executing ARM crc algorithm");
+			destroy_mem_param(&mem_params[0]);
+			break;
+		}
+
+		for (i = 0; i < count; i++)
+			blocks[done + i].result = target_buffer_get_u32(target,
+					mem_params[0].value + i * 8 + 4);
+
+		destroy_mem_param(&mem_params[0]);
+		keep_alive();
+	}
+
+	destroy_reg_param(&reg_params[0]);
+	destroy_reg_param(&reg_params[1]);
+
+	target_free_working_area(target, table_area);
+	target_free_working_area(target, crc_algorithm);
+
+	return retval;
+}
+
 /**
  * Runs ARM code in the target to check whether a memory block holds
  * all ones.  NOR flash which has been erased, and thus may be written,
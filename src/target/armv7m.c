@@ -624,6 +624,139 @@ int armv7m_checksum_memory(struct target *target,
 	return ERROR_OK;
 }
 
+/** Generates CRC32 checksums of a list of memory regions. */
+int armv7m_checksum_memory_blocks(struct target *target,
+		struct target_memory_check_block *blocks, unsigned num_blocks)
+{
+	struct working_area *crc_algorithm;
+	struct working_area *table_area = NULL;
+	struct armv7m_algorithm armv7m_info;
+	struct reg_param reg_params[2];
+	struct mem_param mem_params[1];
+	int retval = ERROR_OK;
+	unsigned batch, done;
+
+	/* see contib/loaders/checksum/armv7m_crc_blocks.s for src */
+
+	static const uint16_t cortex_m3_crc_blocks_code[] = {
+		0x4680,					/* mov	r8, r0 */
+		0x4689,					/* mov	r9, r1 */
+		0xF8DF, 0x704C,			/* ldr	r7, CRC32XOR */
+		0xE020,					/* b	nblock */
+								/* block: */
+		0xF858, 0x2B04,			/* ldr	r2, [r8], #4 */
+		0xF8D8, 0x3000,			/* ldr	r3, [r8] */
+		0xF04F, 0x30FF,			/* mov	r0, #0xffffffff */
+		0xF04F, 0x0400,			/* mov	r4, #0 */
+		0xE011,					/* b	ncomp */
+								/* nbyte: */
+		0x5D11,					/* ldrb	r1, [r2, r4] */
+		0xEA80, 0x6001,			/* eor		r0, r0, r1, asl #24 */
+
+		0xF04F, 0x0500,			/* mov		r5, #0 */
+								/* loop: */
+		0x2800,					/* cmp		r0, #0 */
+		0xEA4F, 0x0640,			/* mov		r6, r0, asl #1 */
+		0xF105, 0x0501,			/* add		r5, r5, #1 */
+		0x4630,					/* mov		r0, r6 */
+		0xBFB8,					/* it		lt */
+		0xEA86, 0x0007,			/* eor		r0, r6, r7 */
+		0x2D08, 				/* cmp		r5, #8 */
+		0xD1F4,					/* bne		loop */
+
+		0xF104, 0x0401,			/* add	r4, r4, #1 */
+								/* ncomp: */
+		0x429C,					/* cmp	r4, r3 */
+		0xD1EB,					/* bne	nbyte */
+		0xF848, 0x0B04,			/* str	r0, [r8], #4 */
+		0xF1A9, 0x0901,			/* sub	r9, r9, #1 */
+								/* nblock: */
+		0xF1B9, 0x0F00,			/* cmp	r9, #0 */
+		0xD1DB,					/* bne	block */
+		0xBE00,     			/* bkpt #0 */
+		0x1DB7, 0x04C1			/* CRC32XOR:	.word 0x04C11DB7 */
+	};
+
+	uint32_t i;
+
+	if (target_alloc_working_area(target, sizeof(cortex_m3_crc_blocks_code), &crc_algorithm) != ERROR_OK)
+	{
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	/* convert code into a buffer in target endianness */
+	for (i = 0; i < ARRAY_SIZE(cortex_m3_crc_blocks_code); i++)
+		if ((retval = target_write_u16(target, crc_algorithm->address + i*sizeof(uint16_t), cortex_m3_crc_blocks_code[i])) != ERROR_OK)
+		{
+			target_free_working_area(target, crc_algorithm);
+			return retval;
+		}
+
+	/* each table entry is an (address, count) pair; the count
+	 * is overwritten with the crc of that block */
+	batch = num_blocks < 1024 ? num_blocks : 1024;
+	while (target_alloc_working_area_try(target, batch * 8, &table_area) != ERROR_OK)
+	{
+		batch /= 2;
+		if (batch == 0)
+		{
+			LOG_WARNING("not enough working area for crc block table");
+			target_free_working_area(target, crc_algorithm);
+			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		}
+	}
+
+	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
+	armv7m_info.core_mode = ARMV7M_MODE_ANY;
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_OUT);
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);
+
+	for (done = 0; done < num_blocks; done += batch)
+	{
+		unsigned count = num_blocks - done;
+		uint32_t total = 0;
+
+		if (count > batch)
+			count = batch;
+
+		init_mem_param(&mem_params[0], table_area->address, count * 8, PARAM_IN_OUT);
+		for (i = 0; i < count; i++)
+		{
+			target_buffer_set_u32(target, mem_params[0].value + i * 8, blocks[done + i].address);
+			target_buffer_set_u32(target, mem_params[0].value + i * 8 + 4, blocks[done + i].size);
+			total += blocks[done + i].size;
+		}
+
+		buf_set_u32(reg_params[0].value, 0, 32, table_area->address);
+		buf_set_u32(reg_params[1].value, 0, 32, count);
+
+		int timeout = 20000 * (1 + (total / (1024 * 1024)));
+
+		if ((retval = target_run_algorithm(target, 1, mem_params, 2, reg_params,
+			crc_algorithm->address, crc_algorithm->address + (sizeof(cortex_m3_crc_blocks_code)-6), timeout, &armv7m_info)) != ERROR_OK)
+		{
+			LOG_ERROR("error executing cortex_m3 crc algorithm");
+			destroy_mem_param(&mem_params[0]);
+			break;
+		}
+
+		for (i = 0; i < count; i++)
+			blocks[done + i].result = target_buffer_get_u32(target, mem_params[0].value + i * 8 + 4);
+
+		destroy_mem_param(&mem_params[0]);
+		keep_alive();
+	}
+
+	destroy_reg_param(&reg_params[0]);
+	destroy_reg_param(&reg_params[1]);
+
+	target_free_working_area(target, table_area);
+	target_free_working_area(target, crc_algorithm);
+
+	return retval;
+}
+
 /** Checks whether a memory region is zeroed. */
 int armv7m_blank_check_memory(struct target *target,
 		uint32_t address, uint32_t count, uint32_t* blank)
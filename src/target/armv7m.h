@@ -174,6 +174,8 @@ int armv7m_restore_context(struct target *target);
 
 int armv7m_checksum_memory(struct target *target,
 		uint32_t address, uint32_t count, uint32_t* checksum);
+int armv7m_checksum_memory_blocks(struct target *target,
+		struct target_memory_check_block *blocks, unsigned num_blocks);
 int armv7m_blank_check_memory(struct target *target,
 		uint32_t address, uint32_t count, uint32_t* blank);
 
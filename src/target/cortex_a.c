@@ -2203,7 +2203,8 @@ static int cortex_a8_init_arch_info(struct target *target,
 	arm_init_arch_info(target, armv4_5);
 	armv7a->common_magic = ARMV7_COMMON_MAGIC;
 
-	target_register_timer_callback(cortex_a8_handle_target_request, 1, 1, target);
+	target_register_timer_callback(cortex_a8_handle_target_request, 1, 1,
+			target, "target_request");
 
 	return ERROR_OK;
 }
@@ -2541,6 +2542,7 @@ struct target_type cortexa8_target = {
 	.bulk_write_memory = cortex_a8_bulk_write_memory,
 
 	.checksum_memory = arm_checksum_memory,
+	.checksum_memory_blocks = arm_checksum_memory_blocks,
 	.blank_check_memory = arm_blank_check_memory,
 
 	.run_algorithm = armv4_5_run_algorithm,
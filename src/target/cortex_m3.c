@@ -1965,7 +1965,8 @@ static int cortex_m3_init_arch_info(struct target *target,
 	armv7m->load_core_reg_u32 = cortex_m3_load_core_reg_u32;
 	armv7m->store_core_reg_u32 = cortex_m3_store_core_reg_u32;
 
-	target_register_timer_callback(cortex_m3_handle_target_request, 1, 1, target);
+	target_register_timer_callback(cortex_m3_handle_target_request, 1, 1,
+			target, "target_request");
 
 	if ((retval = arm_jtag_setup_connection(&cortex_m3->jtag_info)) != ERROR_OK)
 	{
@@ -2220,6 +2221,7 @@ struct target_type cortexm3_target =
 	.write_memory = cortex_m3_write_memory,
 	.bulk_write_memory = cortex_m3_bulk_write_memory,
 	.checksum_memory = armv7m_checksum_memory,
+	.checksum_memory_blocks = armv7m_checksum_memory_blocks,
 	.blank_check_memory = armv7m_blank_check_memory,
 
 	.run_algorithm = armv7m_run_algorithm,
@@ -29,6 +29,7 @@
 
 #include "embeddedice.h"
 #include "register.h"
+#include <helper/event_trace.h>
 
 /**
  * @file
@@ -615,18 +616,30 @@ int embeddedice_handshake(struct arm_jtag *jtag_info, int hsbit, uint32_t timeou
 
 	jtag_add_dr_scan(jtag_info->tap, 3, fields, TAP_IDLE);
 	gettimeofday(&lap, NULL);
+	uint32_t polls = 0;
 	do {
 		jtag_add_dr_scan(jtag_info->tap, 3, fields, TAP_IDLE);
+		polls++;
 		if ((retval = jtag_execute_queue()) != ERROR_OK)
+		{
+			EVENT_TRACE(EVENT_TRACE_DCC_HANDSHAKE, retval,
+					0, hsbit, polls);
 			return retval;
+		}
 
 		if (buf_get_u32(field0_in, hsbit, 1) == hsact)
+		{
+			EVENT_TRACE(EVENT_TRACE_DCC_HANDSHAKE, ERROR_OK,
+					0, hsbit, polls);
 			return ERROR_OK;
+		}
 
 		gettimeofday(&now, NULL);
 	} while ((uint32_t)((now.tv_sec - lap.tv_sec) * 1000
 			+ (now.tv_usec - lap.tv_usec) / 1000) <= timeout);
 
+	EVENT_TRACE(EVENT_TRACE_DCC_HANDSHAKE, ERROR_TARGET_TIMEOUT,
+			0, hsbit, polls);
 	LOG_ERROR("embeddedice handshake timeout");
 	return ERROR_TARGET_TIMEOUT;
 }
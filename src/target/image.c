@@ -147,214 +147,292 @@ static int identify_image_type(struct image *image, const char *type_string, con
 	return ERROR_OK;
 }
 
-static int image_ihex_buffer_complete_inner(struct image *image, char *lpszLine, struct imagesection *section)
+/* Hex digit values plus one, so that zero marks a character which
+ * isn't a hex digit; this replaces sscanf() in the record parsers.
+ */
+static const uint8_t image_hex_digit[256] =
 {
-	struct image_ihex *ihex = image->type_private;
-	struct fileio *fileio = &ihex->fileio;
-	uint32_t full_address = 0x0;
-	uint32_t cooked_bytes;
-	int i;
+	['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5,
+	['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+	['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+	['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+};
+
+/* decode "count" bytes of hex at text into data, adding them to sum;
+ * returns false if any character isn't a hex digit
+ */
+static bool image_hex_decode(const char *text, uint8_t *data,
+		unsigned count, uint8_t *sum)
+{
+	const uint8_t *s = (const uint8_t *)text;
+	uint8_t bad = 0;
+
+	while (count-- > 0)
+	{
+		uint8_t hi = image_hex_digit[s[0]];
+		uint8_t lo = image_hex_digit[s[1]];
+		uint8_t value = ((hi - 1) << 4) | (lo - 1);
+
+		bad |= !hi | !lo;
+		*data++ = value;
+		*sum += value;
+		s += 2;
+	}
+
+	return !bad;
+}
 
-	/* we can't determine the number of sections that we'll have to create ahead of time,
-	 * so we locally hold them until parsing is finished */
+/* Parser state shared by the IHEX and S19 loaders.  Decoded data goes
+ * to one buffer, and the sections, whose number isn't known ahead of
+ * time, are consecutive runs of that buffer.
+ */
+struct image_hex_parser
+{
+	const char *text;		/* whole file */
+	const char *end;
+	uint8_t *buffer;		/* decoded data */
+	uint32_t cooked_bytes;
+	struct imagesection *sections;
+	int num_sections;		/* index of the current section */
+	int max_sections;
+	uint32_t full_address;	/* address of the next byte of the current section */
+};
 
+/* Get the whole file as text, mapped if possible, and a buffer which
+ * is certainly large enough for the data it encodes.
+ */
+static int image_hex_parser_init(struct image_hex_parser *parser,
+		struct fileio *fileio, uint8_t **copy)
+{
+	const uint8_t *data;
 	int filesize;
 	int retval;
+
+	memset(parser, 0, sizeof(*parser));
+	*copy = NULL;
+
 	retval = fileio_size(fileio, &filesize);
 	if (retval != ERROR_OK)
 		return retval;
 
-	ihex->buffer = malloc(filesize >> 1);
-	cooked_bytes = 0x0;
-	image->num_sections = 0;
-	section[image->num_sections].private = &ihex->buffer[cooked_bytes];
-	section[image->num_sections].base_address = 0x0;
-	section[image->num_sections].size = 0x0;
-	section[image->num_sections].flags = 0;
+	if (fileio_map(fileio, &data) != ERROR_OK)
+	{
+		size_t read_bytes;
+
+		*copy = malloc(filesize + 1);
+		if (*copy == NULL)
+		{
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+		retval = fileio_read(fileio, filesize, *copy, &read_bytes);
+		if (retval != ERROR_OK)
+			return retval;
+		filesize = read_bytes;
+		data = *copy;
+	}
+
+	parser->text = (const char *)data;
+	parser->end = parser->text + filesize;
+
+	/* every data byte takes at least two characters */
+	parser->buffer = malloc((filesize >> 1) + 1);
+	parser->max_sections = 16;
+	parser->sections = malloc(sizeof(struct imagesection) * parser->max_sections);
+	if ((parser->buffer == NULL) || (parser->sections == NULL))
+	{
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	parser->num_sections = 0;
+	parser->sections[0].private = NULL;
+	parser->sections[0].base_address = 0x0;
+	parser->sections[0].size = 0x0;
+	parser->sections[0].flags = 0;
+
+	return ERROR_OK;
+}
+
+/* Continue at a nonconsecutive location: create a new section, unless
+ * the current one has zero size, in which case this specifies the
+ * current section's base address.
+ */
+static int image_hex_parser_seek(struct image_hex_parser *parser, uint32_t address)
+{
+	if (parser->sections[parser->num_sections].size != 0)
+	{
+		if (parser->num_sections + 1 == parser->max_sections)
+		{
+			struct imagesection *sections = realloc(parser->sections,
+					sizeof(struct imagesection) * parser->max_sections * 2);
+			if (sections == NULL)
+			{
+				LOG_ERROR("Out of memory");
+				return ERROR_FAIL;
+			}
+			parser->sections = sections;
+			parser->max_sections *= 2;
+		}
+		parser->num_sections++;
+		parser->sections[parser->num_sections].size = 0x0;
+		parser->sections[parser->num_sections].flags = 0;
+	}
+	parser->sections[parser->num_sections].base_address = address;
+	parser->full_address = address;
 
-	while (fileio_fgets(fileio, 1023, lpszLine) == ERROR_OK)
+	return ERROR_OK;
+}
+
+/* Hand the sections and their data to the image, trimming the data
+ * buffer to what was actually decoded.
+ */
+static void image_hex_parser_finish(struct image_hex_parser *parser,
+		struct image *image, uint8_t **buffer)
+{
+	uint8_t *data = parser->buffer;
+	int i;
+
+	if (parser->cooked_bytes != 0)
 	{
+		data = realloc(parser->buffer, parser->cooked_bytes);
+		if (data == NULL)
+			data = parser->buffer;
+	}
+	parser->buffer = NULL;
+
+	/* the sections are consecutive in the buffer */
+	image->num_sections = parser->num_sections + 1;
+	image->sections = parser->sections;
+	parser->sections = NULL;
+	*buffer = data;
+	for (i = 0; i < image->num_sections; i++)
+	{
+		image->sections[i].private = data;
+		data += image->sections[i].size;
+	}
+}
+
+static void image_hex_parser_cleanup(struct image_hex_parser *parser)
+{
+	free(parser->buffer);
+	free(parser->sections);
+}
+
+static int image_ihex_buffer_complete_inner(struct image *image,
+		struct image_hex_parser *parser)
+{
+	const char *p = parser->text;
+	const char *end = parser->end;
+	uint32_t full_address;
+	uint8_t record[255];
+
+	while (1)
+	{
+		uint8_t header[4];
 		uint32_t count;
 		uint32_t address;
 		uint32_t record_type;
-		uint32_t checksum;
+		uint8_t checksum;
 		uint8_t cal_checksum = 0;
-		size_t bytes_read = 0;
+		uint8_t *data;
 
-		if (sscanf(&lpszLine[bytes_read], ":%2" SCNx32 "%4" SCNx32 "%2" SCNx32 , &count, &address, &record_type) != 3)
+		while ((p < end) && isspace((unsigned char)*p))
+			p++;
+		if (p == end)
+			break;
+
+		/* ":" count(1) address(2) type(1) data(count) checksum(1) */
+		if ((end - p < 11) || (*p != ':')
+				|| !image_hex_decode(p + 1, header, 4, &cal_checksum))
+		{
+			return ERROR_IMAGE_FORMAT_ERROR;
+		}
+		count = header[0];
+		address = (header[1] << 8) | header[2];
+		record_type = header[3];
+		if ((size_t)(end - p) < 11 + 2 * count)
 		{
 			return ERROR_IMAGE_FORMAT_ERROR;
 		}
-		bytes_read += 9;
 
-		cal_checksum += (uint8_t)count;
-		cal_checksum += (uint8_t)(address >> 8);
-		cal_checksum += (uint8_t)address;
-		cal_checksum += (uint8_t)record_type;
+		full_address = parser->full_address;
+		if ((record_type == 0) && ((full_address & 0xffff) != address))
+		{
+			/* we encountered a nonconsecutive location */
+			if (image_hex_parser_seek(parser,
+					(full_address & 0xffff0000) | address) != ERROR_OK)
+				return ERROR_FAIL;
+		}
 
-		if (record_type == 0) /* Data Record */
+		/* data records are decoded straight into the image buffer */
+		data = (record_type == 0)
+				? &parser->buffer[parser->cooked_bytes] : record;
+		if (!image_hex_decode(p + 9, data, count, &cal_checksum)
+				|| !image_hex_decode(p + 9 + 2 * count, &checksum, 1,
+					&cal_checksum))
 		{
-			if ((full_address & 0xffff) != address)
-			{
-				/* we encountered a nonconsecutive location, create a new section,
-				 * unless the current section has zero size, in which case this specifies
-				 * the current section's base address
-				 */
-				if (section[image->num_sections].size != 0)
-				{
-					image->num_sections++;
-					if (image->num_sections >= IMAGE_MAX_SECTIONS)
-					{
-						/* too many sections */
-						LOG_ERROR("Too many sections found in IHEX file");
-						return ERROR_IMAGE_FORMAT_ERROR;
-					}
-					section[image->num_sections].size = 0x0;
-					section[image->num_sections].flags = 0;
-					section[image->num_sections].private = &ihex->buffer[cooked_bytes];
-				}
-				section[image->num_sections].base_address =
-					(full_address & 0xffff0000) | address;
-				full_address = (full_address & 0xffff0000) | address;
-			}
+			return ERROR_IMAGE_FORMAT_ERROR;
+		}
+		p += 11 + 2 * count;
 
-			while (count-- > 0)
-			{
-				unsigned value;
-				sscanf(&lpszLine[bytes_read], "%2x", &value);
-				ihex->buffer[cooked_bytes] = (uint8_t)value;
-				cal_checksum += (uint8_t)ihex->buffer[cooked_bytes];
-				bytes_read += 2;
-				cooked_bytes += 1;
-				section[image->num_sections].size += 1;
-				full_address++;
-			}
+		/* the checksum makes the sum of all bytes zero */
+		if (cal_checksum != 0)
+		{
+			/* checksum failed */
+			LOG_ERROR("incorrect record checksum found in IHEX file");
+			return ERROR_IMAGE_CHECKSUM;
+		}
+
+		if (record_type == 0) /* Data Record */
+		{
+			parser->cooked_bytes += count;
+			parser->sections[parser->num_sections].size += count;
+			parser->full_address += count;
 		}
 		else if (record_type == 1) /* End of File Record */
 		{
-			/* finish the current section */
-			image->num_sections++;
-
-			/* copy section information */
-			image->sections = malloc(sizeof(struct imagesection) * image->num_sections);
-			for (i = 0; i < image->num_sections; i++)
-			{
-				image->sections[i].private = section[i].private;
-				image->sections[i].base_address = section[i].base_address;
-				image->sections[i].size = section[i].size;
-				image->sections[i].flags = section[i].flags;
-			}
-
 			return ERROR_OK;
 		}
-		else if (record_type == 2) /* Linear Address Record */
+		else if ((record_type == 2) || (record_type == 4))
 		{
-			uint16_t upper_address;
+			/* Extended Segment / Linear Address Record */
+			uint32_t upper_address;
+			int shift = (record_type == 2) ? 4 : 16;
 
-			sscanf(&lpszLine[bytes_read], "%4hx", &upper_address);
-			cal_checksum += (uint8_t)(upper_address >> 8);
-			cal_checksum += (uint8_t)upper_address;
-			bytes_read += 4;
+			if (count < 2)
+				return ERROR_IMAGE_FORMAT_ERROR;
+			upper_address = be_to_h_u16(record);
 
-			if ((full_address >> 4) != upper_address)
+			if ((full_address >> shift) != upper_address)
 			{
-				/* we encountered a nonconsecutive location, create a new section,
-				 * unless the current section has zero size, in which case this specifies
-				 * the current section's base address
-				 */
-				if (section[image->num_sections].size != 0)
-				{
-					image->num_sections++;
-					if (image->num_sections >= IMAGE_MAX_SECTIONS)
-					{
-						/* too many sections */
-						LOG_ERROR("Too many sections found in IHEX file");
-						return ERROR_IMAGE_FORMAT_ERROR;
-					}
-					section[image->num_sections].size = 0x0;
-					section[image->num_sections].flags = 0;
-					section[image->num_sections].private = &ihex->buffer[cooked_bytes];
-				}
-				section[image->num_sections].base_address =
-					(full_address & 0xffff) | (upper_address << 4);
-				full_address = (full_address & 0xffff) | (upper_address << 4);
+				/* we encountered a nonconsecutive location */
+				if (image_hex_parser_seek(parser, (full_address & 0xffff)
+						| (upper_address << shift)) != ERROR_OK)
+					return ERROR_FAIL;
 			}
 		}
 		else if (record_type == 3) /* Start Segment Address Record */
 		{
-			uint32_t dummy;
-
 			/* "Start Segment Address Record" will not be supported */
 			/* but we must consume it, and do not create an error.  */
-			while (count-- > 0)
-			{
-				sscanf(&lpszLine[bytes_read], "%2" SCNx32 , &dummy);
-				cal_checksum += (uint8_t)dummy;
-				bytes_read += 2;
-			}
-		}
-		else if (record_type == 4) /* Extended Linear Address Record */
-		{
-			uint16_t upper_address;
-
-			sscanf(&lpszLine[bytes_read], "%4hx", &upper_address);
-			cal_checksum += (uint8_t)(upper_address >> 8);
-			cal_checksum += (uint8_t)upper_address;
-			bytes_read += 4;
-
-			if ((full_address >> 16) != upper_address)
-			{
-				/* we encountered a nonconsecutive location, create a new section,
-				 * unless the current section has zero size, in which case this specifies
-				 * the current section's base address
-				 */
-				if (section[image->num_sections].size != 0)
-				{
-					image->num_sections++;
-					if (image->num_sections >= IMAGE_MAX_SECTIONS)
-					{
-						/* too many sections */
-						LOG_ERROR("Too many sections found in IHEX file");
-						return ERROR_IMAGE_FORMAT_ERROR;
-					}
-					section[image->num_sections].size = 0x0;
-					section[image->num_sections].flags = 0;
-					section[image->num_sections].private = &ihex->buffer[cooked_bytes];
-				}
-				section[image->num_sections].base_address =
-					(full_address & 0xffff) | (upper_address << 16);
-				full_address = (full_address & 0xffff) | (upper_address << 16);
-			}
 		}
 		else if (record_type == 5) /* Start Linear Address Record */
 		{
-			uint32_t start_address;
-
-			sscanf(&lpszLine[bytes_read], "%8" SCNx32, &start_address);
-			cal_checksum += (uint8_t)(start_address >> 24);
-			cal_checksum += (uint8_t)(start_address >> 16);
-			cal_checksum += (uint8_t)(start_address >> 8);
-			cal_checksum += (uint8_t)start_address;
-			bytes_read += 8;
-
+			if (count < 4)
+				return ERROR_IMAGE_FORMAT_ERROR;
 			image->start_address_set = 1;
-			image->start_address = be_to_h_u32((uint8_t*)&start_address);
+			image->start_address = be_to_h_u32(record);
 		}
 		else
 		{
-		  LOG_ERROR("unhandled IHEX record type: %i", (int)record_type);
+			LOG_ERROR("unhandled IHEX record type: %i", (int)record_type);
 			return ERROR_IMAGE_FORMAT_ERROR;
 		}
 
-		sscanf(&lpszLine[bytes_read], "%2" SCNx32 , &checksum);
-		bytes_read += 2;
-
-		if ((uint8_t)checksum != (uint8_t)(~cal_checksum + 1))
-		{
-			/* checksum failed */
-			LOG_ERROR("incorrect record checksum found in IHEX file");
-			return ERROR_IMAGE_CHECKSUM;
-		}
+		/* ignore anything else on the line */
+		while ((p < end) && (*p != '\n'))
+			p++;
 	}
 
 	LOG_ERROR("premature end of IHEX file, no end-of-file record found");
@@ -362,30 +440,27 @@ static int image_ihex_buffer_complete_inner(struct image *image, char *lpszLine,
 }
 
 /**
- * Allocate memory dynamically instead of on the stack. This
- * is important w/embedded hosts.
+ * Decode a whole IHEX file in one pass over its (normally mapped)
+ * text into one buffer; consecutive data records extend the current
+ * section, and there is no fixed limit on the number of sections.
  */
 static int image_ihex_buffer_complete(struct image *image)
 {
-	char *lpszLine = malloc(1023);
-	if (lpszLine == NULL)
-	{
-		LOG_ERROR("Out of memory");
-		return ERROR_FAIL;
-	}
-	struct imagesection *section = malloc(sizeof(struct imagesection) * IMAGE_MAX_SECTIONS);
-	if (section == NULL)
-	{
-		free(lpszLine);
-		LOG_ERROR("Out of memory");
-		return ERROR_FAIL;
-	}
+	struct image_ihex *ihex = image->type_private;
+	struct image_hex_parser parser;
+	uint8_t *copy;
 	int retval;
 
-	retval = image_ihex_buffer_complete_inner(image, lpszLine, section);
+	ihex->buffer = NULL;
+
+	retval = image_hex_parser_init(&parser, &ihex->fileio, &copy);
+	if (retval == ERROR_OK)
+		retval = image_ihex_buffer_complete_inner(image, &parser);
+	if (retval == ERROR_OK)
+		image_hex_parser_finish(&parser, image, &ihex->buffer);
 
-	free(section);
-	free(lpszLine);
+	image_hex_parser_cleanup(&parser);
+	free(copy);
 
 	return retval;
 }
@@ -532,174 +607,126 @@ static int image_elf_read_section(struct image *image, int section, uint32_t off
 	return ERROR_OK;
 }
 
-static int image_mot_buffer_complete_inner(struct image *image, char *lpszLine, struct imagesection *section)
+static int image_mot_buffer_complete_inner(struct image_hex_parser *parser)
 {
-	struct image_mot *mot = image->type_private;
-	struct fileio *fileio = &mot->fileio;
-	uint32_t full_address = 0x0;
-	uint32_t cooked_bytes;
-	int i;
-
-	/* we can't determine the number of sections that we'll have to create ahead of time,
-	 * so we locally hold them until parsing is finished */
+	const char *p = parser->text;
+	const char *end = parser->end;
+	uint8_t record[255];
 
-	int retval;
-	int filesize;
-	retval = fileio_size(fileio, &filesize);
-	if (retval != ERROR_OK)
-		return retval;
-
-	mot->buffer = malloc(filesize >> 1);
-	cooked_bytes = 0x0;
-	image->num_sections = 0;
-	section[image->num_sections].private = &mot->buffer[cooked_bytes];
-	section[image->num_sections].base_address = 0x0;
-	section[image->num_sections].size = 0x0;
-	section[image->num_sections].flags = 0;
-
-	while (fileio_fgets(fileio, 1023, lpszLine) == ERROR_OK)
+	while (1)
 	{
 		uint32_t count;
 		uint32_t address;
 		uint32_t record_type;
-		uint32_t checksum;
+		uint32_t address_bytes;
 		uint8_t cal_checksum = 0;
-		uint32_t bytes_read = 0;
-
-		/* get record type and record length */
-		if (sscanf(&lpszLine[bytes_read], "S%1" SCNx32 "%2" SCNx32 , &record_type, &count) != 2)
+		uint8_t value;
+		uint8_t *data;
+
+		while ((p < end) && isspace((unsigned char)*p))
+			p++;
+		if (p == end)
+			break;
+
+		/* "S" type count(1) address(2..4) data(...) checksum(1);
+		 * count covers the address, data and checksum bytes
+		 */
+		if ((end - p < 4) || (*p != 'S')
+				|| !image_hex_digit[(uint8_t)p[1]]
+				|| !image_hex_decode(p + 2, &value, 1, &cal_checksum))
 		{
 			return ERROR_IMAGE_FORMAT_ERROR;
 		}
-
-		bytes_read += 4;
-		cal_checksum += (uint8_t)count;
-
-		/* skip checksum byte */
-		count -=1;
-
-		if (record_type == 0)
+		record_type = image_hex_digit[(uint8_t)p[1]] - 1;
+		count = value;
+		if ((size_t)(end - p) < 4 + 2 * count)
 		{
-			/* S0 - starting record (optional) */
-			int iValue;
-
-			while (count-- > 0) {
-				sscanf(&lpszLine[bytes_read], "%2x", &iValue);
-				cal_checksum += (uint8_t)iValue;
-				bytes_read += 2;
-			}
+			return ERROR_IMAGE_FORMAT_ERROR;
 		}
-		else if (record_type >= 1 && record_type <= 3)
+
+		if (record_type >= 7 && record_type <= 9)
 		{
-			switch (record_type)
-			{
-				case 1:
-					/* S1 - 16 bit address data record */
-					sscanf(&lpszLine[bytes_read], "%4" SCNx32, &address);
-					cal_checksum += (uint8_t)(address >> 8);
-					cal_checksum += (uint8_t)address;
-					bytes_read += 4;
-					count -=2;
-					break;
-
-				case 2:
-					/* S2 - 24 bit address data record */
-					sscanf(&lpszLine[bytes_read], "%6" SCNx32 , &address);
-					cal_checksum += (uint8_t)(address >> 16);
-					cal_checksum += (uint8_t)(address >> 8);
-					cal_checksum += (uint8_t)address;
-					bytes_read += 6;
-					count -=3;
-					break;
-
-				case 3:
-					/* S3 - 32 bit address data record */
-					sscanf(&lpszLine[bytes_read], "%8" SCNx32 , &address);
-					cal_checksum += (uint8_t)(address >> 24);
-					cal_checksum += (uint8_t)(address >> 16);
-					cal_checksum += (uint8_t)(address >> 8);
-					cal_checksum += (uint8_t)address;
-					bytes_read += 8;
-					count -=4;
-					break;
+			/* S7, S8, S9 - ending records for 32, 24 and 16bit */
+			return ERROR_OK;
+		}
 
-			}
+		switch (record_type)
+		{
+			case 1:
+				/* S1 - 16 bit address data record */
+				address_bytes = 2;
+				break;
+			case 2:
+				/* S2 - 24 bit address data record */
+				address_bytes = 3;
+				break;
+			case 3:
+				/* S3 - 32 bit address data record */
+				address_bytes = 4;
+				break;
+			case 0:
+				/* S0 - starting record (optional) */
+			case 5:
+				/* S5 is the data count record, we ignore it */
+				address_bytes = 0;
+				break;
+			default:
+				LOG_ERROR("unhandled S19 record type: %i", (int)(record_type));
+				return ERROR_IMAGE_FORMAT_ERROR;
+		}
 
-			if (full_address != address)
-			{
-				/* we encountered a nonconsecutive location, create a new section,
-				 * unless the current section has zero size, in which case this specifies
-				 * the current section's base address
-				 */
-				if (section[image->num_sections].size != 0)
-				{
-					image->num_sections++;
-					section[image->num_sections].size = 0x0;
-					section[image->num_sections].flags = 0;
-					section[image->num_sections].private = &mot->buffer[cooked_bytes];
-				}
-				section[image->num_sections].base_address = address;
-				full_address = address;
-			}
+		/* skip checksum byte */
+		if (count < address_bytes + 1)
+			return ERROR_IMAGE_FORMAT_ERROR;
+		count -= address_bytes + 1;
+		p += 4;
 
-			while (count-- > 0)
-			{
-				unsigned value;
-				sscanf(&lpszLine[bytes_read], "%2x", &value);
-				mot->buffer[cooked_bytes] = (uint8_t)value;
-				cal_checksum += (uint8_t)mot->buffer[cooked_bytes];
-				bytes_read += 2;
-				cooked_bytes += 1;
-				section[image->num_sections].size += 1;
-				full_address++;
-			}
-		}
-		else if (record_type == 5)
+		if (address_bytes)
 		{
-			/* S5 is the data count record, we ignore it */
-			uint32_t dummy;
+			if (!image_hex_decode(p, record, address_bytes, &cal_checksum))
+				return ERROR_IMAGE_FORMAT_ERROR;
+			p += 2 * address_bytes;
 
-			while (count-- > 0)
-			{
-				sscanf(&lpszLine[bytes_read], "%2" SCNx32 , &dummy);
-				cal_checksum += (uint8_t)dummy;
-				bytes_read += 2;
-			}
-		}
-		else if (record_type >= 7 && record_type <= 9)
-		{
-			/* S7, S8, S9 - ending records for 32, 24 and 16bit */
-			image->num_sections++;
+			address = 0;
+			for (uint32_t i = 0; i < address_bytes; i++)
+				address = (address << 8) | record[i];
 
-			/* copy section information */
-			image->sections = malloc(sizeof(struct imagesection) * image->num_sections);
-			for (i = 0; i < image->num_sections; i++)
+			if (parser->full_address != address)
 			{
-				image->sections[i].private = section[i].private;
-				image->sections[i].base_address = section[i].base_address;
-				image->sections[i].size = section[i].size;
-				image->sections[i].flags = section[i].flags;
+				/* we encountered a nonconsecutive location */
+				if (image_hex_parser_seek(parser, address) != ERROR_OK)
+					return ERROR_FAIL;
 			}
-
-			return ERROR_OK;
 		}
-		else
+
+		/* data records are decoded straight into the image buffer */
+		data = address_bytes ? &parser->buffer[parser->cooked_bytes] : record;
+		if (!image_hex_decode(p, data, count, &cal_checksum)
+				|| !image_hex_decode(p + 2 * count, &value, 1,
+					&cal_checksum))
 		{
-		  LOG_ERROR("unhandled S19 record type: %i", (int)(record_type));
 			return ERROR_IMAGE_FORMAT_ERROR;
 		}
+		p += 2 * count + 2;
 
 		/* account for checksum, will always be 0xFF */
-		sscanf(&lpszLine[bytes_read], "%2" SCNx32 , &checksum);
-		cal_checksum += (uint8_t)checksum;
-		bytes_read += 2;
-
 		if (cal_checksum != 0xFF)
 		{
 			/* checksum failed */
 			LOG_ERROR("incorrect record checksum found in S19 file");
 			return ERROR_IMAGE_CHECKSUM;
 		}
+
+		if (address_bytes)
+		{
+			parser->cooked_bytes += count;
+			parser->sections[parser->num_sections].size += count;
+			parser->full_address += count;
+		}
+
+		/* ignore anything else on the line */
+		while ((p < end) && (*p != '\n'))
+			p++;
 	}
 
 	LOG_ERROR("premature end of S19 file, no end-of-file record found");
@@ -707,30 +734,25 @@ static int image_mot_buffer_complete_inner(struct image *image, char *lpszLine,
 }
 
 /**
- * Allocate memory dynamically instead of on the stack. This
- * is important w/embedded hosts.
+ * Decode a whole S19 file the same way as an IHEX file.
  */
 static int image_mot_buffer_complete(struct image *image)
 {
-	char *lpszLine = malloc(1023);
-	if (lpszLine == NULL)
-	{
-		LOG_ERROR("Out of memory");
-		return ERROR_FAIL;
-	}
-	struct imagesection *section = malloc(sizeof(struct imagesection) * IMAGE_MAX_SECTIONS);
-	if (section == NULL)
-	{
-		free(lpszLine);
-		LOG_ERROR("Out of memory");
-		return ERROR_FAIL;
-	}
+	struct image_mot *mot = image->type_private;
+	struct image_hex_parser parser;
+	uint8_t *copy;
 	int retval;
 
-	retval = image_mot_buffer_complete_inner(image, lpszLine, section);
+	mot->buffer = NULL;
 
-	free(section);
-	free(lpszLine);
+	retval = image_hex_parser_init(&parser, &mot->fileio, &copy);
+	if (retval == ERROR_OK)
+		retval = image_mot_buffer_complete_inner(&parser);
+	if (retval == ERROR_OK)
+		image_hex_parser_finish(&parser, image, &mot->buffer);
+
+	image_hex_parser_cleanup(&parser);
+	free(copy);
 
 	return retval;
 }
@@ -971,6 +993,80 @@ int image_read_section(struct image *image, int section, uint32_t offset, uint32
 	return ERROR_OK;
 }
 
+int image_section_data(struct image *image, int section,
+		const uint8_t **data, uint8_t **copy)
+{
+	const uint8_t *file;
+	int filesize;
+	int retval;
+
+	*copy = NULL;
+
+	switch (image->type)
+	{
+	case IMAGE_BINARY:
+	{
+		struct image_binary *image_binary = image->type_private;
+
+		if (fileio_map(&image_binary->fileio, &file) == ERROR_OK)
+		{
+			*data = file;
+			return ERROR_OK;
+		}
+		break;
+	}
+	case IMAGE_ELF:
+	{
+		struct image_elf *elf = image->type_private;
+		Elf32_Phdr *segment = image->sections[section].private;
+		uint32_t offset = field32(elf, segment->p_offset);
+
+		/* sections are exactly the file data of their segment */
+		if ((fileio_map(&elf->fileio, &file) == ERROR_OK)
+				&& (fileio_size(&elf->fileio, &filesize) == ERROR_OK)
+				&& (offset <= (uint32_t)filesize)
+				&& (image->sections[section].size
+					<= (uint32_t)filesize - offset))
+		{
+			*data = file + offset;
+			return ERROR_OK;
+		}
+		break;
+	}
+	case IMAGE_IHEX:
+	case IMAGE_SRECORD:
+	case IMAGE_BUILDER:
+		/* already buffered in memory */
+		*data = image->sections[section].private;
+		return ERROR_OK;
+	default:
+		break;
+	}
+
+	uint8_t *buffer = malloc(image->sections[section].size);
+	if (buffer == NULL)
+	{
+		LOG_ERROR("error allocating buffer for section (%d bytes)",
+				(int)(image->sections[section].size));
+		return ERROR_FAIL;
+	}
+
+	size_t size_read;
+	retval = image_read_section(image, section, 0x0,
+			image->sections[section].size, buffer, &size_read);
+	if ((retval == ERROR_OK) && (size_read != image->sections[section].size))
+		retval = ERROR_FILEIO_OPERATION_FAILED;
+	if (retval != ERROR_OK)
+	{
+		free(buffer);
+		return retval;
+	}
+
+	*data = buffer;
+	*copy = buffer;
+	return ERROR_OK;
+}
+
 int image_add_section(struct image *image, uint32_t base, uint32_t size, int flags, uint8_t *data)
 {
 	struct imagesection *section;
@@ -1092,7 +1188,7 @@ void image_close(struct image *image)
 	}
 }
 
-int image_calculate_checksum(uint8_t* buffer, uint32_t nbytes, uint32_t* checksum)
+int image_calculate_checksum(const uint8_t* buffer, uint32_t nbytes, uint32_t* checksum)
 {
 	uint32_t crc = 0xffffffff;
 	LOG_DEBUG("Calculating checksum");
@@ -1137,3 +1233,215 @@ int image_calculate_checksum(uint8_t* buffer, uint32_t nbytes, uint32_t* checksu
 	*checksum = crc;
 	return ERROR_OK;
 }
+
+void image_plan_init(struct image_plan *plan)
+{
+	memset(plan, 0, sizeof(*plan));
+	plan->max_address = 0xffffffff;
+	plan->pad = 0xff;
+}
+
+static int image_plan_compare(const void *a, const void *b)
+{
+	const struct imagesection *s1 = *(const struct imagesection **)a;
+	const struct imagesection *s2 = *(const struct imagesection **)b;
+
+	if (s1->base_address != s2->base_address)
+		return (s1->base_address > s2->base_address) ? 1 : -1;
+	/* keep overlapping sections in image order */
+	return (s1 > s2) ? 1 : (s1 < s2) ? -1 : 0;
+}
+
+/* clip a section to the plan's range; false if nothing is left */
+static bool image_plan_clip(struct image_plan *plan,
+		const struct imagesection *section, uint64_t *start, uint64_t *end)
+{
+	*start = MAX((uint64_t)section->base_address, plan->min_address);
+	*end = MIN((uint64_t)section->base_address + section->size,
+			(uint64_t)plan->max_address + 1);
+	return *start < *end;
+}
+
+int image_plan_build(struct image *image, struct image_plan *plan)
+{
+	struct imagesection **sorted;
+	struct image_run *run = NULL;
+	uint64_t run_end = 0;
+	int i;
+
+	plan->order = NULL;
+	plan->runs = NULL;
+	plan->num_order = 0;
+	plan->num_runs = 0;
+
+	if (image->num_sections == 0)
+		return ERROR_OK;
+
+	sorted = malloc(sizeof(*sorted) * image->num_sections);
+	plan->order = malloc(sizeof(*plan->order) * image->num_sections);
+	plan->runs = malloc(sizeof(*plan->runs) * image->num_sections);
+	if ((sorted == NULL) || (plan->order == NULL) || (plan->runs == NULL))
+	{
+		free(sorted);
+		image_plan_free(plan);
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	for (i = 0; i < image->num_sections; i++)
+	{
+		if (image->sections[i].size != 0)
+			sorted[plan->num_order++] = &image->sections[i];
+	}
+	qsort(sorted, plan->num_order, sizeof(*sorted), image_plan_compare);
+
+	for (i = 0; i < plan->num_order; i++)
+	{
+		uint64_t start, end;
+
+		plan->order[i] = sorted[i] - image->sections;
+		if (!image_plan_clip(plan, sorted[i], &start, &end))
+			continue;
+
+		if ((run != NULL) && (start <= run_end + plan->max_gap))
+		{
+			/* join the current run */
+			run->count = i - run->first + 1;
+			if (end > run_end)
+				run_end = end;
+		}
+		else
+		{
+			run = &plan->runs[plan->num_runs++];
+			run->base_address = start;
+			run->first = i;
+			run->count = 1;
+			run_end = end;
+		}
+		run->size = run_end - run->base_address;
+	}
+
+	free(sorted);
+
+	LOG_DEBUG("%d image sections planned as %d runs",
+			plan->num_order, plan->num_runs);
+	return ERROR_OK;
+}
+
+static int image_plan_fill(struct image_plan *plan, uint32_t address,
+		uint32_t size, uint8_t *buffer)
+{
+	if (plan->read_gap)
+		return plan->read_gap(plan->priv, address, size, buffer);
+
+	memset(buffer, plan->pad, size);
+	return ERROR_OK;
+}
+
+int image_plan_read(struct image *image, struct image_plan *plan,
+		uint32_t address, uint32_t size, uint8_t *buffer)
+{
+	uint64_t end = (uint64_t)address + size;
+	uint64_t done = address;
+	int retval;
+	int lo = 0, hi = plan->num_runs;
+	int i;
+
+	/* find the first run which isn't entirely below the range */
+	while (lo < hi)
+	{
+		int mid = (lo + hi) / 2;
+		struct image_run *run = &plan->runs[mid];
+
+		if ((uint64_t)run->base_address + run->size <= address)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	for (i = (lo < plan->num_runs) ? plan->runs[lo].first : plan->num_order;
+			i < plan->num_order; i++)
+	{
+		struct imagesection *section = &image->sections[plan->order[i]];
+		uint64_t start, stop;
+		size_t size_read;
+
+		if (section->base_address >= end)
+			break;
+		if (!image_plan_clip(plan, section, &start, &stop))
+			continue;
+		start = MAX(start, (uint64_t)address);
+		stop = MIN(stop, end);
+		if (start >= stop)
+			continue;
+
+		if (start > done)
+		{
+			retval = image_plan_fill(plan, done, start - done,
+					buffer + (done - address));
+			if (retval != ERROR_OK)
+				return retval;
+		}
+
+		retval = image_read_section(image, plan->order[i],
+				start - section->base_address, stop - start,
+				buffer + (start - address), &size_read);
+		if (retval != ERROR_OK)
+			return retval;
+		if (size_read != stop - start)
+			return ERROR_FILEIO_OPERATION_FAILED;
+
+		if (stop > done)
+			done = stop;
+	}
+
+	if (done < end)
+		return image_plan_fill(plan, done, end - done,
+				buffer + (done - address));
+
+	return ERROR_OK;
+}
+
+int image_plan_data(struct image *image, struct image_plan *plan,
+		const struct image_run *run, const uint8_t **data, uint8_t **copy)
+{
+	int retval;
+
+	if (run->count == 1)
+	{
+		int section = plan->order[run->first];
+
+		/* an unclipped single section can usually be used in place */
+		if (run->size == image->sections[section].size)
+			return image_section_data(image, section, data, copy);
+	}
+
+	*copy = malloc(run->size);
+	if (*copy == NULL)
+	{
+		LOG_ERROR("error allocating buffer for image data (%d bytes)",
+				(int)run->size);
+		return ERROR_FAIL;
+	}
+
+	retval = image_plan_read(image, plan, run->base_address, run->size, *copy);
+	if (retval != ERROR_OK)
+	{
+		free(*copy);
+		*copy = NULL;
+		return retval;
+	}
+
+	*data = *copy;
+	return ERROR_OK;
+}
+
+void image_plan_free(struct image_plan *plan)
+{
+	free(plan->order);
+	plan->order = NULL;
+	free(plan->runs);
+	plan->runs = NULL;
+	plan->num_order = 0;
+	plan->num_runs = 0;
+}
@@ -33,7 +33,6 @@
 #endif
 
 #define IMAGE_MAX_ERROR_STRING		(256)
-#define IMAGE_MAX_SECTIONS			(512)
 
 #define IMAGE_MEMORY_CACHE_SIZE		(2048)
 
@@ -103,14 +102,87 @@ struct image_mot
 int image_open(struct image *image, const char *url, const char *type_string);
 int image_read_section(struct image *image, int section, uint32_t offset,
 		uint32_t size, uint8_t *buffer, size_t *size_read);
+/**
+ * Get all of a section's data.  Plain binary and ELF files are mapped
+ * and used in place, and other images' buffered sections are returned
+ * directly; only sections which can't be referenced that way (e.g.
+ * memory images, or hosts without mmap()) are read into a new buffer.
+ * @param data Set to the section data; valid until image_close().
+ * @param copy Set to that new buffer, which the caller must free(),
+ *	or NULL if no copy was made.
+ */
+int image_section_data(struct image *image, int section,
+		const uint8_t **data, uint8_t **copy);
 void image_close(struct image *image);
 
 int image_add_section(struct image *image, uint32_t base, uint32_t size,
 		int flags, uint8_t *data);
 
-int image_calculate_checksum(uint8_t* buffer, uint32_t nbytes,
+int image_calculate_checksum(const uint8_t* buffer, uint32_t nbytes,
 		uint32_t* checksum);
 
+/**
+ * A range of image data to transfer in one piece: the sections
+ * image_plan.order[first] to [first + count - 1], clipped to the
+ * plan's address range, and the gaps between them.
+ */
+struct image_run
+{
+	uint32_t base_address;
+	uint32_t size;
+	int first;
+	int count;
+};
+
+/**
+ * Image planner.  Many images (ELF files with lots of program headers,
+ * images built from GDB packets) have many small sections; the planner
+ * sorts them by address and joins those which are adjacent, or close
+ * enough, into runs, so each run can be written with one transfer.
+ *
+ * Set up the parameters with image_plan_init() and adjust them, call
+ * image_plan_build(), get each run's data with image_plan_data() or
+ * image_plan_read(), and finally call image_plan_free().
+ */
+struct image_plan
+{
+	/** lowest and highest address to include; others are clipped */
+	uint32_t min_address;
+	uint32_t max_address;
+	/** sections at most this many bytes apart share a run */
+	uint32_t max_gap;
+	/** value for bytes in gaps, unless read_gap is set */
+	uint8_t pad;
+	/** if set, fills gaps instead, e.g. with current memory contents */
+	int (*read_gap)(void *priv, uint32_t address, uint32_t size,
+			uint8_t *buffer);
+	void *priv;
+
+	/** the image's non-empty sections, sorted by address */
+	int *order;
+	int num_order;
+	/** runs, sorted by address */
+	struct image_run *runs;
+	int num_runs;
+};
+
+/// Set up a plan which includes all addresses and joins only adjacent sections.
+void image_plan_init(struct image_plan *plan);
+int image_plan_build(struct image *image, struct image_plan *plan);
+/**
+ * Read image data for an address range, which may extend beyond the
+ * runs; anything not in a section is a gap.
+ */
+int image_plan_read(struct image *image, struct image_plan *plan,
+		uint32_t address, uint32_t size, uint8_t *buffer);
+/**
+ * Get all of a run's data, like image_section_data(); runs made of
+ * just one section are used in place where possible.
+ */
+int image_plan_data(struct image *image, struct image_plan *plan,
+		const struct image_run *run, const uint8_t **data, uint8_t **copy);
+void image_plan_free(struct image_plan *plan);
+
 #define ERROR_IMAGE_FORMAT_ERROR	(-1400)
 #define ERROR_IMAGE_TYPE_UNKNOWN	(-1401)
 #define ERROR_IMAGE_TEMPORARILY_UNAVAILABLE		(-1402)
@@ -39,6 +39,8 @@
 #include "config.h"
 #endif
 
+#include <helper/event_trace.h>
+#include <helper/startup_profile.h>
 #include <helper/time_support.h>
 #include <jtag/jtag.h>
 #include <flash/nor/core.h>
@@ -112,8 +114,20 @@ static struct target_type *target_types[] =
 
 struct target *all_targets = NULL;
 static struct target_event_callback *target_event_callbacks = NULL;
-static struct target_timer_callback *target_timer_callbacks = NULL;
+/* timer callbacks form a binary min-heap ordered by deadline */
+static struct target_timer_callback **target_timer_heap = NULL;
+static int target_timer_count = 0;
+static int target_timer_size = 0;
 static const int polling_interval = 100;
+/* a running target's polling interval backs off to at most this many
+ * times its configured -poll-interval */
+static const int polling_backoff_max = 4;
+/* longest -poll-interval accepted, one hour; keeps the backed off
+ * interval well within an int */
+static const int polling_interval_max = 60 * 60 * 1000;
+/* period handle_target() is registered with, 0 until target_init() */
+static int polling_tick = 0;
+static Jim_Interp *polling_interp = NULL;
 
 static const Jim_Nvp nvp_assert[] = {
 	{ .name = "assert", NVP_ASSERT },
@@ -458,6 +472,7 @@ int target_halt(struct target *target)
 
 	target->halt_issued = true;
 	target->halt_issued_time = timeval_ms();
+	target_poll_reset(target);
 
 	return ERROR_OK;
 }
@@ -510,6 +525,8 @@ int target_resume(struct target *target, int current, uint32_t address, int hand
 	if ((retval = target->type->resume(target, current, address, handle_breakpoints, debug_execution)) != ERROR_OK)
 		return retval;
 
+	target_poll_reset(target);
+
 	return retval;
 }
 
@@ -614,7 +631,11 @@ int target_examine(void)
 					target);
 			continue;
 		}
-		if ((retval = target_examine_one(target)) != ERROR_OK)
+		struct startup_profile_span span;
+		startup_profile_begin(&span);
+		retval = target_examine_one(target);
+		startup_profile_end(&span, "examine", target_name(target));
+		if (retval != ERROR_OK)
 			return retval;
 	}
 	return retval;
@@ -769,6 +790,7 @@ int target_get_gdb_reg_list(struct target *target,
 int target_step(struct target *target,
 		int current, uint32_t address, int handle_breakpoints)
 {
+	target_poll_reset(target);
 	return target->type->step(target, current, address, handle_breakpoints);
 }
 
@@ -799,6 +821,38 @@ err_write_phys_memory(struct target *target, uint32_t address,
 }
 
 static int handle_target(void *priv);
+static int target_unregister_timer_callback(int (*callback)(void *priv), void *priv);
+
+/* Background polling runs at the shortest -poll-interval of all targets;
+ * handle_target() then skips the targets which aren't due yet. */
+static int target_update_polling_tick(void)
+{
+	if (polling_interp == NULL)
+		return ERROR_OK;
+
+	int tick = polling_interval;
+	for (struct target *target = all_targets; target; target = target->next)
+	{
+		if (target->poll_interval < tick)
+			tick = target->poll_interval;
+	}
+
+	if (tick == polling_tick)
+		return ERROR_OK;
+
+	if (polling_tick)
+		target_unregister_timer_callback(&handle_target, polling_interp);
+	polling_tick = tick;
+	return target_register_timer_callback(&handle_target,
+			polling_tick, 1, polling_interp, "poll");
+}
+
+/* poll soon, e.g. because the target was just resumed or halted */
+void target_poll_reset(struct target *target)
+{
+	target->poll_backoff = target->poll_interval;
+	target->poll_next = timeval_ms() + target->poll_interval;
+}
 
 static int target_init_one(struct command_context *cmd_ctx,
 		struct target *target)
@@ -905,8 +959,8 @@ static int target_init(struct command_context *cmd_ctx)
 	if (ERROR_OK != retval)
 		return retval;
 
-	retval = target_register_timer_callback(&handle_target,
-			polling_interval, 1, cmd_ctx->interp);
+	polling_interp = cmd_ctx->interp;
+	retval = target_update_polling_tick();
 	if (ERROR_OK != retval)
 		return retval;
 
@@ -954,42 +1008,112 @@ int target_register_event_callback(int (*callback)(struct target *target, enum t
 	return ERROR_OK;
 }
 
-int target_register_timer_callback(int (*callback)(void *priv), int time_ms, int periodic, void *priv)
+static bool target_timer_before(const struct timeval *a, const struct timeval *b)
 {
-	struct target_timer_callback **callbacks_p = &target_timer_callbacks;
-	struct timeval now;
+	return (a->tv_sec < b->tv_sec)
+		|| ((a->tv_sec == b->tv_sec) && (a->tv_usec < b->tv_usec));
+}
 
-	if (callback == NULL)
+static void target_timer_heap_set(int i, struct target_timer_callback *cb)
+{
+	target_timer_heap[i] = cb;
+	cb->heap_index = i;
+}
+
+static void target_timer_heap_up(int i)
+{
+	struct target_timer_callback *cb = target_timer_heap[i];
+	while (i > 0)
 	{
-		return ERROR_INVALID_ARGUMENTS;
+		int parent = (i - 1) / 2;
+		if (!target_timer_before(&cb->when, &target_timer_heap[parent]->when))
+			break;
+		target_timer_heap_set(i, target_timer_heap[parent]);
+		i = parent;
 	}
+	target_timer_heap_set(i, cb);
+}
 
-	if (*callbacks_p)
+static void target_timer_heap_down(int i)
+{
+	struct target_timer_callback *cb = target_timer_heap[i];
+	for (;;)
 	{
-		while ((*callbacks_p)->next)
-			callbacks_p = &((*callbacks_p)->next);
-		callbacks_p = &((*callbacks_p)->next);
+		int child = 2 * i + 1;
+		if (child >= target_timer_count)
+			break;
+		if ((child + 1 < target_timer_count)
+				&& target_timer_before(&target_timer_heap[child + 1]->when,
+						&target_timer_heap[child]->when))
+			child++;
+		if (!target_timer_before(&target_timer_heap[child]->when, &cb->when))
+			break;
+		target_timer_heap_set(i, target_timer_heap[child]);
+		i = child;
 	}
+	target_timer_heap_set(i, cb);
+}
 
-	(*callbacks_p) = malloc(sizeof(struct target_timer_callback));
-	(*callbacks_p)->callback = callback;
-	(*callbacks_p)->periodic = periodic;
-	(*callbacks_p)->time_ms = time_ms;
+static int target_timer_heap_insert(struct target_timer_callback *cb)
+{
+	if (target_timer_count == target_timer_size)
+	{
+		int size = target_timer_size ? target_timer_size * 2 : 16;
+		struct target_timer_callback **heap;
+		heap = realloc(target_timer_heap, size * sizeof(*heap));
+		if (heap == NULL)
+			return ERROR_FAIL;
+		target_timer_heap = heap;
+		target_timer_size = size;
+	}
 
-	gettimeofday(&now, NULL);
-	(*callbacks_p)->when.tv_usec = now.tv_usec + (time_ms % 1000) * 1000;
-	time_ms -= (time_ms % 1000);
-	(*callbacks_p)->when.tv_sec = now.tv_sec + (time_ms / 1000);
-	if ((*callbacks_p)->when.tv_usec > 1000000)
+	target_timer_heap_set(target_timer_count++, cb);
+	target_timer_heap_up(cb->heap_index);
+	return ERROR_OK;
+}
+
+static void target_timer_heap_remove(struct target_timer_callback *cb)
+{
+	int i = cb->heap_index;
+	struct target_timer_callback *last = target_timer_heap[--target_timer_count];
+
+	cb->heap_index = -1;
+	if (last == cb)
+		return;
+
+	target_timer_heap_set(i, last);
+	target_timer_heap_up(i);
+	target_timer_heap_down(last->heap_index);
+}
+
+int target_register_timer_callback(int (*callback)(void *priv), int time_ms,
+		int periodic, void *priv, const char *name)
+{
+	struct target_timer_callback *cb;
+	struct timeval now;
+
+	if (callback == NULL)
 	{
-		(*callbacks_p)->when.tv_usec = (*callbacks_p)->when.tv_usec - 1000000;
-		(*callbacks_p)->when.tv_sec += 1;
+		return ERROR_INVALID_ARGUMENTS;
 	}
 
-	(*callbacks_p)->priv = priv;
-	(*callbacks_p)->next = NULL;
+	cb = calloc(1, sizeof(struct target_timer_callback));
+	if (cb == NULL)
+		return ERROR_FAIL;
+	cb->callback = callback;
+	cb->name = name;
+	cb->periodic = periodic;
+	cb->time_ms = time_ms;
+	cb->priv = priv;
 
-	return ERROR_OK;
+	gettimeofday(&now, NULL);
+	cb->when = now;
+	timeval_add_time(&cb->when, time_ms / 1000, (time_ms % 1000) * 1000);
+
+	int retval = target_timer_heap_insert(cb);
+	if (retval != ERROR_OK)
+		free(cb);
+	return retval;
 }
 
 int target_unregister_event_callback(int (*callback)(struct target *target, enum target_event event, void *priv), void *priv)
@@ -1021,26 +1145,24 @@ int target_unregister_event_callback(int (*callback)(struct target *target, enum
 
 static int target_unregister_timer_callback(int (*callback)(void *priv), void *priv)
 {
-	struct target_timer_callback **p = &target_timer_callbacks;
-	struct target_timer_callback *c = target_timer_callbacks;
-
 	if (callback == NULL)
 	{
 		return ERROR_INVALID_ARGUMENTS;
 	}
 
-	while (c)
+	for (int i = 0; i < target_timer_count; i++)
 	{
-		struct target_timer_callback *next = c->next;
+		struct target_timer_callback *c = target_timer_heap[i];
 		if ((c->callback == callback) && (c->priv == priv))
 		{
-			*p = next;
-			free(c);
+			target_timer_heap_remove(c);
+			/* a callback may unregister itself while it runs */
+			if (c->running)
+				c->removed = true;
+			else
+				free(c);
 			return ERROR_OK;
 		}
-		else
-			p = &(c->next);
-		c = next;
 	}
 
 	return ERROR_OK;
@@ -1061,6 +1183,9 @@ int target_call_event_callbacks(struct target *target, enum target_event event)
 			  event,
 			  Jim_Nvp_value2name_simple(nvp_target_event, event)->name);
 
+	EVENT_TRACE(EVENT_TRACE_TARGET_EVENT, 0,
+			target->target_number, 0, event);
+
 	target_handle_event(target, event);
 
 	while (callback)
@@ -1073,30 +1198,50 @@ int target_call_event_callbacks(struct target *target, enum target_event event)
 	return ERROR_OK;
 }
 
-static int target_timer_callback_periodic_restart(
-		struct target_timer_callback *cb, struct timeval *now)
+static int target_call_timer_callback(struct target_timer_callback *cb,
+		struct timeval *now)
 {
-	int time_ms = cb->time_ms;
-	cb->when.tv_usec = now->tv_usec + (time_ms % 1000) * 1000;
-	time_ms -= (time_ms % 1000);
-	cb->when.tv_sec = now->tv_sec + time_ms / 1000;
-	if (cb->when.tv_usec > 1000000)
+	/* Periodic callbacks are rescheduled before being called, so that a
+	 * recursive target_call_timer_callbacks() does not run them again.
+	 * The next deadline is relative to the previous one, not to "now",
+	 * so the period doesn't drift; but if we fell behind by a whole
+	 * period, missed ticks are skipped rather than run in a burst. */
+	if (cb->periodic)
 	{
-		cb->when.tv_usec = cb->when.tv_usec - 1000000;
-		cb->when.tv_sec += 1;
+		int time_ms = cb->time_ms > 0 ? cb->time_ms : 1;
+		timeval_add_time(&cb->when, time_ms / 1000, (time_ms % 1000) * 1000);
+		if (!target_timer_before(now, &cb->when))
+		{
+			cb->when = *now;
+			timeval_add_time(&cb->when, time_ms / 1000, (time_ms % 1000) * 1000);
+		}
+		int retval = target_timer_heap_insert(cb);
+		if (retval != ERROR_OK)
+		{
+			free(cb);
+			return retval;
+		}
 	}
-	return ERROR_OK;
-}
 
-static int target_call_timer_callback(struct target_timer_callback *cb,
-		struct timeval *now)
-{
+	struct timeval start, end, elapsed;
+	gettimeofday(&start, NULL);
+
+	cb->running++;
 	cb->callback(cb->priv);
+	cb->running--;
 
-	if (cb->periodic)
-		return target_timer_callback_periodic_restart(cb, now);
+	gettimeofday(&end, NULL);
+	timeval_subtract(&elapsed, &end, &start);
+	int64_t us = (int64_t)elapsed.tv_sec * 1000000 + elapsed.tv_usec;
+	cb->calls++;
+	cb->total_us += us;
+	if (us > cb->max_us)
+		cb->max_us = us;
+
+	if ((!cb->periodic || cb->removed) && !cb->running)
+		free(cb);
 
-	return target_unregister_timer_callback(cb->callback, cb->priv);
+	return ERROR_OK;
 }
 
 static int target_call_timer_callbacks_check_time(int checktime)
@@ -1106,26 +1251,31 @@ static int target_call_timer_callbacks_check_time(int checktime)
 	struct timeval now;
 	gettimeofday(&now, NULL);
 
-	struct target_timer_callback *callback = target_timer_callbacks;
-	while (callback)
+	if (!checktime)
 	{
-		// cleaning up may unregister and free this callback
-		struct target_timer_callback *next_callback = callback->next;
-
-		bool call_it = callback->callback &&
-			((!checktime && callback->periodic) ||
-			  now.tv_sec > callback->when.tv_sec ||
-			 (now.tv_sec == callback->when.tv_sec &&
-			  now.tv_usec >= callback->when.tv_usec));
-
-		if (call_it)
+		/* make every periodic callback due right now, except those
+		 * we are being called from */
+		for (int i = 0; i < target_timer_count; i++)
 		{
-			int retval = target_call_timer_callback(callback, &now);
-			if (retval != ERROR_OK)
-				return retval;
+			struct target_timer_callback *cb = target_timer_heap[i];
+			if (cb->periodic && !cb->running)
+				cb->when = now;
 		}
+		for (int i = target_timer_count / 2 - 1; i >= 0; i--)
+			target_timer_heap_down(i);
+	}
 
-		callback = next_callback;
+	while (target_timer_count > 0)
+	{
+		struct target_timer_callback *callback = target_timer_heap[0];
+		if (target_timer_before(&now, &callback->when))
+			break;
+
+		target_timer_heap_remove(callback);
+
+		int retval = target_call_timer_callback(callback, &now);
+		if (retval != ERROR_OK)
+			return retval;
 	}
 
 	return ERROR_OK;
@@ -1142,6 +1292,27 @@ int target_call_timer_callbacks_now(void)
 	return target_call_timer_callbacks_check_time(0);
 }
 
+int target_timer_next_event_ms(void)
+{
+	if (target_timer_count == 0)
+		return -1;
+
+	struct timeval now;
+	gettimeofday(&now, NULL);
+
+	struct target_timer_callback *callback = target_timer_heap[0];
+	long long us = (long long)(callback->when.tv_sec - now.tv_sec) * 1000000
+		+ (callback->when.tv_usec - now.tv_usec);
+	if (us <= 0)
+		return 0;
+
+	/* round up, so we never wake up just before the deadline */
+	long long ms = (us + 999) / 1000;
+	if (ms > INT_MAX)
+		ms = INT_MAX;
+	return ms;
+}
+
 int target_alloc_working_area_try(struct target *target, uint32_t size, struct working_area **area)
 {
 	struct working_area *c = target->working_areas;
@@ -1569,6 +1740,41 @@ int target_checksum_memory(struct target *target, uint32_t address, uint32_t siz
 	return retval;
 }
 
+int target_checksum_memory_blocks(struct target *target,
+		struct target_memory_check_block *blocks, unsigned num_blocks)
+{
+	int retval;
+	unsigned i;
+
+	if (!target_was_examined(target))
+	{
+		LOG_ERROR("Target not examined yet");
+		return ERROR_FAIL;
+	}
+
+	if (num_blocks == 0)
+		return ERROR_OK;
+
+	if (target->type->checksum_memory_blocks)
+	{
+		retval = target->type->checksum_memory_blocks(target,
+				blocks, num_blocks);
+		if (retval == ERROR_OK)
+			return ERROR_OK;
+		LOG_DEBUG("batched checksum failed, checksumming blocks one by one");
+	}
+
+	for (i = 0; i < num_blocks; i++)
+	{
+		retval = target_checksum_memory(target, blocks[i].address,
+				blocks[i].size, &blocks[i].result);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	return ERROR_OK;
+}
+
 int target_blank_check_memory(struct target *target, uint32_t address, uint32_t size, uint32_t* blank)
 {
 	int retval;
@@ -1942,16 +2148,51 @@ static int handle_target(void *priv)
 		/* only poll target if we've got power and srst isn't asserted */
 		if (!powerDropout && !srstAsserted)
 		{
+			/* the timer wakes us up a little early or late; a target
+			 * due within half a tick is polled now rather than a
+			 * whole tick later */
+			long long now = timeval_ms();
+			if (now + polling_tick / 2 < target->poll_next)
+				continue;
+
+			struct duration bench;
+			duration_start(&bench);
+
 			/* polling may fail silently until the target has been examined */
-			if ((retval = target_poll(target)) != ERROR_OK)
+			retval = target_poll(target);
+
+			duration_measure(&bench);
+			target->poll_count++;
+			target->poll_total_us += bench.elapsed.tv_sec * 1000000LL
+				+ bench.elapsed.tv_usec;
+
+			/* A target which keeps running is polled less and less often,
+			 * leaving the adapter to the others; any other state goes
+			 * back to the configured interval. */
+			if ((target->state == TARGET_RUNNING) && !target->halt_issued)
+			{
+				if (target->poll_backoff < polling_backoff_max * target->poll_interval)
+					target->poll_backoff *= 2;
+			}
+			else
+				target->poll_backoff = target->poll_interval;
+
+			/* Schedule from when this poll was due, not from when it
+			 * actually ran, so wake-up jitter doesn't add up; but don't
+			 * try to catch up on polls missed while we were busy. */
+			target->poll_next += target->poll_backoff;
+			if (target->poll_next <= now)
+				target->poll_next = now + target->poll_backoff;
+
+			if (retval != ERROR_OK)
 			{
-				/* 100ms polling interval. Increase interval between polling up to 5000ms */
-				if (backoff_times * polling_interval < 5000)
+				/* Increase interval between polling up to 5000ms */
+				if (backoff_times * polling_tick < 5000)
 				{
 					backoff_times *= 2;
 					backoff_times++;
 				}
-				LOG_USER("Polling target failed, GDB will be halted. Polling again in %dms", backoff_times * polling_interval);
+				LOG_USER("Polling target failed, GDB will be halted. Polling again in %dms", backoff_times * polling_tick);
 
 				/* Tell GDB to halt the debugger. This allows the user to
 				 * run monitor commands to handle the situation.
@@ -2100,6 +2341,52 @@ COMMAND_HANDLER(handle_reg_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_timer_stats_command)
+{
+	if (CMD_ARGC == 1 && strcmp(CMD_ARGV[0], "reset") == 0)
+	{
+		for (int i = 0; i < target_timer_count; i++)
+		{
+			target_timer_heap[i]->calls = 0;
+			target_timer_heap[i]->total_us = 0;
+			target_timer_heap[i]->max_us = 0;
+		}
+		return ERROR_OK;
+	}
+	else if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	int next = target_timer_next_event_ms();
+	if (next >= 0)
+		command_print(CMD_CTX, "next timer callback due in %i ms", next);
+
+	for (int i = 0; i < target_timer_count; i++)
+	{
+		struct target_timer_callback *cb = target_timer_heap[i];
+		const char *owner = "";
+		struct target *target;
+
+		/* most callbacks are per target, say which one */
+		for (target = all_targets; target; target = target->next)
+		{
+			if (target == cb->priv)
+			{
+				owner = target_name(target);
+				break;
+			}
+		}
+
+		command_print(CMD_CTX, "%s%s%s every %i ms: %lu calls, "
+				"avg %lld us, max %lld us, total %lld ms",
+				cb->name ? cb->name : "(unnamed)",
+				*owner ? " " : "", owner, cb->time_ms, cb->calls,
+				(long long)(cb->calls ? cb->total_us / cb->calls : 0),
+				(long long)cb->max_us, (long long)(cb->total_us / 1000));
+	}
+
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(handle_poll_command)
 {
 	int retval = ERROR_OK;
@@ -2109,6 +2396,12 @@ COMMAND_HANDLER(handle_poll_command)
 	{
 		command_print(CMD_CTX, "background polling: %s",
 				jtag_poll_get_enabled() ? "on" : "off");
+		command_print(CMD_CTX, "polled every %d ms (currently %d ms), "
+				"%lu polls averaging %lld us",
+				target->poll_interval, target->poll_backoff,
+				target->poll_count, target->poll_count
+					? target->poll_total_us / (long long)target->poll_count
+					: 0);
 		command_print(CMD_CTX, "TAP: %s (%s)",
 				target->tap->dotted_name,
 				target->tap->enabled ? "enabled" : "disabled");
@@ -2187,6 +2480,8 @@ int target_wait_state(struct target *target, enum target_state state, int ms)
 		if (cur-then > 500)
 		{
 			keep_alive();
+			if ((retval = command_check_interrupt()) != ERROR_OK)
+				return retval;
 		}
 
 		if ((cur-then) > ms)
@@ -2557,13 +2852,14 @@ static COMMAND_HELPER(parse_load_image_command_CMD_ARGV, struct image *image,
 
 COMMAND_HANDLER(handle_load_image_command)
 {
-	uint8_t *buffer;
-	size_t buf_cnt;
+	const uint8_t *buffer;
+	uint8_t *copy;
 	uint32_t image_size;
 	uint32_t min_address = 0;
 	uint32_t max_address = 0xffffffff;
 	int i;
 	struct image image;
+	struct image_plan plan;
 
 	int retval = CALL_COMMAND_HANDLER(parse_load_image_command_CMD_ARGV,
 			&image, &min_address, &max_address);
@@ -2580,57 +2876,41 @@ COMMAND_HANDLER(handle_load_image_command)
 		return ERROR_OK;
 	}
 
+	/* write adjacent sections together; gaps are left alone, since
+	 * there's no telling what lives there in RAM */
+	image_plan_init(&plan);
+	plan.min_address = min_address;
+	plan.max_address = max_address - 1;
+	/* max_address is exclusive; an empty range (a size of zero) loads
+	 * nothing rather than wrapping around to the whole address space */
+	if (max_address != min_address)
+		retval = image_plan_build(&image, &plan);
+	if (retval != ERROR_OK)
+	{
+		image_close(&image);
+		return retval;
+	}
+
 	image_size = 0x0;
-	retval = ERROR_OK;
-	for (i = 0; i < image.num_sections; i++)
+	for (i = 0; i < plan.num_runs; i++)
 	{
-		buffer = malloc(image.sections[i].size);
-		if (buffer == NULL)
-		{
-			command_print(CMD_CTX,
-						  "error allocating buffer for section (%d bytes)",
-						  (int)(image.sections[i].size));
-			break;
-		}
+		struct image_run *run = &plan.runs[i];
 
-		if ((retval = image_read_section(&image, i, 0x0, image.sections[i].size, buffer, &buf_cnt)) != ERROR_OK)
-		{
-			free(buffer);
+		if ((retval = command_check_interrupt()) != ERROR_OK)
 			break;
-		}
-
-		uint32_t offset = 0;
-		uint32_t length = buf_cnt;
-
-		/* DANGER!!! beware of unsigned comparision here!!! */
-
-		if ((image.sections[i].base_address + buf_cnt >= min_address)&&
-				(image.sections[i].base_address < max_address))
-		{
-			if (image.sections[i].base_address < min_address)
-			{
-				/* clip addresses below */
-				offset += min_address-image.sections[i].base_address;
-				length -= offset;
-			}
 
-			if (image.sections[i].base_address + buf_cnt > max_address)
-			{
-				length -= (image.sections[i].base_address + buf_cnt)-max_address;
-			}
+		if ((retval = image_plan_data(&image, &plan, run, &buffer, &copy)) != ERROR_OK)
+			break;
 
-			if ((retval = target_write_buffer(target, image.sections[i].base_address + offset, length, buffer + offset)) != ERROR_OK)
-			{
-				free(buffer);
-				break;
-			}
-			image_size += length;
-			command_print(CMD_CTX, "%u bytes written at address 0x%8.8" PRIx32 "",
-						  (unsigned int)length,
-						  image.sections[i].base_address + offset);
-		}
+		retval = target_write_buffer(target, run->base_address, run->size, buffer);
+		free(copy);
+		if (retval != ERROR_OK)
+			break;
 
-		free(buffer);
+		image_size += run->size;
+		command_print(CMD_CTX, "%u bytes written at address 0x%8.8" PRIx32 "",
+					  (unsigned int)run->size,
+					  run->base_address);
 	}
 
 	if ((ERROR_OK == retval) && (duration_measure(&bench) == ERROR_OK))
@@ -2640,6 +2920,7 @@ COMMAND_HANDLER(handle_load_image_command)
 				duration_elapsed(&bench), duration_kbps(&bench, image_size));
 	}
 
+	image_plan_free(&plan);
 	image_close(&image);
 
 	return retval;
@@ -2672,6 +2953,11 @@ COMMAND_HANDLER(handle_dump_image_command)
 	{
 		size_t size_written;
 		uint32_t this_run_size = (size > 560) ? 560 : size;
+		retval = command_check_interrupt();
+		if (retval != ERROR_OK)
+		{
+			break;
+		}
 		retval = target_read_buffer(target, address, this_run_size, buffer);
 		if (retval != ERROR_OK)
 		{
@@ -2705,15 +2991,161 @@ COMMAND_HANDLER(handle_dump_image_command)
 	return retval;
 }
 
+/* Read back one image section whose checksum did not match and report
+ * the differing bytes; gives up with ERROR_FAIL after 128 differences.
+ */
+static int verify_image_section_compare(struct command_context *cmd_ctx,
+		struct target *target, struct image *image, int section, int *diffs)
+{
+	const uint8_t *buffer;
+	uint8_t *copy;
+	uint8_t *data;
+	size_t buf_cnt;
+	int retval;
+
+	retval = image_section_data(image, section, &buffer, &copy);
+	if (retval != ERROR_OK)
+		return retval;
+	buf_cnt = image->sections[section].size;
+
+	data = malloc(buf_cnt);
+	if (data == NULL)
+	{
+		free(copy);
+		return ERROR_FAIL;
+	}
+
+	/* Can we use 32bit word accesses? */
+	int size = 1;
+	int count = buf_cnt;
+	if ((count % 4) == 0)
+	{
+		size *= 4;
+		count /= 4;
+	}
+	retval = target_read_memory(target, image->sections[section].base_address, size, count, data);
+	if (retval == ERROR_OK)
+	{
+		uint32_t t;
+		for (t = 0; t < buf_cnt; t++)
+		{
+			if (data[t] != buffer[t])
+			{
+				command_print(cmd_ctx,
+							  "diff %d address 0x%08x. Was 0x%02x instead of 0x%02x",
+							  *diffs,
+							  (unsigned)(t + image->sections[section].base_address),
+							  data[t],
+							  buffer[t]);
+				if ((*diffs)++ >= 127)
+				{
+					command_print(cmd_ctx, "More than 128 errors, the rest are not printed.");
+					retval = ERROR_FAIL;
+					break;
+				}
+			}
+			keep_alive();
+		}
+	}
+	free(data);
+	free(copy);
+
+	return retval;
+}
+
+/**
+ * Verify the sections of an open image against target memory.  The
+ * image checksums are computed on the host, then all sections are
+ * checksummed on the target in one batch; only sections whose CRCs
+ * differ are read back to locate the differences.
+ */
+int target_verify_image(struct command_context *cmd_ctx,
+		struct target *target, struct image *image, uint32_t *verified)
+{
+	struct target_memory_check_block *blocks;
+	uint32_t *checksums;
+	uint32_t image_size = 0;
+	int diffs = 0;
+	int retval = ERROR_OK;
+	int i;
+
+	blocks = calloc(image->num_sections, sizeof(*blocks));
+	checksums = calloc(image->num_sections, sizeof(*checksums));
+	if (blocks == NULL || checksums == NULL)
+	{
+		LOG_ERROR("error allocating checksum table");
+		free(blocks);
+		free(checksums);
+		return ERROR_FAIL;
+	}
+
+	/* calculate checksums of the image, one section in memory at a time */
+	for (i = 0; i < image->num_sections; i++)
+	{
+		const uint8_t *buffer;
+		uint8_t *copy;
+		size_t buf_cnt;
+
+		if ((retval = image_section_data(image, i, &buffer, &copy)) != ERROR_OK)
+			break;
+		buf_cnt = image->sections[i].size;
+
+		retval = image_calculate_checksum(buffer, buf_cnt, &checksums[i]);
+		free(copy);
+		if (retval != ERROR_OK)
+			break;
+
+		blocks[i].address = image->sections[i].base_address;
+		blocks[i].size = buf_cnt;
+		image_size += buf_cnt;
+	}
+
+	/* ... and of target memory, all sections at once */
+	if (retval == ERROR_OK)
+		retval = target_checksum_memory_blocks(target, blocks, image->num_sections);
+
+	for (i = 0; (retval == ERROR_OK) && (i < image->num_sections); i++)
+	{
+		if (blocks[i].result == checksums[i])
+			continue;
+
+		retval = command_check_interrupt();
+		if (retval != ERROR_OK)
+			break;
+
+		/* failed crc checksum, fall back to a binary compare */
+		if (diffs == 0)
+		{
+			LOG_ERROR("checksum mismatch - attempting binary compare");
+		}
+
+		retval = verify_image_section_compare(cmd_ctx, target, image, i, &diffs);
+	}
+
+	if ((retval == ERROR_OK) && (diffs > 0))
+	{
+		command_print(cmd_ctx, "No more differences found.");
+	}
+	if (diffs > 0)
+	{
+		retval = ERROR_FAIL;
+	}
+
+	free(blocks);
+	free(checksums);
+
+	if (verified)
+		*verified = image_size;
+
+	return retval;
+}
+
 static COMMAND_HELPER(handle_verify_image_command_internal, int verify)
 {
-	uint8_t *buffer;
 	size_t buf_cnt;
 	uint32_t image_size;
 	int i;
 	int retval;
-	uint32_t checksum = 0;
-	uint32_t mem_checksum = 0;
 
 	struct image image;
 
@@ -2754,106 +3186,21 @@ static COMMAND_HELPER(handle_verify_image_command_internal, int verify)
 	}
 
 	image_size = 0x0;
-	int diffs = 0;
 	retval = ERROR_OK;
-	for (i = 0; i < image.num_sections; i++)
+	if (verify)
 	{
-		buffer = malloc(image.sections[i].size);
-		if (buffer == NULL)
-		{
-			command_print(CMD_CTX,
-						  "error allocating buffer for section (%d bytes)",
-						  (int)(image.sections[i].size));
-			break;
-		}
-		if ((retval = image_read_section(&image, i, 0x0, image.sections[i].size, buffer, &buf_cnt)) != ERROR_OK)
-		{
-			free(buffer);
-			break;
-		}
-
-		if (verify)
-		{
-			/* calculate checksum of image */
-			retval = image_calculate_checksum(buffer, buf_cnt, &checksum);
-			if (retval != ERROR_OK)
-			{
-				free(buffer);
-				break;
-			}
-
-			retval = target_checksum_memory(target, image.sections[i].base_address, buf_cnt, &mem_checksum);
-			if (retval != ERROR_OK)
-			{
-				free(buffer);
-				break;
-			}
-
-			if (checksum != mem_checksum)
-			{
-				/* failed crc checksum, fall back to a binary compare */
-				uint8_t *data;
-
-				if (diffs == 0)
-				{
-					LOG_ERROR("checksum mismatch - attempting binary compare");
-				}
-
-				data = (uint8_t*)malloc(buf_cnt);
-
-				/* Can we use 32bit word accesses? */
-				int size = 1;
-				int count = buf_cnt;
-				if ((count % 4) == 0)
-				{
-					size *= 4;
-					count /= 4;
-				}
-				retval = target_read_memory(target, image.sections[i].base_address, size, count, data);
-				if (retval == ERROR_OK)
-				{
-					uint32_t t;
-					for (t = 0; t < buf_cnt; t++)
-					{
-						if (data[t] != buffer[t])
-						{
-							command_print(CMD_CTX,
-										  "diff %d address 0x%08x. Was 0x%02x instead of 0x%02x",
-										  diffs,
-										  (unsigned)(t + image.sections[i].base_address),
-										  data[t],
-										  buffer[t]);
-							if (diffs++ >= 127)
-							{
-								command_print(CMD_CTX, "More than 128 errors, the rest are not printed.");
-								free(data);
-								free(buffer);
-								goto done;
-							}
-						}
-						keep_alive();
-					}
-				}
-				free(data);
-			}
-		} else
+		retval = target_verify_image(CMD_CTX, target, &image, &image_size);
+	}
+	else
+	{
+		for (i = 0; i < image.num_sections; i++)
 		{
+			buf_cnt = image.sections[i].size;
 			command_print(CMD_CTX, "address 0x%08" PRIx32 " length 0x%08zx",
 						  image.sections[i].base_address,
 						  buf_cnt);
+			image_size += buf_cnt;
 		}
-
-		free(buffer);
-		image_size += buf_cnt;
-	}
-	if (diffs > 0)
-	{
-		command_print(CMD_CTX, "No more differences found.");
-	}
-done:
-	if (diffs > 0)
-	{
-		retval = ERROR_FAIL;
 	}
 	if ((ERROR_OK == retval) && (duration_measure(&bench) == ERROR_OK))
 	{
@@ -3714,6 +4061,7 @@ enum target_cfg_param {
 	TCFG_CHAIN_POSITION,
 	TCFG_DBGBASE,
 	TCFG_RTOS,
+	TCFG_POLL_INTERVAL,
 };
 
 static Jim_Nvp nvp_config_opts[] = {
@@ -3729,6 +4077,7 @@ static Jim_Nvp nvp_config_opts[] = {
 	{ .name = "-chain-position",   .value = TCFG_CHAIN_POSITION },
 	{ .name = "-dbgbase",          .value = TCFG_DBGBASE },
 	{ .name = "-rtos",             .value = TCFG_RTOS },
+	{ .name = "-poll-interval",    .value = TCFG_POLL_INTERVAL },
 	{ .name = NULL, .value = -1 }
 };
 
@@ -4048,6 +4397,29 @@ static int target_configure(Jim_GetOptInfo *goi, struct target *target)
 			}
 			/* loop for more */
 			break;
+
+		case TCFG_POLL_INTERVAL:
+			if (goi->isconfigure) {
+				e = Jim_GetOpt_Wide(goi, &w);
+				if (e != JIM_OK) {
+					return e;
+				}
+				if (w < 1 || w > polling_interval_max) {
+					Jim_SetResultString(goi->interp,
+							"poll interval must be between 1 ms and 1 hour", -1);
+					return JIM_ERR;
+				}
+				target->poll_interval = w;
+				target_poll_reset(target);
+				target_update_polling_tick();
+			} else {
+				if (goi->argc != 0) {
+					goto no_params;
+				}
+			}
+			Jim_SetResult(goi->interp, Jim_NewIntObj(goi->interp, target->poll_interval));
+			/* loop for more */
+			break;
 		}
 	} /* while (goi->argc) */
 
@@ -4302,6 +4674,110 @@ static int jim_target_array2mem(Jim_Interp *interp,
 	return target_array2mem(interp, target, argc - 1, argv + 1);
 }
 
+/* bulk transfers are split up so they can be interrupted */
+#define TARGET_BULK_CHUNK (64 * 1024)
+
+static int jim_target_read_memory(Jim_Interp *interp,
+		int argc, Jim_Obj *const *argv)
+{
+	struct target *target = Jim_CmdPrivData(interp);
+	jim_wide address, count;
+
+	if (argc != 3)
+	{
+		Jim_WrongNumArgs(interp, 1, argv, "address count");
+		return JIM_ERR;
+	}
+	if ((Jim_GetWide(interp, argv[1], &address) != JIM_OK)
+			|| (Jim_GetWide(interp, argv[2], &count) != JIM_OK))
+		return JIM_ERR;
+	if ((count < 0) || (count > INT_MAX)
+			|| ((uint32_t)address + (uint32_t)count < (uint32_t)address))
+	{
+		Jim_SetResultFormatted(interp, "read_memory: invalid count");
+		return JIM_ERR;
+	}
+
+	uint8_t *buffer = malloc(count ? count : 1);
+	if (buffer == NULL)
+	{
+		Jim_SetResultFormatted(interp, "read_memory: out of memory");
+		return JIM_ERR;
+	}
+
+	int retval = ERROR_OK;
+	for (jim_wide offset = 0; offset < count; offset += TARGET_BULK_CHUNK)
+	{
+		uint32_t size = count - offset;
+		if (size > TARGET_BULK_CHUNK)
+			size = TARGET_BULK_CHUNK;
+
+		retval = command_check_interrupt();
+		if (retval == ERROR_OK)
+			retval = target_read_buffer(target, address + offset, size,
+					buffer + offset);
+		if (retval != ERROR_OK)
+		{
+			char tmp[10];
+			snprintf(tmp, sizeof(tmp), "%08lx", (long)(address + offset));
+			Jim_SetResultFormatted(interp,
+					"read_memory: cannot read memory at 0x%s", tmp);
+			break;
+		}
+	}
+
+	if (retval == ERROR_OK)
+		Jim_SetResult(interp, Jim_NewStringObj(interp, (char *)buffer, count));
+
+	free(buffer);
+	return (retval == ERROR_OK) ? JIM_OK : JIM_ERR;
+}
+
+static int jim_target_write_memory(Jim_Interp *interp,
+		int argc, Jim_Obj *const *argv)
+{
+	struct target *target = Jim_CmdPrivData(interp);
+	jim_wide address;
+	const char *data;
+	int count;
+
+	if (argc != 3)
+	{
+		Jim_WrongNumArgs(interp, 1, argv, "address data");
+		return JIM_ERR;
+	}
+	if (Jim_GetWide(interp, argv[1], &address) != JIM_OK)
+		return JIM_ERR;
+	data = Jim_GetString(argv[2], &count);
+	if ((uint32_t)address + (uint32_t)count < (uint32_t)address)
+	{
+		Jim_SetResultFormatted(interp, "write_memory: address wraps");
+		return JIM_ERR;
+	}
+
+	for (int offset = 0; offset < count; offset += TARGET_BULK_CHUNK)
+	{
+		uint32_t size = count - offset;
+		if (size > TARGET_BULK_CHUNK)
+			size = TARGET_BULK_CHUNK;
+
+		int retval = command_check_interrupt();
+		if (retval == ERROR_OK)
+			retval = target_write_buffer(target, address + offset, size,
+					(const uint8_t *)data + offset);
+		if (retval != ERROR_OK)
+		{
+			char tmp[10];
+			snprintf(tmp, sizeof(tmp), "%08lx", (long)(address + offset));
+			Jim_SetResultFormatted(interp,
+					"write_memory: cannot write memory at 0x%s", tmp);
+			return JIM_ERR;
+		}
+	}
+
+	return JIM_OK;
+}
+
 static int jim_target_tap_disabled(Jim_Interp *interp)
 {
 	Jim_SetResultFormatted(interp, "[TAP is disabled]");
@@ -4607,6 +5083,20 @@ static const struct command_registration target_instance_command_handlers[] = {
 			"from target memory",
 		.usage = "arrayname bitwidth address count",
 	},
+	{
+		.name = "read_memory",
+		.mode = COMMAND_EXEC,
+		.jim_handler = jim_target_read_memory,
+		.help = "Returns target memory as a string of raw bytes",
+		.usage = "address count",
+	},
+	{
+		.name = "write_memory",
+		.mode = COMMAND_EXEC,
+		.jim_handler = jim_target_write_memory,
+		.help = "Writes a string of raw bytes to target memory",
+		.usage = "address data",
+	},
 	{
 		.name = "eventlist",
 		.mode = COMMAND_EXEC,
@@ -4753,6 +5243,9 @@ static int target_create(Jim_GetOptInfo *goi)
 
 	target->display             = 1;
 
+	target->poll_interval       = polling_interval;
+	target->poll_backoff        = polling_interval;
+
 	target->halt_issued			= false;
 
 	/* initialize trace information */
@@ -5111,14 +5604,13 @@ static void free_fastload(void)
 
 COMMAND_HANDLER(handle_fast_load_image_command)
 {
-	uint8_t *buffer;
-	size_t buf_cnt;
 	uint32_t image_size;
 	uint32_t min_address = 0;
 	uint32_t max_address = 0xffffffff;
 	int i;
 
 	struct image image;
+	struct image_plan plan;
 
 	int retval = CALL_COMMAND_HANDLER(parse_load_image_command_CMD_ARGV,
 			&image, &min_address, &max_address);
@@ -5134,75 +5626,53 @@ COMMAND_HANDLER(handle_fast_load_image_command)
 		return retval;
 	}
 
+	/* like load_image, one transfer per run of adjacent sections */
+	image_plan_init(&plan);
+	plan.min_address = min_address;
+	plan.max_address = max_address - 1;
+	/* max_address is exclusive; an empty range (a size of zero) loads
+	 * nothing rather than wrapping around to the whole address space */
+	if (max_address != min_address)
+		retval = image_plan_build(&image, &plan);
+	if (retval != ERROR_OK)
+	{
+		image_close(&image);
+		return retval;
+	}
+
 	image_size = 0x0;
-	retval = ERROR_OK;
-	fastload_num = image.num_sections;
-	fastload = (struct FastLoad *)malloc(sizeof(struct FastLoad)*image.num_sections);
-	if (fastload == NULL)
+	fastload_num = plan.num_runs;
+	fastload = (struct FastLoad *)calloc(plan.num_runs, sizeof(struct FastLoad));
+	if ((fastload == NULL) && (plan.num_runs != 0))
 	{
 		command_print(CMD_CTX, "out of memory");
+		image_plan_free(&plan);
 		image_close(&image);
 		return ERROR_FAIL;
 	}
-	memset(fastload, 0, sizeof(struct FastLoad)*image.num_sections);
-	for (i = 0; i < image.num_sections; i++)
+	for (i = 0; i < plan.num_runs; i++)
 	{
-		buffer = malloc(image.sections[i].size);
-		if (buffer == NULL)
+		struct image_run *run = &plan.runs[i];
+
+		fastload[i].address = run->base_address;
+		fastload[i].data = malloc(run->size);
+		if (fastload[i].data == NULL)
 		{
 			command_print(CMD_CTX, "error allocating buffer for section (%d bytes)",
-						  (int)(image.sections[i].size));
+						  (int)run->size);
 			retval = ERROR_FAIL;
 			break;
 		}
-
-		if ((retval = image_read_section(&image, i, 0x0, image.sections[i].size, buffer, &buf_cnt)) != ERROR_OK)
-		{
-			free(buffer);
+		retval = image_plan_read(&image, &plan, run->base_address,
+				run->size, fastload[i].data);
+		if (retval != ERROR_OK)
 			break;
-		}
-
-		uint32_t offset = 0;
-		uint32_t length = buf_cnt;
-
-
-		/* DANGER!!! beware of unsigned comparision here!!! */
-
-		if ((image.sections[i].base_address + buf_cnt >= min_address)&&
-				(image.sections[i].base_address < max_address))
-		{
-			if (image.sections[i].base_address < min_address)
-			{
-				/* clip addresses below */
-				offset += min_address-image.sections[i].base_address;
-				length -= offset;
-			}
+		fastload[i].length = run->size;
 
-			if (image.sections[i].base_address + buf_cnt > max_address)
-			{
-				length -= (image.sections[i].base_address + buf_cnt)-max_address;
-			}
-
-			fastload[i].address = image.sections[i].base_address + offset;
-			fastload[i].data = malloc(length);
-			if (fastload[i].data == NULL)
-			{
-				free(buffer);
-				command_print(CMD_CTX, "error allocating buffer for section (%d bytes)",
-							  length);
-				retval = ERROR_FAIL;
-				break;
-			}
-			memcpy(fastload[i].data, buffer + offset, length);
-			fastload[i].length = length;
-
-			image_size += length;
-			command_print(CMD_CTX, "%u bytes written at address 0x%8.8x",
-						  (unsigned int)length,
-						  ((unsigned int)(image.sections[i].base_address + offset)));
-		}
-
-		free(buffer);
+		image_size += run->size;
+		command_print(CMD_CTX, "%u bytes written at address 0x%8.8x",
+					  (unsigned int)run->size,
+					  (unsigned int)run->base_address);
 	}
 
 	if ((ERROR_OK == retval) && (duration_measure(&bench) == ERROR_OK))
@@ -5216,6 +5686,7 @@ COMMAND_HANDLER(handle_fast_load_image_command)
 				"You can issue a 'fast_load' to finish loading.");
 	}
 
+	image_plan_free(&plan);
 	image_close(&image);
 
 	if (retval != ERROR_OK)
@@ -5337,6 +5808,14 @@ static const struct command_registration target_exec_command_handlers[] = {
 			"displays all registers and their values",
 		.usage = "[(register_name|register_number) [value]]",
 	},
+	{
+		.name = "timer_stats",
+		.handler = handle_timer_stats_command,
+		.mode = COMMAND_ANY,
+		.help = "show how often and for how long each timer "
+			"callback (e.g. background polling) has run",
+		.usage = "['reset']",
+	},
 	{
 		.name = "poll",
 		.handler = handle_poll_command,
@@ -42,6 +42,7 @@ struct watchpoint;
 struct mem_param;
 struct reg_param;
 struct target_list;
+struct image;
 
 /*
  * TARGET_UNKNOWN = 0: we don't know anything about the target yet
@@ -105,6 +106,18 @@ struct working_area
 	struct working_area **user;
 	struct working_area *next;
 };
+
+/**
+ * One memory region for target_checksum_memory_blocks().  The caller
+ * fills in @a address and @a size; @a result receives the CRC32 of the
+ * region as computed on the target.
+ */
+struct target_memory_check_block
+{
+	uint32_t address;
+	uint32_t size;
+	uint32_t result;
+};
  
 struct gdb_service
 {
@@ -173,6 +186,12 @@ struct target
 	bool halt_issued;					/* did we transition to halted state? */
 	long long halt_issued_time;			/* Note time when halt was issued */
 
+	int poll_interval;					/* background polling interval in ms, "-poll-interval" */
+	int poll_backoff;					/* current interval, grows while the target runs */
+	long long poll_next;				/* timeval_ms() when the next background poll is due */
+	unsigned long poll_count;			/* number of background polls ... */
+	long long poll_total_us;			/* ... and the time they took */
+
 	bool dbgbase_set;					/* By default the debug base is not set */
 	uint32_t dbgbase;					/* Really a Cortex-A specific option, but there is no
 	 	 	 	 	 	 	 	 	 	   system in place to support target specific options
@@ -279,11 +298,24 @@ struct target_event_callback
 struct target_timer_callback
 {
 	int (*callback)(void *priv);
+	/** shown by the "timer_stats" command */
+	const char *name;
 	int time_ms;
 	int periodic;
+	/** absolute deadline of the next call */
 	struct timeval when;
 	void *priv;
-	struct target_timer_callback *next;
+	/** position in the timer heap, or -1 while not scheduled */
+	int heap_index;
+	/** nesting depth of calls currently in progress */
+	int running;
+	/** unregistered while running, free once it returns */
+	bool removed;
+
+	/* runtime statistics, see the "timer_stats" command */
+	unsigned long calls;
+	int64_t total_us;
+	int64_t max_us;
 };
 
 int target_register_commands(struct command_context *cmd_ctx);
@@ -310,17 +342,21 @@ int target_unregister_event_callback(
  * yet it is possible to detect error condtions.
  */
 int target_poll(struct target *target);
+/** Go back to polling @a target at its configured interval, soon. */
+void target_poll_reset(struct target *target);
 int target_resume(struct target *target, int current, uint32_t address,
 		int handle_breakpoints, int debug_execution);
 int target_halt(struct target *target);
 int target_call_event_callbacks(struct target *target, enum target_event event);
 
 /**
- * The period is very approximate, the callback can happen much more often
- * or much more rarely than specified
+ * Periodic callbacks are scheduled against absolute deadlines, so they do
+ * not drift; but they only run when the server loop gets around to it,
+ * which can be late while it is busy, and target_call_timer_callbacks_now()
+ * runs them early.  @a name identifies the callback in "timer_stats".
  */
 int target_register_timer_callback(int (*callback)(void *priv),
-		int time_ms, int periodic, void *priv);
+		int time_ms, int periodic, void *priv, const char *name);
 
 int target_call_timer_callbacks(void);
 /**
@@ -328,6 +364,12 @@ int target_call_timer_callbacks(void);
  * a syncrhonous command completes.
  */
 int target_call_timer_callbacks_now(void);
+/**
+ * @returns the number of milliseconds until the next timer callback is
+ * due, 0 if one is already overdue, or -1 if none are registered.  The
+ * server loop uses this to decide how long it may sleep.
+ */
+int target_timer_next_event_ms(void);
 
 struct target* get_current_target(struct command_context *cmd_ctx);
 struct target *get_target(const char *id);
@@ -484,6 +526,21 @@ int target_read_buffer(struct target *target,
 		uint32_t address, uint32_t size, uint8_t *buffer);
 int target_checksum_memory(struct target *target,
 		uint32_t address, uint32_t size, uint32_t* crc);
+/**
+ * Compute the CRC32 of each of the @a num_blocks regions in @a blocks.
+ * Targets implementing the checksum_memory_blocks hook handle the whole
+ * list with as few algorithm invocations as their working area allows;
+ * others fall back to one target_checksum_memory() call per block.
+ */
+int target_checksum_memory_blocks(struct target *target,
+		struct target_memory_check_block *blocks, unsigned num_blocks);
+/**
+ * Compare every section of an opened @a image against the memory of
+ * @a target using on-target checksums, reading back only the sections
+ * that differ.  The number of bytes compared is stored in @a verified.
+ */
+int target_verify_image(struct command_context *cmd_ctx,
+		struct target *target, struct image *image, uint32_t *verified);
 int target_blank_check_memory(struct target *target,
 		uint32_t address, uint32_t size, uint32_t* blank);
 int target_wait_state(struct target *target, enum target_state state, int ms);
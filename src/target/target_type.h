@@ -30,6 +30,7 @@
 #include <jim-nvp.h>
 
 struct target;
+struct target_memory_check_block;
 
 /**
  * This holds methods shared between all instances of a given target
@@ -133,6 +134,13 @@ struct target_type
 	int (*bulk_write_memory)(struct target *target, uint32_t address, uint32_t count, const uint8_t *buffer);
 
 	int (*checksum_memory)(struct target *target, uint32_t address, uint32_t count, uint32_t* checksum);
+	/**
+	 * Optional.  Checksum a list of regions on the target, batching as
+	 * many as possible into each algorithm run.  Do @b not call this
+	 * function directly, use target_checksum_memory_blocks() instead.
+	 */
+	int (*checksum_memory_blocks)(struct target *target,
+			struct target_memory_check_block *blocks, unsigned num_blocks);
 	int (*blank_check_memory)(struct target *target, uint32_t address, uint32_t count, uint32_t* blank);
 
 	/*
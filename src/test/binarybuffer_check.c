@@ -0,0 +1,99 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * Check for buf_hexify(), which encodes the data of GDB memory read
+ * replies and console packets.
+ *
+ * Every byte value, then random data of many lengths at unaligned
+ * addresses, is encoded and compared with printf("%02x") output.  The
+ * returned sum must be the GDB checksum of the digits, and nothing
+ * past the 2 * count characters may be written.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <helper/binarybuffer.h>
+
+#define MAX_COUNT	4096
+#define GUARD		0x5a
+
+static int check_hexify(const uint8_t *bin, unsigned count)
+{
+	static char hex[2 * MAX_COUNT + 1];
+	static char expected[2 * MAX_COUNT + 1];
+	uint8_t sum = 0;
+	uint8_t result;
+
+	for (unsigned i = 0; i < count; i++)
+		snprintf(expected + 2 * i, 3, "%02x", bin[i]);
+	for (unsigned i = 0; i < 2 * count; i++)
+		sum += expected[i];
+
+	memset(hex, GUARD, sizeof(hex));
+	result = buf_hexify(hex, bin, count);
+
+	if (memcmp(hex, expected, 2 * count) != 0)
+	{
+		printf("FAIL: %u bytes encoded wrongly\n", count);
+		return 1;
+	}
+	if (hex[2 * count] != GUARD)
+	{
+		printf("FAIL: %u bytes encoded past the end\n", count);
+		return 1;
+	}
+	if (result != sum)
+	{
+		printf("FAIL: %u bytes sum to 0x%02x instead of 0x%02x\n",
+				count, result, sum);
+		return 1;
+	}
+	return 0;
+}
+
+int main(void)
+{
+	uint8_t *data = malloc(MAX_COUNT + 8);
+	unsigned count;
+	int i;
+
+	if (data == NULL)
+		return 1;
+
+	for (i = 0; i < 256; i++)
+		data[i] = i;
+	if (check_hexify(data, 256) || check_hexify(data, 0))
+		return 1;
+
+	srand(1);
+	for (i = 0; i < MAX_COUNT + 8; i++)
+		data[i] = rand();
+	for (count = 1; count <= MAX_COUNT; count = count * 3 / 2 + 1)
+	{
+		for (i = 0; i < 8; i++)
+		{
+			if (check_hexify(data + i, count))
+				return 1;
+		}
+	}
+
+	free(data);
+	return 0;
+}
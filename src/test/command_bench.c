@@ -0,0 +1,189 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * Check and benchmark for the command lookup hash.
+ *
+ * Registers a few thousand commands, in groups the way drivers do,
+ * then looks every one of them (and as many unknown names) up through
+ * command_find_in_context()/command_find_in_parent(), and the same
+ * again by walking the sorted sibling lists as command_find() used to.
+ * Fails if a lookup returns the wrong command or if unregistered
+ * commands can still be found, and reports the time each step took.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <helper/log.h>
+#include <helper/command.h>
+#include <helper/time_support.h>
+
+#define GROUPS		256
+#define SUBCOMMANDS	16
+#define ROUNDS		20
+
+static char group_names[GROUPS][16];
+static char sub_names[SUBCOMMANDS][16];
+
+COMMAND_HANDLER(handle_bench_command)
+{
+	return ERROR_OK;
+}
+
+/* command_find() before commands were hashed */
+static struct command *list_find(struct command *head, const char *name)
+{
+	for (struct command *cc = head; cc; cc = cc->next)
+	{
+		if (strcmp(cc->name, name) == 0)
+			return cc;
+	}
+	return NULL;
+}
+
+static int64_t elapsed_us(struct duration *d)
+{
+	duration_measure(d);
+	return d->elapsed.tv_sec * 1000000LL + d->elapsed.tv_usec;
+}
+
+int main(void)
+{
+	struct command_registration subs[SUBCOMMANDS + 1];
+	struct command_registration groups[GROUPS + 1];
+	struct command_context *cmd_ctx;
+	struct duration bench;
+	int64_t t_hash, t_list;
+	unsigned found = 0;
+	int i, j, round;
+
+	cmd_ctx = command_init("", NULL);
+	if (cmd_ctx == NULL)
+		return 1;
+
+	memset(subs, 0, sizeof(subs));
+	for (j = 0; j < SUBCOMMANDS; j++)
+	{
+		snprintf(sub_names[j], sizeof(sub_names[j]), "sub%d", j);
+		subs[j].name = sub_names[j];
+		subs[j].handler = handle_bench_command;
+		subs[j].mode = COMMAND_ANY;
+		subs[j].help = "benchmark subcommand";
+	}
+
+	memset(groups, 0, sizeof(groups));
+	for (i = 0; i < GROUPS; i++)
+	{
+		/* spread over the alphabet like driver names are */
+		snprintf(group_names[i], sizeof(group_names[i]), "%c%02xbench",
+				'a' + i % 26, i);
+		groups[i].name = group_names[i];
+		groups[i].mode = COMMAND_ANY;
+		groups[i].help = "benchmark command group";
+		groups[i].chain = subs;
+	}
+
+	duration_start(&bench);
+	if (register_commands(cmd_ctx, NULL, groups) != ERROR_OK)
+	{
+		printf("FAIL: could not register commands\n");
+		return 1;
+	}
+	printf("registered %d commands in %lld us\n", GROUPS * (SUBCOMMANDS + 1),
+			(long long)elapsed_us(&bench));
+
+	duration_start(&bench);
+	for (round = 0; round < ROUNDS; round++)
+	{
+		for (i = 0; i < GROUPS; i++)
+		{
+			struct command *group = command_find_in_context(cmd_ctx, group_names[i]);
+			if (group == NULL || strcmp(group->name, group_names[i]) != 0)
+			{
+				printf("FAIL: lookup of '%s'\n", group_names[i]);
+				return 1;
+			}
+			for (j = 0; j < SUBCOMMANDS; j++)
+			{
+				struct command *c = command_find_in_parent(group, sub_names[j]);
+				if (c == NULL || c->parent != group
+						|| strcmp(c->name, sub_names[j]) != 0)
+				{
+					printf("FAIL: lookup of '%s %s'\n",
+							group_names[i], sub_names[j]);
+					return 1;
+				}
+				found++;
+			}
+			/* unknown names, which can't stop a list walk early */
+			if (command_find_in_context(cmd_ctx, sub_names[i % SUBCOMMANDS])
+					|| command_find_in_parent(group, group_names[i]))
+			{
+				printf("FAIL: found a command that isn't there\n");
+				return 1;
+			}
+		}
+	}
+	t_hash = elapsed_us(&bench);
+
+	duration_start(&bench);
+	for (round = 0; round < ROUNDS; round++)
+	{
+		for (i = 0; i < GROUPS; i++)
+		{
+			struct command *group = list_find(cmd_ctx->commands, group_names[i]);
+			for (j = 0; j < SUBCOMMANDS; j++)
+				found -= list_find(group->children, sub_names[j]) != NULL;
+			found -= list_find(cmd_ctx->commands, sub_names[i % SUBCOMMANDS]) != NULL;
+			found -= list_find(group->children, group_names[i]) != NULL;
+		}
+	}
+	t_list = elapsed_us(&bench);
+
+	if (found != 0)
+	{
+		printf("FAIL: hash and list lookups disagree\n");
+		return 1;
+	}
+	printf("%d lookups: %lld us hashed, %lld us walking the lists\n",
+			ROUNDS * GROUPS * (SUBCOMMANDS + 3),
+			(long long)t_hash, (long long)t_list);
+
+	duration_start(&bench);
+	for (i = 0; i < GROUPS; i++)
+	{
+		if (unregister_command(cmd_ctx, NULL, group_names[i]) != ERROR_OK)
+		{
+			printf("FAIL: could not unregister '%s'\n", group_names[i]);
+			return 1;
+		}
+	}
+	printf("unregistered them in %lld us\n", (long long)elapsed_us(&bench));
+
+	for (i = 0; i < GROUPS; i++)
+	{
+		if (command_find_in_context(cmd_ctx, group_names[i]))
+		{
+			printf("FAIL: '%s' still found\n", group_names[i]);
+			return 1;
+		}
+	}
+
+	return 0;
+}
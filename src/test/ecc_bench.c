@@ -0,0 +1,282 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * Check and benchmark for the NAND software ECC.
+ *
+ * nand_calculate_ecc() and nand_calculate_ecc_kw() work a word at a
+ * time.  Their output is compared with the byte-wise versions they
+ * replaced on random, erased, sparse and all-zero blocks at unaligned
+ * addresses, and the throughput of both is reported.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <flash/nand/core.h>
+
+#include <sys/time.h>
+
+/* the Hamming code of ecc.c, a byte at a time */
+static const uint8_t old_ecc_precalc_table[] = {
+	0x00, 0x55, 0x56, 0x03, 0x59, 0x0c, 0x0f, 0x5a, 0x5a, 0x0f, 0x0c, 0x59, 0x03, 0x56, 0x55, 0x00,
+	0x65, 0x30, 0x33, 0x66, 0x3c, 0x69, 0x6a, 0x3f, 0x3f, 0x6a, 0x69, 0x3c, 0x66, 0x33, 0x30, 0x65,
+	0x66, 0x33, 0x30, 0x65, 0x3f, 0x6a, 0x69, 0x3c, 0x3c, 0x69, 0x6a, 0x3f, 0x65, 0x30, 0x33, 0x66,
+	0x03, 0x56, 0x55, 0x00, 0x5a, 0x0f, 0x0c, 0x59, 0x59, 0x0c, 0x0f, 0x5a, 0x00, 0x55, 0x56, 0x03,
+	0x69, 0x3c, 0x3f, 0x6a, 0x30, 0x65, 0x66, 0x33, 0x33, 0x66, 0x65, 0x30, 0x6a, 0x3f, 0x3c, 0x69,
+	0x0c, 0x59, 0x5a, 0x0f, 0x55, 0x00, 0x03, 0x56, 0x56, 0x03, 0x00, 0x55, 0x0f, 0x5a, 0x59, 0x0c,
+	0x0f, 0x5a, 0x59, 0x0c, 0x56, 0x03, 0x00, 0x55, 0x55, 0x00, 0x03, 0x56, 0x0c, 0x59, 0x5a, 0x0f,
+	0x6a, 0x3f, 0x3c, 0x69, 0x33, 0x66, 0x65, 0x30, 0x30, 0x65, 0x66, 0x33, 0x69, 0x3c, 0x3f, 0x6a,
+	0x6a, 0x3f, 0x3c, 0x69, 0x33, 0x66, 0x65, 0x30, 0x30, 0x65, 0x66, 0x33, 0x69, 0x3c, 0x3f, 0x6a,
+	0x0f, 0x5a, 0x59, 0x0c, 0x56, 0x03, 0x00, 0x55, 0x55, 0x00, 0x03, 0x56, 0x0c, 0x59, 0x5a, 0x0f,
+	0x0c, 0x59, 0x5a, 0x0f, 0x55, 0x00, 0x03, 0x56, 0x56, 0x03, 0x00, 0x55, 0x0f, 0x5a, 0x59, 0x0c,
+	0x69, 0x3c, 0x3f, 0x6a, 0x30, 0x65, 0x66, 0x33, 0x33, 0x66, 0x65, 0x30, 0x6a, 0x3f, 0x3c, 0x69,
+	0x03, 0x56, 0x55, 0x00, 0x5a, 0x0f, 0x0c, 0x59, 0x59, 0x0c, 0x0f, 0x5a, 0x00, 0x55, 0x56, 0x03,
+	0x66, 0x33, 0x30, 0x65, 0x3f, 0x6a, 0x69, 0x3c, 0x3c, 0x69, 0x6a, 0x3f, 0x65, 0x30, 0x33, 0x66,
+	0x65, 0x30, 0x33, 0x66, 0x3c, 0x69, 0x6a, 0x3f, 0x3f, 0x6a, 0x69, 0x3c, 0x66, 0x33, 0x30, 0x65,
+	0x00, 0x55, 0x56, 0x03, 0x59, 0x0c, 0x0f, 0x5a, 0x5a, 0x0f, 0x0c, 0x59, 0x03, 0x56, 0x55, 0x00
+};
+
+static void old_calculate_ecc(const uint8_t *dat, uint8_t *ecc_code)
+{
+	uint8_t idx, reg1, reg2, reg3, tmp1, tmp2;
+	int i;
+
+	reg1 = reg2 = reg3 = 0;
+
+	for (i = 0; i < 256; i++) {
+		idx = old_ecc_precalc_table[*dat++];
+		reg1 ^= (idx & 0x3f);
+
+		if (idx & 0x40) {
+			reg3 ^= (uint8_t) i;
+			reg2 ^= ~((uint8_t) i);
+		}
+	}
+
+	tmp1  = (reg3 & 0x80) >> 0;
+	tmp1 |= (reg2 & 0x80) >> 1;
+	tmp1 |= (reg3 & 0x40) >> 1;
+	tmp1 |= (reg2 & 0x40) >> 2;
+	tmp1 |= (reg3 & 0x20) >> 2;
+	tmp1 |= (reg2 & 0x20) >> 3;
+	tmp1 |= (reg3 & 0x10) >> 3;
+	tmp1 |= (reg2 & 0x10) >> 4;
+
+	tmp2  = (reg3 & 0x08) << 4;
+	tmp2 |= (reg2 & 0x08) << 3;
+	tmp2 |= (reg3 & 0x04) << 3;
+	tmp2 |= (reg2 & 0x04) << 2;
+	tmp2 |= (reg3 & 0x02) << 2;
+	tmp2 |= (reg2 & 0x02) << 1;
+	tmp2 |= (reg3 & 0x01) << 1;
+	tmp2 |= (reg2 & 0x01) << 0;
+
+#ifdef NAND_ECC_SMC
+	ecc_code[0] = ~tmp2;
+	ecc_code[1] = ~tmp1;
+#else
+	ecc_code[0] = ~tmp1;
+	ecc_code[1] = ~tmp2;
+#endif
+	ecc_code[2] = ((~reg1) << 2) | 0x03;
+}
+
+/* the Reed-Solomon code of ecc_kw.c, a symbol at a time */
+#define MODPOLY		0x409		/* x^10 + x^3 + 1 in binary */
+
+static uint16_t old_gf_exp[1023 + 1023];
+static uint16_t old_gf_log[1024];
+
+static void old_gf_build_log_exp_table(void)
+{
+	int i;
+	int p_i = 1;
+
+	for (i = 0; i < 1023; i++) {
+		old_gf_exp[i] = p_i;
+		old_gf_exp[i + 1023] = p_i;
+		old_gf_log[p_i] = i;
+
+		p_i <<= 1;
+		if (p_i & (1 << 10))
+			p_i ^= MODPOLY;
+	}
+}
+
+static void old_calculate_ecc_kw(const uint8_t *data, uint8_t *ecc)
+{
+	unsigned int r7, r6, r5, r4, r3, r2, r1, r0;
+	int i;
+
+	r0 = data[504];
+	r1 = data[505];
+	r2 = data[506];
+	r3 = data[507];
+	r4 = data[508];
+	r5 = data[509];
+	r6 = data[510];
+	r7 = data[511];
+
+	for (i = 503; i >= -8; i--) {
+		unsigned int d;
+
+		d = 0;
+		if (i >= 0)
+			d = data[i];
+
+		if (r7) {
+			uint16_t *t = old_gf_exp + old_gf_log[r7];
+
+			r7 = r6 ^ t[0x21c];
+			r6 = r5 ^ t[0x181];
+			r5 = r4 ^ t[0x18e];
+			r4 = r3 ^ t[0x25f];
+			r3 = r2 ^ t[0x197];
+			r2 = r1 ^ t[0x193];
+			r1 = r0 ^ t[0x237];
+			r0 = d  ^ t[0x024];
+		} else {
+			r7 = r6;
+			r6 = r5;
+			r5 = r4;
+			r4 = r3;
+			r3 = r2;
+			r2 = r1;
+			r1 = r0;
+			r0 = d;
+		}
+	}
+
+	ecc[0] = r0;
+	ecc[1] = (r0 >> 8) | (r1 << 2);
+	ecc[2] = (r1 >> 6) | (r2 << 4);
+	ecc[3] = (r2 >> 4) | (r3 << 6);
+	ecc[4] = (r3 >> 2);
+	ecc[5] = r4;
+	ecc[6] = (r4 >> 8) | (r5 << 2);
+	ecc[7] = (r5 >> 6) | (r6 << 4);
+	ecc[8] = (r6 >> 4) | (r7 << 6);
+	ecc[9] = (r7 >> 2);
+}
+
+static double now(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+#define BLOCKS		100000
+#define BENCH_SIZE	(1024 * 1024)
+#define ROUNDS		50
+
+/* random, erased, sparse and all-zero but for one byte */
+static void fill_block(uint8_t *block, int size, int kind)
+{
+	for (int i = 0; i < size; i++)
+	{
+		switch (kind)
+		{
+		case 0:
+			block[i] = rand();
+			break;
+		case 1:
+			block[i] = 0xff;
+			break;
+		case 2:
+			block[i] = (rand() % 50) ? 0 : 1 << (rand() % 8);
+			break;
+		default:
+			block[i] = 0;
+			break;
+		}
+	}
+	if (kind == 3)
+		block[rand() % size] = rand();
+}
+
+int main(void)
+{
+	uint8_t *data = malloc(BENCH_SIZE + 8);
+	uint8_t ecc_old[10], ecc_new[10];
+	double t, t_old, t_new;
+	int i, r;
+
+	if (data == NULL)
+		return 1;
+	old_gf_build_log_exp_table();
+
+	srand(1);
+	for (i = 0; i < BLOCKS; i++)
+	{
+		/* both codes read the block a byte at a time or by words */
+		uint8_t *block = data + i % 8;
+
+		fill_block(block, 512, i % 4);
+
+		old_calculate_ecc(block, ecc_old);
+		nand_calculate_ecc(NULL, block, ecc_new);
+		if (memcmp(ecc_old, ecc_new, 3) != 0)
+		{
+			printf("FAIL: Hamming ECC differs on block %d\n", i);
+			return 1;
+		}
+
+		old_calculate_ecc_kw(block, ecc_old);
+		nand_calculate_ecc_kw(NULL, block, ecc_new);
+		if (memcmp(ecc_old, ecc_new, 10) != 0)
+		{
+			printf("FAIL: Reed-Solomon ECC differs on block %d\n", i);
+			return 1;
+		}
+	}
+	printf("%d blocks: same ECC as the byte-wise code\n", BLOCKS);
+
+	for (i = 0; i < BENCH_SIZE; i++)
+		data[i] = rand();
+
+	t = now();
+	for (r = 0; r < ROUNDS; r++)
+		for (i = 0; i < BENCH_SIZE; i += 256)
+			old_calculate_ecc(data + i, ecc_old);
+	t_old = now() - t;
+	t = now();
+	for (r = 0; r < ROUNDS; r++)
+		for (i = 0; i < BENCH_SIZE; i += 256)
+			nand_calculate_ecc(NULL, data + i, ecc_new);
+	t_new = now() - t;
+	printf("Hamming:      %6.1f MB/s before, %6.1f MB/s after\n",
+			ROUNDS * BENCH_SIZE / t_old / 1e6, ROUNDS * BENCH_SIZE / t_new / 1e6);
+
+	t = now();
+	for (r = 0; r < ROUNDS; r++)
+		for (i = 0; i < BENCH_SIZE; i += 512)
+			old_calculate_ecc_kw(data + i, ecc_old);
+	t_old = now() - t;
+	t = now();
+	for (r = 0; r < ROUNDS; r++)
+		for (i = 0; i < BENCH_SIZE; i += 512)
+			nand_calculate_ecc_kw(NULL, data + i, ecc_new);
+	t_new = now() - t;
+	printf("Reed-Solomon: %6.1f MB/s before, %6.1f MB/s after\n",
+			ROUNDS * BENCH_SIZE / t_old / 1e6, ROUNDS * BENCH_SIZE / t_new / 1e6);
+
+	free(data);
+	return 0;
+}
@@ -0,0 +1,295 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * Check and benchmark for the IHEX and S19 image loaders.
+ *
+ * A known section layout -- gaps, a run across a 64 KiB boundary, a
+ * section below the previous one -- is written out as IHEX and S19 and
+ * must come back from image_open() with the same sections and data,
+ * and with the IHEX start linear address as written.  Then an 8 MiB
+ * image is written in both formats and the time image_open() and
+ * reading it back take is reported.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <target/image.h>
+#include <helper/log.h>
+#include <helper/time_support.h>
+
+#define IHEX_FILE	"image_bench.hex"
+#define S19_FILE	"image_bench.s19"
+
+#define RECORD_SIZE	32
+#define BENCH_SIZE	(8 * 1024 * 1024)
+
+struct layout
+{
+	uint32_t base;
+	uint32_t size;
+};
+
+static const struct layout check_layout[] = {
+	{ 0x00000000, 100 },
+	{ 0x00001000, 300 },
+	/* one section although IHEX needs a new upper address in between */
+	{ 0x0800fff0, 0x40 },
+	{ 0x20000000, 1 },
+	/* below the previous one */
+	{ 0x00002000, 17 },
+};
+#define CHECK_START	0x08000131
+
+static void ihex_record(FILE *f, unsigned type, uint16_t address,
+		const uint8_t *data, unsigned count)
+{
+	uint8_t sum = count + (address >> 8) + address + type;
+
+	fprintf(f, ":%02X%04X%02X", count, address, type);
+	for (unsigned i = 0; i < count; i++)
+	{
+		fprintf(f, "%02X", data[i]);
+		sum += data[i];
+	}
+	fprintf(f, "%02X\n", (uint8_t)-sum);
+}
+
+static int write_ihex(const char *name, const struct layout *layout,
+		int count, const uint8_t *data, uint32_t start)
+{
+	FILE *f = fopen(name, "w");
+	uint32_t upper = 0;
+	uint8_t bytes[4];
+
+	if (f == NULL)
+		return ERROR_FAIL;
+
+	for (int i = 0; i < count; i++)
+	{
+		uint32_t address = layout[i].base;
+		uint32_t left = layout[i].size;
+
+		while (left)
+		{
+			/* records don't cross a 64 KiB boundary */
+			uint32_t n = 0x10000 - (address & 0xffff);
+			if (n > RECORD_SIZE)
+				n = RECORD_SIZE;
+			if (n > left)
+				n = left;
+
+			if ((address >> 16) != upper)
+			{
+				upper = address >> 16;
+				h_u16_to_be(bytes, upper);
+				ihex_record(f, 4, 0, bytes, 2);
+			}
+			ihex_record(f, 0, address, data, n);
+
+			data += n;
+			address += n;
+			left -= n;
+		}
+	}
+
+	h_u32_to_be(bytes, start);
+	ihex_record(f, 5, 0, bytes, 4);
+	ihex_record(f, 1, 0, NULL, 0);
+
+	return fclose(f) ? ERROR_FAIL : ERROR_OK;
+}
+
+static void srec_record(FILE *f, unsigned type, uint32_t address,
+		unsigned address_bytes, const uint8_t *data, unsigned count)
+{
+	uint8_t sum = count + address_bytes + 1;
+
+	fprintf(f, "S%u%02X", type, count + address_bytes + 1);
+	while (address_bytes--)
+	{
+		uint8_t a = address >> (8 * address_bytes);
+		fprintf(f, "%02X", a);
+		sum += a;
+	}
+	for (unsigned i = 0; i < count; i++)
+	{
+		fprintf(f, "%02X", data[i]);
+		sum += data[i];
+	}
+	fprintf(f, "%02X\n", (uint8_t)~sum);
+}
+
+static int write_srec(const char *name, const struct layout *layout,
+		int count, const uint8_t *data)
+{
+	FILE *f = fopen(name, "w");
+
+	if (f == NULL)
+		return ERROR_FAIL;
+
+	srec_record(f, 0, 0, 2, (const uint8_t *)"image_bench", 11);
+	for (int i = 0; i < count; i++)
+	{
+		uint32_t address = layout[i].base;
+		uint32_t left = layout[i].size;
+
+		while (left)
+		{
+			uint32_t n = (left > RECORD_SIZE) ? RECORD_SIZE : left;
+
+			/* use the shortest address that fits, like most tools */
+			if (address + n <= 0x10000)
+				srec_record(f, 1, address, 2, data, n);
+			else if (address + n <= 0x1000000)
+				srec_record(f, 2, address, 3, data, n);
+			else
+				srec_record(f, 3, address, 4, data, n);
+
+			data += n;
+			address += n;
+			left -= n;
+		}
+	}
+	srec_record(f, 7, 0, 4, NULL, 0);
+
+	return fclose(f) ? ERROR_FAIL : ERROR_OK;
+}
+
+/* open an image and check it against the layout it was written from */
+static int check_image(const char *name, const char *type,
+		const struct layout *layout, int count, const uint8_t *data,
+		uint8_t *buffer)
+{
+	struct image image;
+	int retval;
+
+	image.base_address_set = 0;
+	image.start_address_set = 0;
+	retval = image_open(&image, name, type);
+	if (retval != ERROR_OK)
+	{
+		printf("FAIL: %s: can't open, error %d\n", name, retval);
+		return retval;
+	}
+
+	if (image.num_sections != count)
+	{
+		printf("FAIL: %s: %d sections instead of %d\n",
+				name, image.num_sections, count);
+		retval = ERROR_FAIL;
+	}
+
+	for (int i = 0; (retval == ERROR_OK) && (i < count); i++)
+	{
+		size_t size_read;
+
+		if ((image.sections[i].base_address != layout[i].base)
+				|| (image.sections[i].size != layout[i].size))
+		{
+			printf("FAIL: %s: section %d is 0x%8.8x/%u instead of 0x%8.8x/%u\n",
+					name, i, (unsigned)image.sections[i].base_address,
+					(unsigned)image.sections[i].size,
+					(unsigned)layout[i].base, (unsigned)layout[i].size);
+			retval = ERROR_FAIL;
+			break;
+		}
+
+		retval = image_read_section(&image, i, 0, layout[i].size,
+				buffer, &size_read);
+		if ((retval != ERROR_OK) || (size_read != layout[i].size)
+				|| (memcmp(buffer, data, size_read) != 0))
+		{
+			printf("FAIL: %s: section %d data differs\n", name, i);
+			retval = ERROR_FAIL;
+		}
+		data += layout[i].size;
+	}
+
+	if ((retval == ERROR_OK) && (strcmp(type, "ihex") == 0)
+			&& (!image.start_address_set
+				|| (image.start_address != CHECK_START)))
+	{
+		printf("FAIL: %s: start address 0x%8.8x instead of 0x%8.8x\n",
+				name, (unsigned)image.start_address, CHECK_START);
+		retval = ERROR_FAIL;
+	}
+
+	image_close(&image);
+	return retval;
+}
+
+static int bench_image(const char *name, const char *type,
+		const struct layout *layout, const uint8_t *data, uint8_t *buffer)
+{
+	struct duration bench;
+	int retval;
+
+	duration_start(&bench);
+	retval = check_image(name, type, layout, 1, data, buffer);
+	duration_measure(&bench);
+	if (retval != ERROR_OK)
+		return retval;
+
+	printf("%s: %u KiB opened and read in %.3f s\n", name,
+			(unsigned)(layout->size / 1024), duration_elapsed(&bench));
+	return ERROR_OK;
+}
+
+int main(void)
+{
+	const struct layout bench_layout = { 0x08000000, BENCH_SIZE };
+	int count = sizeof(check_layout) / sizeof(check_layout[0]);
+	uint8_t *data = malloc(BENCH_SIZE);
+	uint8_t *buffer = malloc(BENCH_SIZE);
+	int retval;
+
+	if ((data == NULL) || (buffer == NULL))
+		return 1;
+
+	srand(1);
+	for (int i = 0; i < BENCH_SIZE; i++)
+		data[i] = rand();
+
+	retval = write_ihex(IHEX_FILE, check_layout, count, data, CHECK_START);
+	if (retval == ERROR_OK)
+		retval = check_image(IHEX_FILE, "ihex", check_layout, count,
+				data, buffer);
+	if (retval == ERROR_OK)
+		retval = write_srec(S19_FILE, check_layout, count, data);
+	if (retval == ERROR_OK)
+		retval = check_image(S19_FILE, "s19", check_layout, count,
+				data, buffer);
+
+	if (retval == ERROR_OK)
+		retval = write_ihex(IHEX_FILE, &bench_layout, 1, data, CHECK_START);
+	if (retval == ERROR_OK)
+		retval = bench_image(IHEX_FILE, "ihex", &bench_layout, data, buffer);
+	if (retval == ERROR_OK)
+		retval = write_srec(S19_FILE, &bench_layout, 1, data);
+	if (retval == ERROR_OK)
+		retval = bench_image(S19_FILE, "s19", &bench_layout, data, buffer);
+
+	remove(IHEX_FILE);
+	remove(S19_FILE);
+	free(buffer);
+	free(data);
+
+	return (retval == ERROR_OK) ? 0 : 1;
+}
@@ -0,0 +1,125 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * The parts of OpenOCD which the libraries under test refer to, but
+ * which the checks in this directory don't link.  Every check links
+ * this file; when a library gains a dependency, stub it here once.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <helper/log.h>
+#include <jtag/jtag.h>
+#include <server/server.h>
+#include <svf/svf.h>
+#include <target/target.h>
+
+/* openocd.c */
+struct command_context *global_cmd_ctx;
+
+/* gdb_server.c */
+int gdb_actual_connections;
+
+/* server.c */
+void server_keep_alive(void)
+{
+}
+
+/* jtag/core.c; xsvf_check supplies the DR scans and the queue */
+bool jtag_poll_get_enabled(void)
+{
+	return false;
+}
+
+void jtag_poll_set_enabled(bool value)
+{
+}
+
+tap_state_t cmd_queue_cur_state = TAP_RESET;
+
+struct jtag_tap *jtag_tap_by_string(const char *dotted_name)
+{
+	return NULL;
+}
+
+void jtag_add_plain_ir_scan(int num_bits, const uint8_t *out_bits,
+		uint8_t *in_bits, tap_state_t endstate)
+{
+}
+
+void jtag_add_ir_scan(struct jtag_tap *tap, struct scan_field *fields,
+		tap_state_t endstate)
+{
+}
+
+void jtag_add_clocks(int num_cycles)
+{
+}
+
+void jtag_add_runtest(int num_cycles, tap_state_t endstate)
+{
+}
+
+void jtag_add_sleep(uint32_t us)
+{
+}
+
+void jtag_add_tlr(void)
+{
+}
+
+void jtag_add_reset(int req_tlr_or_trst, int srst)
+{
+}
+
+/* jtag/interface.c */
+const char *tap_state_name(tap_state_t state)
+{
+	return "?";
+}
+
+/* svf/svf.c */
+int svf_add_statemove(tap_state_t goal_state)
+{
+	return ERROR_OK;
+}
+
+bool svf_tap_state_is_stable(tap_state_t state)
+{
+	return (TAP_RESET == state) || (TAP_IDLE == state)
+			|| (TAP_DRPAUSE == state) || (TAP_IRPAUSE == state);
+}
+
+/* target.c */
+int target_call_timer_callbacks_now(void)
+{
+	return ERROR_OK;
+}
+
+struct target *get_target(const char *id)
+{
+	return NULL;
+}
+
+int target_read_buffer(struct target *target, uint32_t address,
+		uint32_t size, uint8_t *buffer)
+{
+	return ERROR_FAIL;
+}
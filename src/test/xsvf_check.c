@@ -0,0 +1,293 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*
+ * Check for the deferred TDO checks of the XSVF player.
+ *
+ * The "xsvf" command is run on generated files against a loopback TAP:
+ * its data register is a plain shift register, so every DR scan
+ * captures what the previous one shifted in.  The files cover a long
+ * run of checked scans (flushed every 256 scans, not once per scan), a
+ * scan which only matches after an XREPEAT retry, a mismatch deep in a
+ * run that must be reported at the offset of its own opcode, and an
+ * earlier mismatch which must stop a later scan from being retried.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <xsvf/xsvf.h>
+#include <jtag/jtag.h>
+
+#define XSVF_FILE	"xsvf_check.xsvf"
+
+/* the opcodes used below, from xsvf.c */
+#define XCOMPLETE	0x00
+#define XTDOMASK	0x01
+#define XSDR		0x03
+#define XREPEAT		0x07
+#define XSDRSIZE	0x08
+#define XSDRTDO		0x09
+
+/* as in xsvf.c */
+#define MAX_QUEUED	256
+
+#define SCAN_BITS	32
+#define QUEUE_SIZE	1024
+
+/* the loopback TAP: queued scans run at jtag_execute_queue() */
+struct queued_scan
+{
+	int num_bits;
+	uint8_t out[SCAN_BITS / 8];
+	uint8_t *in;
+};
+
+static struct queued_scan queue[QUEUE_SIZE];
+static int queue_len;
+static uint8_t dr[SCAN_BITS / 8];
+
+static int num_flushes;
+static int num_dr_scans;
+static int num_pathmoves;
+static int max_queue_len;
+static bool queue_overrun;
+
+static void queue_dr_scan(int num_bits, const uint8_t *out, uint8_t *in)
+{
+	struct queued_scan *scan;
+
+	num_dr_scans++;
+	if ((queue_len == QUEUE_SIZE) || (num_bits != SCAN_BITS))
+	{
+		queue_overrun = true;
+		return;
+	}
+
+	scan = &queue[queue_len++];
+	scan->num_bits = num_bits;
+	memcpy(scan->out, out, sizeof(scan->out));
+	scan->in = in;
+}
+
+int jtag_execute_queue(void)
+{
+	num_flushes++;
+	if (queue_len > max_queue_len)
+		max_queue_len = queue_len;
+
+	for (int i = 0; i < queue_len; i++)
+	{
+		if (queue[i].in)
+			memcpy(queue[i].in, dr, sizeof(dr));
+		memcpy(dr, queue[i].out, sizeof(dr));
+	}
+	queue_len = 0;
+
+	return queue_overrun ? ERROR_FAIL : ERROR_OK;
+}
+
+void jtag_add_plain_dr_scan(int num_bits, const uint8_t *out_bits,
+		uint8_t *in_bits, tap_state_t endstate)
+{
+	queue_dr_scan(num_bits, out_bits, in_bits);
+}
+
+void jtag_add_dr_scan(struct jtag_tap *tap, int num_fields,
+		const struct scan_field *fields, tap_state_t endstate)
+{
+	queue_dr_scan(fields->num_bits, fields->out_value, fields->in_value);
+}
+
+void jtag_add_pathmove(int num_states, const tap_state_t *path)
+{
+	num_pathmoves++;
+}
+
+/* what the last command printed */
+static char last_message[256];
+
+static void capture_message(void *priv, const char *file, unsigned line,
+		const char *function, const char *string)
+{
+	if (*string)
+		strncpy(last_message, string, sizeof(last_message) - 1);
+}
+
+/* writes XSVF files; a value goes out MSB first, as xsvf.c reads it */
+static FILE *xsvf;
+
+static long emit_opcode(uint8_t opcode)
+{
+	long offset = ftell(xsvf);
+
+	fputc(opcode, xsvf);
+	return offset;
+}
+
+static void emit_u32(uint32_t value)
+{
+	uint8_t bytes[4];
+
+	h_u32_to_be(bytes, value);
+	fwrite(bytes, 1, sizeof(bytes), xsvf);
+}
+
+static void emit_header(uint8_t xrepeat, uint32_t mask)
+{
+	emit_opcode(XSDRSIZE);
+	emit_u32(SCAN_BITS);
+	emit_opcode(XTDOMASK);
+	emit_u32(mask);
+	emit_opcode(XREPEAT);
+	fputc(xrepeat, xsvf);
+}
+
+static long emit_sdrtdo(uint32_t out, uint32_t expected)
+{
+	long offset = emit_opcode(XSDRTDO);
+
+	emit_u32(out);
+	emit_u32(expected);
+	return offset;
+}
+
+static struct command_context *cmd_ctx;
+
+/* run the file just written, as "xsvf plain <file> quiet" */
+static int run_xsvf(void)
+{
+	struct command *xsvf_command = command_find_in_context(cmd_ctx, "xsvf");
+	const char *argv[] = { "plain", XSVF_FILE, "quiet" };
+	struct command_invocation cmd = {
+		.ctx = cmd_ctx,
+		.current = xsvf_command,
+		.name = "xsvf",
+		.argc = ARRAY_SIZE(argv),
+		.argv = argv,
+	};
+
+	emit_opcode(XCOMPLETE);
+	fclose(xsvf);
+
+	memset(dr, 0, sizeof(dr));
+	queue_len = 0;
+	queue_overrun = false;
+	num_flushes = 0;
+	num_dr_scans = 0;
+	num_pathmoves = 0;
+	max_queue_len = 0;
+	last_message[0] = 0;
+
+	return xsvf_command->handler(&cmd);
+}
+
+static int fail(const char *what)
+{
+	printf("FAIL: %s (%d flushes, %d DR scans, %d retries): %s\n", what,
+			num_flushes, num_dr_scans, num_pathmoves, last_message);
+	return 1;
+}
+
+static bool reported_at(long offset)
+{
+	char expected[64];
+
+	snprintf(expected, sizeof(expected), "near offset %lu ", (unsigned long)offset);
+	return strstr(last_message, expected) != NULL;
+}
+
+#define RUN_SCANS	600
+#define BAD_SCAN	300
+
+int main(void)
+{
+	long bad_offset = 0;
+	int i;
+
+	log_init();
+	log_add_callback(capture_message, NULL);
+
+	cmd_ctx = command_init("", NULL);
+	if ((cmd_ctx == NULL) || (xsvf_register_commands(cmd_ctx) != ERROR_OK)
+			|| (command_find_in_context(cmd_ctx, "xsvf") == NULL))
+		return fail("no xsvf command");
+
+	/* a run of checked scans, each seeing the TDI of the one before */
+	xsvf = fopen(XSVF_FILE, "wb");
+	emit_header(0, 0xffffffff);
+	for (i = 0; i < RUN_SCANS; i++)
+		emit_sdrtdo(i + 1, i);
+	if (run_xsvf() != ERROR_OK)
+		return fail("chained scans");
+	if ((num_dr_scans != RUN_SCANS) || queue_overrun)
+		return fail("chained scans were not all queued");
+	if ((max_queue_len > MAX_QUEUED)
+			|| (num_flushes > RUN_SCANS / MAX_QUEUED + 2))
+		return fail("chained scans not flushed every 256 scans");
+	printf("%d checked scans in %d queue flushes\n", RUN_SCANS, num_flushes);
+
+	/* unchecked scans don't flush, even with XREPEAT set; the checked
+	 * one after them only matches once retried
+	 */
+	xsvf = fopen(XSVF_FILE, "wb");
+	emit_header(3, 0);
+	for (i = 0; i < RUN_SCANS; i++)
+		emit_sdrtdo(i, 0);
+	emit_opcode(XTDOMASK);
+	emit_u32(0xffffffff);
+	emit_sdrtdo(0x12345678, 0x12345678);
+	if (run_xsvf() != ERROR_OK)
+		return fail("retried scan");
+	if ((num_dr_scans != RUN_SCANS + 2) || (num_pathmoves != 1))
+		return fail("retried scan was not scanned twice");
+	if ((max_queue_len > MAX_QUEUED)
+			|| (num_flushes > RUN_SCANS / MAX_QUEUED + 4))
+		return fail("unchecked scans were flushed one by one");
+
+	/* a mismatch in the middle of a run is reported where it is */
+	xsvf = fopen(XSVF_FILE, "wb");
+	emit_header(0, 0xffffffff);
+	for (i = 0; i < RUN_SCANS; i++)
+	{
+		long offset = emit_sdrtdo(i + 1, (i == BAD_SCAN) ? ~i : i);
+		if (i == BAD_SCAN)
+			bad_offset = offset;
+	}
+	if (run_xsvf() == ERROR_OK)
+		return fail("bad scan passed");
+	if (!reported_at(bad_offset))
+		return fail("bad scan reported at the wrong offset");
+
+	/* an earlier mismatch is not retried away by a later scan */
+	xsvf = fopen(XSVF_FILE, "wb");
+	emit_header(0, 0xffffffff);
+	bad_offset = emit_sdrtdo(1, 0xdead);
+	emit_opcode(XREPEAT);
+	fputc(3, xsvf);
+	emit_sdrtdo(0x12345678, 0x12345678);
+	if (run_xsvf() == ERROR_OK)
+		return fail("earlier bad scan passed");
+	if ((num_dr_scans != 2) || (num_pathmoves != 0))
+		return fail("later scan retried after an earlier mismatch");
+	if (!reported_at(bad_offset))
+		return fail("earlier bad scan reported at the wrong offset");
+
+	remove(XSVF_FILE);
+	return 0;
+}
@@ -174,6 +174,160 @@ static int xsvf_read_buffer(int num_bits, int fd, uint8_t* buf)
 	return ERROR_OK;
 }
 
+/* TDO checks wait in this list until the JTAG queue is flushed, so that
+ * a run of scans costs one flush.  Only scans which may be retried
+ * (XREPEAT, LCOUNT) need their result before the next opcode is run.
+ */
+struct xsvf_check
+{
+	long file_offset;		/* of the opcode doing the scan */
+	int num_bits;
+	uint8_t *tdo;			/* captured; expected and mask follow */
+	uint8_t *expected;
+	uint8_t *mask;
+};
+
+/* scans queued before the queue is flushed anyway */
+#define XSVF_MAX_QUEUED	256
+
+static struct xsvf_check xsvf_checks[XSVF_MAX_QUEUED];
+static int xsvf_num_checks;
+static int xsvf_num_queued;
+/* the check which failed at the last flush, if any */
+static struct xsvf_check xsvf_failed;
+
+static bool xsvf_mask_is_zero(const uint8_t *mask, int num_bits)
+{
+	int num_bytes = (num_bits + 7) / 8;
+
+	for (int i = 0; i < num_bytes; i++)
+	{
+		if (mask[i])
+			return false;
+	}
+	return true;
+}
+
+/* Queue a DR scan ending in DRPAUSE, checking TDO at the next flush
+ * unless the mask makes that pointless.  Returns true if checked.
+ */
+static bool xsvf_add_dr_scan(struct jtag_tap *tap, int num_bits,
+		const uint8_t *out, const uint8_t *expected, const uint8_t *mask,
+		long file_offset)
+{
+	struct scan_field field;
+	int num_bytes = (num_bits + 7) / 8;
+	bool checked = false;
+
+	field.num_bits = num_bits;
+	field.out_value = out;
+	field.in_value = NULL;
+
+	if (expected && mask && !xsvf_mask_is_zero(mask, num_bits))
+	{
+		struct xsvf_check *check = &xsvf_checks[xsvf_num_checks];
+
+		check->tdo = malloc(3 * num_bytes);
+		if (check->tdo)
+		{
+			check->file_offset = file_offset;
+			check->num_bits = num_bits;
+			check->expected = check->tdo + num_bytes;
+			check->mask = check->expected + num_bytes;
+			memcpy(check->expected, expected, num_bytes);
+			memcpy(check->mask, mask, num_bytes);
+			field.in_value = check->tdo;
+			xsvf_num_checks++;
+			checked = true;
+		}
+		else
+			LOG_ERROR("no memory for a TDO check");
+	}
+
+	if (tap == NULL)
+		jtag_add_plain_dr_scan(field.num_bits, field.out_value, field.in_value,
+				TAP_DRPAUSE);
+	else
+		jtag_add_dr_scan(tap, 1, &field, TAP_DRPAUSE);
+	xsvf_num_queued++;
+
+	return checked;
+}
+
+/* Run the JTAG queue and resolve the checks waiting on it.  On a TDO
+ * mismatch, xsvf_failed describes the first failing scan.
+ */
+static int xsvf_flush(void)
+{
+	int result = jtag_execute_queue();
+	int i;
+
+	free(xsvf_failed.tdo);
+	xsvf_failed.tdo = NULL;
+
+	for (i = 0; i < xsvf_num_checks; i++)
+	{
+		struct xsvf_check *check = &xsvf_checks[i];
+
+		if ((result == ERROR_OK) && (xsvf_failed.tdo == NULL)
+				&& buf_cmp_mask(check->tdo, check->expected,
+						check->mask, check->num_bits))
+		{
+			xsvf_failed = *check;
+			result = ERROR_XSVF_FAILED;
+		}
+		else
+			free(check->tdo);
+	}
+	xsvf_num_checks = 0;
+	xsvf_num_queued = 0;
+
+	return result;
+}
+
+static int xsvf_flush_if_full(void)
+{
+	if (xsvf_num_queued < XSVF_MAX_QUEUED)
+		return ERROR_OK;
+	return xsvf_flush();
+}
+
+/* forget the checks still queued, and the last failure */
+static void xsvf_free_checks(void)
+{
+	for (int i = 0; i < xsvf_num_checks; i++)
+		free(xsvf_checks[i].tdo);
+	xsvf_num_checks = 0;
+	xsvf_num_queued = 0;
+
+	free(xsvf_failed.tdo);
+	xsvf_failed.tdo = NULL;
+}
+
+static void xsvf_log_mismatch(void)
+{
+	char *captured, *expected, *mask;
+	int bits;
+
+	if (xsvf_failed.tdo == NULL)
+		return;
+
+	bits = (xsvf_failed.num_bits > DEBUG_JTAG_IOZ)
+			? DEBUG_JTAG_IOZ : xsvf_failed.num_bits;
+	captured = buf_to_str(xsvf_failed.tdo, bits, 16);
+	expected = buf_to_str(xsvf_failed.expected, bits, 16);
+	mask = buf_to_str(xsvf_failed.mask, bits, 16);
+
+	LOG_WARNING("Bad value '%s' captured by the scan at offset %ld:",
+			captured, xsvf_failed.file_offset);
+	LOG_WARNING(" check_value: 0x%s", expected);
+	LOG_WARNING(" check_mask: 0x%s", mask);
+
+	free(captured);
+	free(expected);
+	free(mask);
+}
+
 
 COMMAND_HANDLER(handle_xsvf_command)
 {
@@ -330,14 +484,6 @@ COMMAND_HANDLER(handle_xsvf_command)
 					jtag_add_tlr();
 				else
 					jtag_add_pathmove(pathlen, path);
-
-				result = jtag_execute_queue();
-				if (result != ERROR_OK) {
-					LOG_ERROR("XSVF: pathmove error %d",
-							result);
-					do_abort = 1;
-					break;
-				}
 				continue;
 			}
 		}
@@ -347,7 +493,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 		case XCOMPLETE:
 			LOG_DEBUG("XCOMPLETE");
 
-			result = jtag_execute_queue();
+			result = xsvf_flush();
 			if (result != ERROR_OK)
 			{
 				tdo_mismatch = 1;
@@ -444,7 +590,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 
 				for (attempt = 0; attempt < limit;  ++attempt)
 				{
-					struct scan_field field;
+					bool checked;
 
 					if (attempt > 0)
 					{
@@ -475,33 +621,33 @@ COMMAND_HANDLER(handle_xsvf_command)
 							LOG_USER("%s mismatch, xsdrsize=%d retry=%d", op_name, xsdrsize, attempt);
 					}
 
-					field.num_bits = xsdrsize;
-					field.out_value = dr_out_buf;
-					field.in_value = calloc(DIV_ROUND_UP(field.num_bits, 8), 1);
+					/* XSDR checks TDO against the last XSDRTDO values */
+					checked = xsvf_add_dr_scan(tap, xsdrsize, dr_out_buf,
+							dr_in_buf, dr_in_mask, file_offset);
 
-					if (tap == NULL)
-						jtag_add_plain_dr_scan(field.num_bits, field.out_value, field.in_value,
-								TAP_DRPAUSE);
+					/* only a scan which may be retried needs its
+					 * result now; the others wait for a later flush
+					 */
+					if (checked && (limit > 1))
+						result = xsvf_flush();
 					else
-						jtag_add_dr_scan(tap, 1, &field, TAP_DRPAUSE);
-
-					jtag_check_value_mask(&field, dr_in_buf, dr_in_mask);
-
-					free(field.in_value);
-
-
-					/* LOG_DEBUG("FLUSHING QUEUE"); */
-					result = jtag_execute_queue();
+						result = xsvf_flush_if_full();
 					if (result == ERROR_OK)
 					{
 						matched = 1;
 						break;
 					}
+
+					/* a mismatch of an earlier scan is not retried */
+					if ((result != ERROR_XSVF_FAILED)
+							|| (xsvf_failed.file_offset != file_offset))
+						break;
 				}
 
 				if (!matched)
 				{
-					LOG_USER("%s mismatch", op_name);
+					if (xsvf_failed.tdo && (xsvf_failed.file_offset == file_offset))
+						LOG_USER("%s mismatch", op_name);
 					tdo_mismatch = 1;
 					break;
 				}
@@ -719,8 +865,8 @@ COMMAND_HANDLER(handle_xsvf_command)
 					 * around the problem.
 					 */
 
-					/* LOG_DEBUG("FLUSHING QUEUE"); */
-					result = jtag_execute_queue();
+					xsvf_num_queued++;
+					result = xsvf_flush_if_full();
 					if (result != ERROR_OK)
 					{
 						tdo_mismatch = 1;
@@ -922,42 +1068,37 @@ COMMAND_HANDLER(handle_xsvf_command)
 
 				for (attempt = 0; attempt < limit;  ++attempt)
 				{
-					struct scan_field field;
+					bool checked;
 
 					result = svf_add_statemove(loop_state);
 					jtag_add_clocks(loop_clocks);
 					jtag_add_sleep(loop_usecs);
 
-					field.num_bits = xsdrsize;
-					field.out_value = dr_out_buf;
-					field.in_value = calloc(DIV_ROUND_UP(field.num_bits, 8), 1);
-
 					if (attempt > 0 && verbose)
 						LOG_USER("LSDR retry %d", attempt);
 
-					if (tap == NULL)
-						jtag_add_plain_dr_scan(field.num_bits, field.out_value, field.in_value,
-								TAP_DRPAUSE);
-					else
-						jtag_add_dr_scan(tap, 1, &field, TAP_DRPAUSE);
-
-					jtag_check_value_mask(&field, dr_in_buf, dr_in_mask);
+					checked = xsvf_add_dr_scan(tap, xsdrsize, dr_out_buf,
+							dr_in_buf, dr_in_mask, file_offset);
 
-					free(field.in_value);
-
-
-					/* LOG_DEBUG("FLUSHING QUEUE"); */
-					result = jtag_execute_queue();
+					if (checked && (limit > 1))
+						result = xsvf_flush();
+					else
+						result = xsvf_flush_if_full();
 					if (result == ERROR_OK)
 					{
 						matched = 1;
 						break;
 					}
+
+					if ((result != ERROR_XSVF_FAILED)
+							|| (xsvf_failed.file_offset != file_offset))
+						break;
 				}
 
 				if (!matched)
 				{
-					LOG_USER("LSDR mismatch");
+					if (xsvf_failed.tdo && (xsvf_failed.file_offset == file_offset))
+						LOG_USER("LSDR mismatch");
 					tdo_mismatch = 1;
 					break;
 				}
@@ -998,24 +1139,38 @@ COMMAND_HANDLER(handle_xsvf_command)
 		}
 
 		if (do_abort || unsupported || tdo_mismatch)
-		{
-			LOG_DEBUG("xsvf failed, setting taps to reasonable state");
-
-			/* upon error, return the TAPs to a reasonable state */
-			result = svf_add_statemove(TAP_IDLE);
-			result = jtag_execute_queue();
 			break;
-		}
+	}
+
+	/* resolve the checks of scans queued at the end of the file */
+	if (!(do_abort || unsupported || tdo_mismatch)
+			&& (xsvf_flush() != ERROR_OK))
+		tdo_mismatch = 1;
+
+	if (do_abort || unsupported || tdo_mismatch)
+	{
+		LOG_DEBUG("xsvf failed, setting taps to reasonable state");
+
+		/* upon error, return the TAPs to a reasonable state */
+		result = svf_add_statemove(TAP_IDLE);
+		result = jtag_execute_queue();
 	}
 
 	if (tdo_mismatch)
 	{
+		if (xsvf_failed.tdo)
+		{
+			xsvf_log_mismatch();
+			file_offset = xsvf_failed.file_offset;
+		}
+		xsvf_free_checks();
 		command_print(CMD_CTX, "TDO mismatch, somewhere near offset %lu in xsvf file, aborting",
 					  file_offset);
 
 
 		return ERROR_FAIL;
 	}
+	xsvf_free_checks();
 
 	if (unsupported)
 	{